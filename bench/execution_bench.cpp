@@ -0,0 +1,255 @@
+#include "propscript.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+#ifdef __linux__
+	#include <linux/perf_event.h>
+	#include <sys/ioctl.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+#define BENCH_DEFAULT_SEED          1234
+#define BENCH_DEFAULT_NUM_FUNCTIONS 20000
+#define BENCH_ROUNDS                4
+#define BENCH_ITERATIONS            3
+#define BENCH_MAX_EXPR_DEPTH        3
+
+//the hardware events counted while executing, not every machine or virtual machine exposes all of them
+enum BenchCounter
+{
+	BENCH_COUNTER_INSTRUCTIONS,
+	BENCH_COUNTER_CACHE_REFERENCES,
+	BENCH_COUNTER_CACHE_MISSES,
+	BENCH_COUNTER_L1D_MISSES,
+
+	BENCH_COUNTER_COUNT
+};
+
+//the best execution time of a layout, and the counters of that run
+struct BenchResult
+{
+	double execute = 0.0;
+	int64_t counters[BENCH_COUNTER_COUNT];
+};
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static int g_benchCounterFds[BENCH_COUNTER_COUNT];
+
+//opens a counter for each hardware event, events that can't be counted are left closed
+static void _bench_open_counters()
+{
+	for(int i = 0; i < BENCH_COUNTER_COUNT; i++)
+		g_benchCounterFds[i] = -1;
+
+#ifdef __linux__
+	const uint32_t types[] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE};
+	const uint64_t configs[] = {
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_REFERENCES,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+	};
+
+	for(int i = 0; i < BENCH_COUNTER_COUNT; i++)
+	{
+		struct perf_event_attr attr = {};
+		attr.size = sizeof(attr);
+		attr.type = types[i];
+		attr.config = configs[i];
+		attr.disabled = 1;
+		attr.exclude_kernel = 1; //user space events can be counted without privileges on most systems
+		attr.exclude_hv = 1;
+
+		g_benchCounterFds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+#endif
+}
+
+static void _bench_close_counters()
+{
+#ifdef __linux__
+	for(int i = 0; i < BENCH_COUNTER_COUNT; i++)
+		if(g_benchCounterFds[i] >= 0)
+			close(g_benchCounterFds[i]);
+#endif
+}
+
+static void _bench_start_counters()
+{
+#ifdef __linux__
+	for(int i = 0; i < BENCH_COUNTER_COUNT; i++)
+	{
+		if(g_benchCounterFds[i] < 0)
+			continue;
+
+		ioctl(g_benchCounterFds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(g_benchCounterFds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+//stops counting and reads the counters, -1 for events that can't be counted
+static void _bench_stop_counters(int64_t* counters)
+{
+	for(int i = 0; i < BENCH_COUNTER_COUNT; i++)
+	{
+		counters[i] = -1;
+
+#ifdef __linux__
+		uint64_t value;
+		if(g_benchCounterFds[i] >= 0 && ioctl(g_benchCounterFds[i], PERF_EVENT_IOC_DISABLE, 0) == 0 &&
+		   read(g_benchCounterFds[i], &value, sizeof(value)) == sizeof(value))
+			counters[i] = (int64_t)value;
+#endif
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+//generates a random float expression of a function's parameters, its accumulator and its loop variable
+static std::string _bench_generate_expression(std::mt19937& rng, int depth)
+{
+	const char* operands[] = {"a", "b", "s", "j", "0.5", "0.25", "1.5"};
+	const char* ops[] = {" + ", " - ", " * ", " + ", " - "};
+
+	if(depth == 0 || rng() % 3 == 0)
+		return operands[rng() % 7];
+
+	if(rng() % 4 == 0)
+		return "abs(" + _bench_generate_expression(rng, depth - 1) + ")";
+
+	return "(" + _bench_generate_expression(rng, depth - 1) + ops[rng() % 5] + _bench_generate_expression(rng, depth - 1) + ") * 0.5";
+}
+
+//generates a deterministic script that defines many small functions with loops and branches, then calls each of them in turn.
+//the code is executed a few times, so it is large enough to not fit in the caches but is still walked more than once
+static std::string _bench_generate_script(uint32_t seed, uint32_t numFunctions)
+{
+	std::mt19937 rng(seed);
+	std::string source;
+
+	for(uint32_t i = 0; i < numFunctions; i++)
+	{
+		source += "func f" + std::to_string(i) + "(a, b)\n{\n";
+		source += "\ts = a * 0.5\n";
+		source += "\tfor j in range(0, " + std::to_string(2 + rng() % 3) + ")\n\t{\n";
+		source += "\t\ts = " + _bench_generate_expression(rng, BENCH_MAX_EXPR_DEPTH) + "\n";
+		source += "\t\tif s > b + 2.0 * 2.0\n\t\t\ts = s * 0.25\n\t\telse\n\t\t\ts = s + " + _bench_generate_expression(rng, 1) + "\n";
+		source += "\t}\n\tret s * 0.5\n}\n\n";
+	}
+
+	source += "t = 0.5\nfor r in range(0, " + std::to_string(BENCH_ROUNDS) + ")\n{\n";
+	for(uint32_t i = 0; i < numFunctions; i++)
+		source += "\tt = f" + std::to_string(i) + "(t, r) * 0.5\n";
+	source += "}\n";
+
+	return source;
+}
+
+//returns the number of seconds since start
+static double _bench_seconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//executes an ast several times, returns the best time and the counters of that run
+static bool _bench_execute(PSast* ast, BenchResult* result)
+{
+	PSprogram* program = ps_resolve(ast);
+	if(!program)
+		return false;
+
+	for(int i = 0; i < BENCH_ITERATIONS; i++)
+	{
+		int64_t counters[BENCH_COUNTER_COUNT];
+		auto start = std::chrono::steady_clock::now();
+		_bench_start_counters();
+		ps_execute(program);
+		_bench_stop_counters(counters);
+		double execute = _bench_seconds_since(start);
+
+		if(i == 0 || execute < result->execute)
+		{
+			result->execute = execute;
+			std::copy(counters, counters + BENCH_COUNTER_COUNT, result->counters);
+		}
+	}
+
+	ps_free_program(program);
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+int main(int argc, char** argv)
+{
+	const char* counterNames[] = {"instructions", "cache references", "cache misses", "l1d load misses"};
+
+	uint32_t seed = argc > 1 ? (uint32_t)std::strtoul(argv[1], nullptr, 10) : BENCH_DEFAULT_SEED;
+	uint32_t numFunctions = argc > 2 ? (uint32_t)std::strtoul(argv[2], nullptr, 10) : BENCH_DEFAULT_NUM_FUNCTIONS;
+
+	std::cout << "seed " << seed << ", " << numFunctions << " functions, best of " << BENCH_ITERATIONS << " runs" << std::endl;
+
+	//parse and fold the script, which leaves the folded operands behind:
+	std::string source = _bench_generate_script(seed, numFunctions);
+	PSast* ast = ps_parse_source(source);
+	if(!ast)
+	{
+		std::cout << "failed to parse the script" << std::endl;
+		return -1;
+	}
+	ps_fold_constants(ast);
+
+	_bench_open_counters();
+
+	//execute the nodes in parse order, then compacted:
+	const char* layoutNames[] = {"as parsed", "compacted"};
+	BenchResult results[2];
+	for(int layout = 0; layout < 2; layout++)
+	{
+		if(layout == 1)
+		{
+			auto start = std::chrono::steady_clock::now();
+			ps_compact_ast(ast);
+			std::cout << "compacting: " << _bench_seconds_since(start) * 1000.0 << " ms" << std::endl;
+		}
+
+		size_t numNodes = ast->nodePool.size();
+		if(!_bench_execute(ast, &results[layout]))
+		{
+			std::cout << "failed to resolve the script" << std::endl;
+			return -1;
+		}
+
+		std::cout << layoutNames[layout] << ": " << numNodes << " nodes, " << numNodes * sizeof(PSnode) / (1024.0 * 1024.0) << " MB" << std::endl;
+		std::cout << "\texecute: " << results[layout].execute * 1000.0 << " ms" << std::endl;
+		for(int i = 0; i < BENCH_COUNTER_COUNT; i++)
+		{
+			if(results[layout].counters[i] < 0)
+				std::cout << "\t" << counterNames[i] << ": unavailable" << std::endl;
+			else
+				std::cout << "\t" << counterNames[i] << ": " << results[layout].counters[i] << std::endl;
+		}
+	}
+
+	//REPORT:
+	std::cout << "compacted vs as parsed:" << std::endl;
+	std::cout << "\texecute: " << results[0].execute / results[1].execute << "x faster" << std::endl;
+	for(int i = 0; i < BENCH_COUNTER_COUNT; i++)
+		if(results[0].counters[i] > 0 && results[1].counters[i] >= 0)
+			std::cout << "\t" << counterNames[i] << ": " << (double)results[1].counters[i] / results[0].counters[i] * 100.0 << "% of as parsed" << std::endl;
+
+	_bench_close_counters();
+	ps_free_ast(ast);
+
+	return 0;
+}
@@ -0,0 +1,657 @@
+#include "propscript.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+#define BENCH_DEFAULT_SEED        1234
+#define BENCH_DEFAULT_CORPUS_SIZE (8 * 1024 * 1024)
+#define BENCH_ITERATIONS          3
+#define BENCH_MAX_EXPR_DEPTH      8
+#define BENCH_NUM_VARIABLES       32
+#define BENCH_SCALING_TERMS       (320 * 1000)
+#define BENCH_NUM_EDITS           300
+#define BENCH_NUM_OBJECTS         2000
+#define BENCH_OBJECT_SIZE         (4 * 1024)
+
+//the kinds of synthetic corpora, each stresses a different part of the front end
+enum BenchCorpus
+{
+	BENCH_CORPUS_EXPRESSIONS, //deeply nested expressions
+	BENCH_CORPUS_FUNCTIONS,   //many small function definitions
+	BENCH_CORPUS_BRANCHES,    //long if/else chains
+	BENCH_CORPUS_COMMENTS,    //code that is mostly comments
+
+	BENCH_CORPUS_COUNT
+};
+
+//the best time of each front end stage, in seconds
+struct BenchTimes
+{
+	double lex = 0.0;
+	double parse = 0.0;
+	double save = 0.0;
+	double load = 0.0;
+};
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+//counts every heap allocation made through operator new, so the allocations of each stage can be reported
+static std::atomic<size_t> g_benchAllocations(0);
+
+void* operator new(size_t size)
+{
+	g_benchAllocations.fetch_add(1, std::memory_order_relaxed);
+	if(void* ptr = std::malloc(size == 0 ? 1 : size))
+		return ptr;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept
+{
+	std::free(ptr);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static std::string _bench_variable(std::mt19937& rng)
+{
+	return "v" + std::to_string(rng() % BENCH_NUM_VARIABLES);
+}
+
+//generates a random expression, nesting binary operators, parenthesis and function calls up to depth levels deep
+static std::string _bench_generate_expression(std::mt19937& rng, int depth)
+{
+	const char* ops[] = {" + ", " - ", " * ", " / ", " % ", " == ", " != ", " < ", " >= ", " and ", " or "};
+
+	if(depth == 0 || rng() % 4 == 0)
+	{
+		switch(rng() % 4)
+		{
+		case 0:
+			return std::to_string(rng() % 10000);
+		case 1:
+			return std::to_string(rng() % 1000) + "." + std::to_string(rng() % 100);
+		default:
+			return _bench_variable(rng);
+		}
+	}
+
+	switch(rng() % 4)
+	{
+	case 0:
+		return "(" + _bench_generate_expression(rng, depth - 1) + ops[rng() % 11] + _bench_generate_expression(rng, depth - 1) + ")";
+	case 1:
+		return "f" + std::to_string(rng() % 64) + "(" + _bench_generate_expression(rng, depth - 1) + ", " + _bench_generate_expression(rng, depth - 1) + ")";
+	default:
+		return _bench_generate_expression(rng, depth - 1) + ops[rng() % 11] + _bench_generate_expression(rng, depth - 1);
+	}
+}
+
+//generates a deterministic script of the given kind from the seed
+static std::string _bench_generate_corpus(BenchCorpus corpus, uint32_t seed, size_t size)
+{
+	std::mt19937 rng(seed + corpus);
+	std::string source;
+	source.reserve(size + 4096);
+
+	uint32_t numFunctions = 0;
+	while(source.size() < size)
+	{
+		switch(corpus)
+		{
+		case BENCH_CORPUS_EXPRESSIONS:
+		{
+			source += _bench_variable(rng) + " = " + _bench_generate_expression(rng, BENCH_MAX_EXPR_DEPTH) + "\n";
+			break;
+		}
+		case BENCH_CORPUS_FUNCTIONS:
+		{
+			std::string a = _bench_variable(rng);
+			std::string b = _bench_variable(rng);
+			while(b == a) //parameters need different names to resolve
+				b = _bench_variable(rng);
+			source += "func fn" + std::to_string(numFunctions++) + "(" + a + ", " + b + ")\n{\n";
+			source += "\tt = " + a + " * " + b + " + " + std::to_string(rng() % 100) + "\n";
+			if(rng() % 2 == 0)
+				source += "\tif t > " + a + "\n\t\tret t - " + b + "\n";
+			source += "\tret t\n}\n\n";
+			break;
+		}
+		case BENCH_CORPUS_BRANCHES:
+		{
+			std::string var = _bench_variable(rng);
+			uint32_t length = 8 + rng() % 56;
+			for(uint32_t i = 0; i < length; i++)
+			{
+				source += (i == 0 ? "if " : "else if ") + var + " == " + std::to_string(i) + "\n";
+				source += "\t" + _bench_variable(rng) + " = " + _bench_generate_expression(rng, 2) + "\n";
+			}
+			source += "else\n{\n\t" + var + " = 0\n\tbreak\n}\n";
+			break;
+		}
+		case BENCH_CORPUS_COMMENTS:
+		{
+			uint32_t numComments = 2 + rng() % 6;
+			for(uint32_t i = 0; i < numComments; i++)
+				source += "# this comment explains, at some length, what the statement below it does and why it is needed\n";
+			source += _bench_variable(rng) + " = " + _bench_generate_expression(rng, 2) + " # trailing comment\n\n";
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	return source;
+}
+
+//generates statements that are each a single expression with numTerms terms and mixed precedence operators, without parenthesis.
+//the total number of terms is always BENCH_SCALING_TERMS, so the time per term only depends on the length of the expressions
+static std::string _bench_generate_long_expressions(uint32_t seed, uint32_t numTerms)
+{
+	const char* ops[] = {" + ", " * ", " - ", " == ", " / ", " and ", " < ", " % ", " or "};
+
+	std::mt19937 rng(seed);
+	std::string source;
+	for(uint32_t i = 0; i < BENCH_SCALING_TERMS / numTerms; i++)
+	{
+		source += _bench_variable(rng) + " = " + _bench_variable(rng);
+		for(uint32_t j = 1; j < numTerms; j++)
+			source += ops[rng() % 9] + (rng() % 2 == 0 ? _bench_variable(rng) : std::to_string(1 + rng() % 100));
+
+		source += "\n";
+	}
+
+	return source;
+}
+
+//returns the number of bytes an ast keeps allocated
+static size_t _bench_ast_memory(const PSast* ast)
+{
+	return ast->parentNodes.capacity() * sizeof(PSnodeHandle) + ast->nodePool.capacity() * sizeof(PSnode) + ast->lists.capacity() * sizeof(uint32_t) +
+	       ast->symbols.names.capacity() + (ast->symbols.offsets.capacity() + ast->symbols.buckets.capacity()) * sizeof(uint32_t);
+}
+
+//returns the peak resident set size of the process, in bytes
+static size_t _bench_peak_rss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if(!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	#ifdef __APPLE__
+		return (size_t)usage.ru_maxrss;
+	#else
+		return (size_t)usage.ru_maxrss * 1024;
+	#endif
+#endif
+}
+
+//returns the number of seconds since start
+static double _bench_seconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+int main(int argc, char** argv)
+{
+	const char* corpusNames[] = {"expressions", "functions", "branches", "comments"};
+
+	uint32_t seed = argc > 1 ? (uint32_t)std::strtoul(argv[1], nullptr, 10) : BENCH_DEFAULT_SEED;
+	size_t corpusSize = argc > 2 ? std::strtoull(argv[2], nullptr, 10) * 1024 * 1024 : BENCH_DEFAULT_CORPUS_SIZE;
+
+	std::string sourcePath = (std::filesystem::temp_directory_path() / "propscript_frontend_bench.ps").string();
+	std::string objPath = (std::filesystem::temp_directory_path() / "propscript_frontend_bench.psobj").string();
+
+	std::cout << "seed " << seed << ", best of " << BENCH_ITERATIONS << " runs, sizeof(PSnode) = " << sizeof(PSnode) << " bytes" << std::endl;
+
+	for(int corpus = 0; corpus < BENCH_CORPUS_COUNT; corpus++)
+	{
+		//generate the corpus and write it to disk, so ps_lex_file can be timed:
+		std::string source = _bench_generate_corpus((BenchCorpus)corpus, seed, corpusSize);
+		{
+			std::ofstream file(sourcePath, std::ios::binary);
+			file.write(source.data(), source.size());
+		}
+
+		//TIME EACH STAGE:
+		BenchTimes best;
+		size_t numTokens = 0;
+		size_t numNodes = 0;
+		size_t objSize = 0;
+		size_t astSize = 0;
+		size_t parseAllocations = 0;
+		for(int i = 0; i < BENCH_ITERATIONS; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			PStokenBuffer tokens = ps_lex_file(sourcePath);
+			double lex = _bench_seconds_since(start);
+
+			size_t allocations = g_benchAllocations.load();
+			start = std::chrono::steady_clock::now();
+			PSast* ast = ps_parse_tokens(tokens);
+			double parse = _bench_seconds_since(start);
+			parseAllocations = g_benchAllocations.load() - allocations;
+			if(!ast)
+			{
+				std::cout << "failed to parse the " << corpusNames[corpus] << " corpus" << std::endl;
+				return -1;
+			}
+
+			start = std::chrono::steady_clock::now();
+			ps_save_ast(objPath, ast);
+			double save = _bench_seconds_since(start);
+
+			numTokens = tokens.size();
+			numNodes = ast->nodePool.size();
+			astSize = _bench_ast_memory(ast);
+			objSize = (size_t)std::filesystem::file_size(objPath);
+			ps_free_ast(ast);
+
+			start = std::chrono::steady_clock::now();
+			PSast* loaded = ps_load_ast(objPath);
+			double load = _bench_seconds_since(start);
+			ps_free_ast(loaded);
+
+			if(i == 0 || lex < best.lex)
+				best.lex = lex;
+			if(i == 0 || parse < best.parse)
+				best.parse = parse;
+			if(i == 0 || save < best.save)
+				best.save = save;
+			if(i == 0 || load < best.load)
+				best.load = load;
+		}
+
+		//REPORT:
+		double sourceMB = source.size() / (1024.0 * 1024.0);
+		std::cout << corpusNames[corpus] << ": " << sourceMB << " MB, " << numTokens << " tokens, " << numNodes << " nodes" << std::endl;
+		std::cout << "\tlex:   " << best.lex * 1000.0 << " ms, " << numTokens / best.lex / 1e6 << " M tokens/s, " << sourceMB / best.lex << " MB/s" << std::endl;
+		std::cout << "\tparse: " << best.parse * 1000.0 << " ms, " << numNodes / best.parse / 1e6 << " M nodes/s, " << numTokens / best.parse / 1e6 << " M tokens/s, " << parseAllocations << " allocations" << std::endl;
+		std::cout << "\tsave:  " << best.save * 1000.0 << " ms, " << numNodes / best.save / 1e6 << " M nodes/s, " << (double)objSize / numNodes << " bytes/node on disk" << std::endl;
+		std::cout << "\tast:   " << astSize / (1024.0 * 1024.0) << " MB in memory, " << (double)astSize / numNodes << " bytes/node" << std::endl;
+		std::cout << "\tload:  " << best.load * 1000.0 << " ms, " << numNodes / best.load / 1e6 << " M nodes/s" << std::endl;
+		std::cout << "\tpeak rss so far: " << _bench_peak_rss() / (1024 * 1024) << " MB" << std::endl;
+	}
+
+	//parse increasingly long expressions, the time per term should stay constant:
+	std::cout << "long expressions, " << BENCH_SCALING_TERMS << " terms in total:" << std::endl;
+	for(uint32_t numTerms = 10; numTerms <= 20480; numTerms *= 4)
+	{
+		std::string source = _bench_generate_long_expressions(seed, numTerms);
+		PStokenBuffer tokens = ps_lex_buffer(source.data(), source.size());
+
+		double best = 0.0;
+		for(int i = 0; i < BENCH_ITERATIONS; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			PSast* ast = ps_parse_tokens(tokens);
+			double parse = _bench_seconds_since(start);
+			if(!ast)
+			{
+				std::cout << "failed to parse the long expressions" << std::endl;
+				return -1;
+			}
+			ps_free_ast(ast);
+
+			if(i == 0 || parse < best)
+				best = parse;
+		}
+
+		std::cout << "\t" << numTerms << " terms per expression: " << best * 1000.0 << " ms, " << best * 1e9 / BENCH_SCALING_TERMS << " ns/term" << std::endl;
+	}
+
+	//parse the functions corpus with more threads, limited by the hardware threads:
+	std::cout << "parallel parsing of the functions corpus:" << std::endl;
+	{
+		std::string source = _bench_generate_corpus(BENCH_CORPUS_FUNCTIONS, seed, corpusSize);
+		PStokenBuffer tokens = ps_lex_buffer(source.data(), source.size());
+
+		double serial = 0.0;
+		for(uint32_t numThreads = 1; numThreads <= 8; numThreads *= 2)
+		{
+			ps_parse_set_threads(numThreads);
+
+			double best = 0.0;
+			for(int i = 0; i < BENCH_ITERATIONS; i++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				PSast* ast = ps_parse_tokens(tokens);
+				double parse = _bench_seconds_since(start);
+				if(!ast)
+				{
+					std::cout << "failed to parse the functions corpus" << std::endl;
+					return -1;
+				}
+				ps_free_ast(ast);
+
+				if(i == 0 || parse < best)
+					best = parse;
+			}
+
+			if(numThreads == 1)
+				serial = best;
+
+			std::cout << "	" << numThreads << " threads: " << best * 1000.0 << " ms, " << serial / best << "x" << std::endl;
+		}
+
+		ps_parse_set_threads(0);
+	}
+
+	//edit increasingly large scripts, the time per edit should grow far slower than compiling them:
+	std::cout << "incremental edits, " << BENCH_NUM_EDITS << " per script:" << std::endl;
+	for(size_t size = corpusSize / 64; size <= corpusSize; size *= 4)
+	{
+		std::string source = _bench_generate_corpus(BENCH_CORPUS_FUNCTIONS, seed, size);
+
+		auto start = std::chrono::steady_clock::now();
+		PSincrementalScript* script = ps_incremental_open(source);
+		double compile = _bench_seconds_since(start);
+
+		//each edit retypes a digit inside a function, then adds a comment line and removes it so the lines after it move:
+		std::mt19937 rng(seed);
+		start = std::chrono::steady_clock::now();
+		for(int i = 0; i < BENCH_NUM_EDITS && script->ast; i++)
+		{
+			size_t digit = script->source.find_first_of("123456789", rng() % script->source.size());
+			if(digit == std::string::npos)
+				continue;
+
+			char newDigit = (char)('1' + rng() % 9);
+			ps_incremental_edit(script, digit, 1, std::string_view(&newDigit, 1));
+
+			size_t line = script->source.find('\n', digit) + 1;
+			ps_incremental_edit(script, line, 0, "# edited\n");
+			ps_incremental_edit(script, line, 9, "");
+		}
+		double edit = _bench_seconds_since(start) / (BENCH_NUM_EDITS * 3);
+
+		if(!script->ast)
+		{
+			std::cout << "failed to edit the functions corpus" << std::endl;
+			return -1;
+		}
+
+		std::cout << "\t" << source.size() / 1024 << " KB: " << compile * 1000.0 << " ms to compile, " << edit * 1e6 << " us per edit" << std::endl;
+		ps_incremental_free(script);
+	}
+
+	//load many small object files by reading them, by mapping them and from one archive:
+	std::cout << "loading " << BENCH_NUM_OBJECTS << " object files of " << BENCH_OBJECT_SIZE / 1024 << " KB of source each:" << std::endl;
+	{
+		std::filesystem::path objDir = std::filesystem::temp_directory_path() / "propscript_frontend_bench_objects";
+		std::filesystem::create_directories(objDir);
+
+		std::vector<std::string> objPaths;
+		std::vector<std::string> objNames;
+		std::vector<PSast*> objAsts;
+		for(uint32_t i = 0; i < BENCH_NUM_OBJECTS; i++)
+		{
+			std::string source = _bench_generate_corpus(BENCH_CORPUS_FUNCTIONS, seed + i * BENCH_CORPUS_COUNT, BENCH_OBJECT_SIZE);
+			PSast* ast = ps_parse_source(source);
+			if(!ast)
+			{
+				std::cout << "failed to parse an object's source" << std::endl;
+				return -1;
+			}
+
+			objPaths.push_back((objDir / ("object" + std::to_string(i) + ".psobj")).string());
+			ps_save_ast(objPaths.back(), ast);
+			objNames.push_back("object" + std::to_string(i));
+			objAsts.push_back(ast);
+		}
+
+		std::string archivePath = (objDir / "objects.psar").string();
+		bool archived = ps_save_archive(archivePath, objNames, objAsts);
+		for(PSast* ast : objAsts)
+			ps_free_ast(ast);
+
+		if(!archived)
+		{
+			std::cout << "failed to save the archive" << std::endl;
+			return -1;
+		}
+
+		double bestLoad = 0.0;
+		double bestMap = 0.0;
+		double bestArchiveLoad = 0.0;
+		double bestArchiveMap = 0.0;
+		for(int i = 0; i < BENCH_ITERATIONS; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for(const std::string& path : objPaths)
+				ps_free_ast(ps_load_ast(path));
+			double load = _bench_seconds_since(start);
+
+			start = std::chrono::steady_clock::now();
+			for(const std::string& path : objPaths)
+				ps_unmap_object(ps_map_object(path));
+			double map = _bench_seconds_since(start);
+
+			start = std::chrono::steady_clock::now();
+			PSarchive* archive = ps_open_archive(archivePath);
+			for(const std::string& name : objNames)
+				ps_free_ast(ps_archive_load_ast(archive, name));
+			ps_close_archive(archive);
+			double archiveLoad = _bench_seconds_since(start);
+
+			start = std::chrono::steady_clock::now();
+			archive = ps_open_archive(archivePath);
+			for(const std::string& name : objNames)
+				ps_unmap_object(ps_archive_find(archive, name));
+			ps_close_archive(archive);
+			double archiveMap = _bench_seconds_since(start);
+
+			if(i == 0 || load < bestLoad)
+				bestLoad = load;
+			if(i == 0 || map < bestMap)
+				bestMap = map;
+			if(i == 0 || archiveLoad < bestArchiveLoad)
+				bestArchiveLoad = archiveLoad;
+			if(i == 0 || archiveMap < bestArchiveMap)
+				bestArchiveMap = archiveMap;
+		}
+
+		std::cout << "\tload: " << bestLoad * 1000.0 << " ms, " << bestLoad * 1e6 / BENCH_NUM_OBJECTS << " us per object" << std::endl;
+		std::cout << "\tmap:  " << bestMap * 1000.0 << " ms, " << bestMap * 1e6 / BENCH_NUM_OBJECTS << " us per object" << std::endl;
+		std::cout << "\tload from archive: " << bestArchiveLoad * 1000.0 << " ms, " << bestArchiveLoad * 1e6 / BENCH_NUM_OBJECTS << " us per object" << std::endl;
+		std::cout << "\tfind in archive:   " << bestArchiveMap * 1000.0 << " ms, " << bestArchiveMap * 1e6 / BENCH_NUM_OBJECTS << " us per object" << std::endl;
+
+		std::filesystem::remove_all(objDir);
+	}
+
+	//resolve the functions corpus with every body loaded, and with only the called bodies loaded:
+	std::cout << "loading the functions corpus without its function bodies:" << std::endl;
+	{
+		PSast* ast = ps_parse_source(_bench_generate_corpus(BENCH_CORPUS_FUNCTIONS, seed, corpusSize));
+		if(!ast)
+		{
+			std::cout << "failed to parse the functions corpus" << std::endl;
+			return -1;
+		}
+		ps_compact_ast(ast);
+		ps_save_ast(objPath, ast);
+		ps_free_ast(ast);
+
+		double bestEager = 0.0;
+		double bestLazy = 0.0;
+		double bestMapped = 0.0;
+		size_t lazyBytes = 0;
+		for(int i = 0; i < BENCH_ITERATIONS; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			PSast* loaded = ps_load_ast(objPath);
+			PSprogram* program = loaded ? ps_resolve(loaded) : nullptr;
+			double eager = _bench_seconds_since(start);
+			ps_free_program(program);
+			ps_free_ast(loaded);
+
+			start = std::chrono::steady_clock::now();
+			PSobject* object = ps_load_object(objPath);
+			program = object ? ps_resolve(object) : nullptr;
+			double lazy = _bench_seconds_since(start);
+			if(object)
+			{
+				lazyBytes = object->size;
+				for(uint32_t j = 0; j < object->numFunctions; j++)
+					lazyBytes -= object->functions[j].numNodes * sizeof(PSnode) + object->functions[j].listsSize * sizeof(uint32_t);
+			}
+			ps_free_program(program);
+			ps_unmap_object(object);
+
+			start = std::chrono::steady_clock::now();
+			object = ps_map_object(objPath);
+			program = object ? ps_resolve(object) : nullptr;
+			double mapped = _bench_seconds_since(start);
+			ps_free_program(program);
+			ps_unmap_object(object);
+
+			if(!program)
+			{
+				std::cout << "failed to resolve the functions corpus" << std::endl;
+				return -1;
+			}
+
+			if(i == 0 || eager < bestEager)
+				bestEager = eager;
+			if(i == 0 || lazy < bestLazy)
+				bestLazy = lazy;
+			if(i == 0 || mapped < bestMapped)
+				bestMapped = mapped;
+		}
+
+		size_t objSize = (size_t)std::filesystem::file_size(objPath);
+		std::cout << "	load every body:   " << bestEager * 1000.0 << " ms, " << objSize / 1024 << " KB read" << std::endl;
+		std::cout << "	load lazily:       " << bestLazy * 1000.0 << " ms, " << lazyBytes / 1024 << " KB read" << std::endl;
+		std::cout << "	map and resolve:   " << bestMapped * 1000.0 << " ms" << std::endl;
+	}
+
+	//compile the functions corpus through an empty cache, then again from its entry:
+	std::cout << "compiling the functions corpus through the cache:" << std::endl;
+	{
+		std::filesystem::path cacheDir = std::filesystem::temp_directory_path() / "propscript_frontend_bench_cache";
+		{
+			std::ofstream file(sourcePath, std::ios::binary);
+			file << _bench_generate_corpus(BENCH_CORPUS_FUNCTIONS, seed, corpusSize);
+		}
+
+		double bestMiss = 0.0;
+		double bestHit = 0.0;
+		for(int i = 0; i < BENCH_ITERATIONS; i++)
+		{
+			std::filesystem::remove_all(cacheDir);
+
+			auto start = std::chrono::steady_clock::now();
+			PSast* missed = ps_compile_cached(sourcePath, cacheDir.string());
+			double miss = _bench_seconds_since(start);
+
+			start = std::chrono::steady_clock::now();
+			PSast* hit = ps_compile_cached(sourcePath, cacheDir.string());
+			double hitTime = _bench_seconds_since(start);
+
+			bool compiled = missed && hit && missed->nodePool.size() == hit->nodePool.size();
+			ps_free_ast(missed);
+			ps_free_ast(hit);
+			if(!compiled)
+			{
+				std::cout << "failed to compile the functions corpus through the cache" << std::endl;
+				return -1;
+			}
+
+			if(i == 0 || miss < bestMiss)
+				bestMiss = miss;
+			if(i == 0 || hitTime < bestHit)
+				bestHit = hitTime;
+		}
+
+		std::filesystem::remove_all(cacheDir);
+		std::cout << "	miss: " << bestMiss * 1000.0 << " ms" << std::endl;
+		std::cout << "	hit:  " << bestHit * 1000.0 << " ms, " << bestMiss / bestHit << "x" << std::endl;
+	}
+
+	//save the functions corpus as a .psobj file, packed, and packed and compressed, then load each:
+	std::cout << "packing the functions corpus:" << std::endl;
+	{
+		PSast* ast = ps_parse_source(_bench_generate_corpus(BENCH_CORPUS_FUNCTIONS, seed, corpusSize));
+		if(!ast)
+		{
+			std::cout << "failed to parse the functions corpus" << std::endl;
+			return -1;
+		}
+		ps_fold_constants(ast);
+		ps_compact_ast(ast);
+
+		const char* formatNames[] = {".psobj:           ", "packed:           ", "packed, compressed:"};
+		for(int format = 0; format < 3; format++)
+		{
+			double save = 0.0;
+			double load = 0.0;
+			for(int i = 0; i < BENCH_ITERATIONS; i++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				if(format == 0)
+					ps_save_ast(objPath, ast);
+				else
+					ps_save_packed_ast(objPath, ast, format == 2);
+				double saveTime = _bench_seconds_since(start);
+
+				start = std::chrono::steady_clock::now();
+				PSast* loaded = ps_load_ast(objPath);
+				double loadTime = _bench_seconds_since(start);
+				if(!loaded || loaded->nodePool.size() != ast->nodePool.size())
+				{
+					std::cout << "failed to load the saved functions corpus" << std::endl;
+					return -1;
+				}
+				ps_free_ast(loaded);
+
+				if(i == 0 || saveTime < save)
+					save = saveTime;
+				if(i == 0 || loadTime < load)
+					load = loadTime;
+			}
+
+			size_t size = (size_t)std::filesystem::file_size(objPath);
+			std::cout << "\t" << formatNames[format] << " " << size / 1024 << " KB, " << (double)size / ast->nodePool.size() << " bytes/node, save "
+			          << save * 1000.0 << " ms, load " << load * 1000.0 << " ms" << std::endl;
+		}
+
+		ps_free_ast(ast);
+	}
+
+	std::remove(sourcePath.c_str());
+	std::remove(objPath.c_str());
+
+	return 0;
+}
@@ -0,0 +1,109 @@
+#include "propscript.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+#define BENCH_CORPUS_SIZE (32 * 1024 * 1024)
+#define BENCH_ITERATIONS  5
+
+//generates a deterministic script with a mix of indentation, comments, identifiers, numbers and operators
+//sparse scripts have long comments, identifiers and indentation, so scanning dominates over emitting tokens
+static std::string _bench_generate_corpus(size_t size, bool sparse)
+{
+	const char* names[] = {"x", "i", "count", "position", "velocity_x", "accumulated_distance", "is_prime", "normalize_vector"};
+	const char* ops[] = {" + ", " - ", " * ", " / ", " % ", " == ", " <= ", " and "};
+
+	std::mt19937 rng(1234);
+	std::string source;
+	source.reserve(size + 256);
+
+	while(source.size() < size)
+	{
+		int indent = rng() % 4;
+		source.append(indent * (sparse ? 16 : 4), ' ');
+
+		if(sparse)
+		{
+			if(rng() % 2 == 0)
+				source += "# this is a much longer comment, explaining in detail what the next several lines of the script are doing and why\n";
+			else
+				source += "accumulated_distance_travelled_by_the_player = accumulated_distance_travelled_by_the_player + current_frame_distance\n";
+
+			continue;
+		}
+
+		switch(rng() % 5)
+		{
+		case 0:
+			source += "# this comment describes what the next few lines of the script are doing\n";
+			break;
+		case 1:
+			source += "for i in range(0, " + std::to_string(rng() % 1000) + ")\n";
+			break;
+		case 2:
+			source += std::string("if ") + names[rng() % 8] + ops[rng() % 8] + names[rng() % 8] + "\n";
+			break;
+		default:
+			source += std::string(names[rng() % 8]) + " = " + names[rng() % 8] + ops[rng() % 8] + std::to_string(rng() % 100000) + "." +
+			          std::to_string(rng() % 100) + ops[rng() % 8] + names[rng() % 8] + "(vec3(1.0, 2.0, 3.0))\n";
+			break;
+		}
+	}
+
+	return source;
+}
+
+//returns the best throughput in MB/s of lexing the source with the given instruction set
+static double _bench_lex(const std::string& source, PSlexerSimd simd, size_t* numTokens)
+{
+	ps_lex_set_simd(simd);
+
+	double bestSeconds = 0.0;
+	for(int i = 0; i < BENCH_ITERATIONS; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		PStokenBuffer tokens = ps_lex_buffer(source.data(), source.size());
+		auto end = std::chrono::steady_clock::now();
+
+		*numTokens = tokens.size();
+		double seconds = std::chrono::duration<double>(end - start).count();
+		if(i == 0 || seconds < bestSeconds)
+			bestSeconds = seconds;
+	}
+
+	return (source.size() / (1024.0 * 1024.0)) / bestSeconds;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+int main()
+{
+	const char* simdNames[] = {"scalar", "sse2", "avx2"};
+	const char* corpusNames[] = {"typical", "sparse"};
+
+	ps_lex_set_simd(PSlexerSimd::AVX2);
+	PSlexerSimd best = ps_lex_get_simd();
+
+	for(int corpus = 0; corpus < 2; corpus++)
+	{
+		std::string source = _bench_generate_corpus(BENCH_CORPUS_SIZE, corpus == 1);
+		std::cout << "lexing " << source.size() / (1024 * 1024) << " MB of " << corpusNames[corpus] << " source, best of " << BENCH_ITERATIONS << " runs" << std::endl;
+
+		double scalarSpeed = 0.0;
+		for(int i = 0; i <= (int)best; i++)
+		{
+			size_t numTokens;
+			double speed = _bench_lex(source, (PSlexerSimd)i, &numTokens);
+			if(i == 0)
+				scalarSpeed = speed;
+
+			std::cout << "\t" << simdNames[i] << ": " << speed << " MB/s, " << numTokens << " tokens, " << speed / scalarSpeed << "x scalar" << std::endl;
+		}
+	}
+
+	return 0;
+}
@@ -1,9 +1,6 @@
 #ifndef DEFINITIONS_HPP
 #define DEFINITIONS_HPP
 
-#include <vector>
-#include <string>
-
 #define PS_KEYWORD_FUNC     "func"
 #define PS_KEYWORD_RETURN   "ret"
 #define PS_KEYWORD_IF       "if"
@@ -17,14 +14,21 @@
 #define PS_KEYWORD_AND    "and"
 #define PS_KEYWORD_OR     "or"
 
-const std::vector<std::string> PS_KEYWORDS = {
-	PS_KEYWORD_FUNC,
-	PS_KEYWORD_RETURN,
-	PS_KEYWORD_IF,
-	PS_KEYWORD_ELSE,
-	PS_KEYWORD_FOR,
-	PS_KEYWORD_IN
-};
+//keywords as seen by the lexer, used to generate the token types and keyword table: X(token type, string)
+#define PS_KEYWORD_TOKENS(X)                \
+	X(KEYWORD_FUNC,     PS_KEYWORD_FUNC)     \
+	X(KEYWORD_RETURN,   PS_KEYWORD_RETURN)   \
+	X(KEYWORD_IF,       PS_KEYWORD_IF)       \
+	X(KEYWORD_ELSE,     PS_KEYWORD_ELSE)     \
+	X(KEYWORD_FOR,      PS_KEYWORD_FOR)      \
+	X(KEYWORD_BREAK,    PS_KEYWORD_BREAK)    \
+	X(KEYWORD_CONTINUE, PS_KEYWORD_CONTINUE)
+
+//keywords that the parser treats as operators: X(token type, string, operator type)
+#define PS_KEYWORD_OPERATOR_TOKENS(X)  \
+	X(KEYWORD_IN,  PS_KEYWORD_IN,  IN)  \
+	X(KEYWORD_AND, PS_KEYWORD_AND, AND) \
+	X(KEYWORD_OR,  PS_KEYWORD_OR,  OR)
 
 //--------------------------------------------------------------------------------------------------------------------------------//
 
@@ -56,63 +60,34 @@ const std::vector<std::string> PS_KEYWORDS = {
 
 #define PS_COMMENT "#"
 
-//operators as seen by the parser
-const std::vector<std::string> PS_OPERATORS = {
-	PS_OP_ADD,
-	PS_OP_SUB,
-	PS_OP_MULT,
-	PS_OP_DIV,
-	PS_OP_MOD,
-	PS_OP_EQUAL,
-	PS_OP_ADDEQUAL,
-	PS_OP_SUBEQUAL,
-	PS_OP_MULTEQUAL,
-	PS_OP_DIVEQUAL,
-	PS_OP_LESSTHAN,
-	PS_OP_GREATERTHAN,
-	PS_OP_LESSTHANEQUAL,
-	PS_OP_GREATERTHANEQUAL,
-	PS_OP_EQUALITY,
-	PS_OP_NONEQUALITY,
-	PS_KEYWORD_AND,
-	PS_KEYWORD_OR
-};
-
-//operators as seen by the lexer
-const std::vector<std::string> PS_LEXER_OPERATORS = {
-	PS_OP_ADD,
-	PS_OP_SUB,
-	PS_OP_MULT,
-	PS_OP_DIV,
-	PS_OP_MOD,
-	PS_OP_EQUAL,
-	PS_OP_ADDEQUAL,
-	PS_OP_SUBEQUAL,
-	PS_OP_MULTEQUAL,
-	PS_OP_DIVEQUAL,
-	PS_OP_LESSTHAN,
-	PS_OP_GREATERTHAN,
-	PS_OP_LESSTHANEQUAL,
-	PS_OP_GREATERTHANEQUAL,
-	PS_OP_EQUALITY,
-	PS_OP_NONEQUALITY,
-
-	PS_SEPERATOR_PAREN_OPEN,
-	PS_SEPERATOR_PAREN_CLOSE,
-	PS_SEPERATOR_CURLY_OPEN,
-	PS_SEPERATOR_CURLY_CLOSE,
-	PS_SEPERATOR_SQUARE_OPEN,
-	PS_SEPERATOR_SQUARE_CLOSE,
-	PS_SEPERATOR_COMMA,
-
-	PS_COMMENT //added so lexer can easily identify comments
-};
+//operators as seen by the lexer, used to generate the token types and lexer tables: X(token type, string, operator type)
+#define PS_OPERATOR_TOKENS(X)                                   \
+	X(OP_MULT,             PS_OP_MULT,             MULT)             \
+	X(OP_DIV,              PS_OP_DIV,              DIV)              \
+	X(OP_MOD,              PS_OP_MOD,              MOD)              \
+	X(OP_ADD,              PS_OP_ADD,              ADD)              \
+	X(OP_SUB,              PS_OP_SUB,              SUB)              \
+	X(OP_EQUAL,            PS_OP_EQUAL,            EQUAL)            \
+	X(OP_MULTEQUAL,        PS_OP_MULTEQUAL,        MULTEQUAL)        \
+	X(OP_DIVEQUAL,         PS_OP_DIVEQUAL,         DIVEQUAL)         \
+	X(OP_MODEQUAL,         PS_OP_MODEQUAL,         MODEQUAL)         \
+	X(OP_ADDEQUAL,         PS_OP_ADDEQUAL,         ADDEQUAL)         \
+	X(OP_SUBEQUAL,         PS_OP_SUBEQUAL,         SUBEQUAL)         \
+	X(OP_LESSTHAN,         PS_OP_LESSTHAN,         LESSTHAN)         \
+	X(OP_GREATERTHAN,      PS_OP_GREATERTHAN,      GREATERTHAN)      \
+	X(OP_LESSTHANEQUAL,    PS_OP_LESSTHANEQUAL,    LESSTHANEQUAL)    \
+	X(OP_GREATERTHANEQUAL, PS_OP_GREATERTHANEQUAL, GREATERTHANEQUAL) \
+	X(OP_EQUALITY,         PS_OP_EQUALITY,         EQUALITY)         \
+	X(OP_NONEQUALITY,      PS_OP_NONEQUALITY,      NONEQUALITY)
 
-const std::vector<std::string> PS_CLOSED_SEPERATORS = {
-	PS_SEPERATOR_PAREN_CLOSE,
-	PS_SEPERATOR_CURLY_CLOSE,
-	PS_SEPERATOR_SQUARE_CLOSE,
-	PS_SEPERATOR_COMMA
-};
+//seperators as seen by the lexer: X(token type, string)
+#define PS_SEPERATOR_TOKENS(X)                              \
+	X(SEPERATOR_PAREN_OPEN,   PS_SEPERATOR_PAREN_OPEN)   \
+	X(SEPERATOR_PAREN_CLOSE,  PS_SEPERATOR_PAREN_CLOSE)  \
+	X(SEPERATOR_CURLY_OPEN,   PS_SEPERATOR_CURLY_OPEN)   \
+	X(SEPERATOR_CURLY_CLOSE,  PS_SEPERATOR_CURLY_CLOSE)  \
+	X(SEPERATOR_SQUARE_OPEN,  PS_SEPERATOR_SQUARE_OPEN)  \
+	X(SEPERATOR_SQUARE_CLOSE, PS_SEPERATOR_SQUARE_CLOSE) \
+	X(SEPERATOR_COMMA,        PS_SEPERATOR_COMMA)
 
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "propscript.hpp"
 
+#include <algorithm>
 #include <unordered_map>
 #include <iostream>
 
@@ -20,20 +21,116 @@ enum class PSruntimeError
 	INVALID_CONDITION,
 	INVALID_BREAK_CONTINUE,
 	FUNCTION_REDEFINITION,
-	ARGUMENT_NAME_REDEFINITION
+	ARGUMENT_NAME_REDEFINITION,
+	MAX_DEPTH_EXCEEDED,
+	FUNCTION_NOT_LOADED
+};
+
+//a node waiting on the constant folding work stack
+struct PSfoldItem
+{
+	PSnodeHandle handle;
+	enum State : uint8_t
+	{
+		VISIT,          //the node's children have not been folded
+		VISIT_ASSIGNED, //the node is assigned to, only the index into it is folded
+		FOLD            //the node's children are folded, the node itself is next
+	} state;
+};
+
+//a variable visible to the resolver
+struct PSresolvedVar
+{
+	uint32_t slot;
+	uint32_t function; //the function the variable belongs to, 0 for the parent nodes and the function's index + 1 otherwise
+};
+
+//the state of resolving an ast. symbols are bound as their scopes start, and their previous bindings are restored as they end
+struct PSresolver
+{
+	PSprogram* program;
+
+	std::vector<PSresolvedVar> vars; //the variable each symbol names, visible if it belongs to the function being resolved
+	std::vector<uint32_t> functions; //the script function each symbol names, UINT32_MAX if none is visible
+	std::vector<uint32_t> natives;   //the index in the program's natives of each symbol's library function, UINT32_MAX if not called yet
+	std::vector<uint32_t> constants; //the index in the program's constants of each symbol's constant, UINT32_MAX if not read yet
+
+	std::vector<std::pair<uint32_t, PSresolvedVar>> varLog; //each variable declared in an open scope, and the binding it hides
+	std::vector<uint32_t> functionLog;                      //each function defined in an open scope
+
+	uint32_t function = 0;  //the function being resolved
+	uint32_t nextSlot = 0;  //the first unused slot in the frame of the function being resolved
+	uint32_t maxSlots = 0;  //the number of slots the function being resolved needs
+	uint32_t loopDepth = 0; //the number of loops the node being resolved is in, within its function
+
+	std::unordered_map<PSnodeHandle, uint32_t> bodies; //the function table entry of each parent function resolved when first called
+
+	//copies of the library functions and constants the symbols name, bodies resolved later use these in place of the ones set then:
+	std::vector<PSfunctionSignature> libFunctions;
+	std::vector<PSdata> libConstants;
+	std::vector<const PSfunctionSignature*> symbolLibFunctions;
+	std::vector<const PSdata*> symbolConstants;
 };
 
 //executes a set of statements with their own scope
-static void _ps_execute_statements(PSast* ast, const std::vector<PSnodeHandle>& nodes); 
-//evaluates a single statement
-static PSdata _ps_evaluate_statement(PSast* ast, const PSnode& node, std::vector<std::string>& addedFuncs, std::vector<std::string>& addedVars); 
+static void _ps_execute_statements(PSprogram* program, const PSnodeHandle* nodes, uint32_t numNodes);
+//executes a list of statements with their own scope
+static inline void _ps_execute_statements(PSprogram* program, PSnodeList nodes);
+//evaluates a single statement, fails once evaluation is nested too deeply to fit on the native stack
+static inline PSdata _ps_evaluate_statement(PSprogram* program, PSnodeHandle handle, std::vector<uint32_t>& addedFuncs);
+//evaluates a single node, only called through _ps_evaluate_statement
+static PSdata _ps_evaluate_node(PSprogram* program, PSnodeHandle handle, std::vector<uint32_t>& addedFuncs);
 //executes a programmer-defined function
-static inline PSdata _ps_execute_function(PSast* ast, const PSnode& node, std::vector<std::string>& addedFuncs, std::vector<std::string>& addedVars);
-
+static inline PSdata _ps_execute_function(PSprogram* program, PSnodeHandle handle, std::vector<uint32_t>& addedFuncs);
+
+//resolves the ast a view points to, and the object it belongs to if it is not nullptr. returns nullptr on error
+static PSprogram* _ps_resolve(const PSastView& ast, PSobject* object);
+//keeps a program's resolver, so the bodies of functions that are resolved when they are first called see the same bindings
+static void _ps_keep_resolver(PSprogram* program, const std::shared_ptr<PSresolver>& resolver);
+//loads and resolves the body of a function the first time it is called
+static void _ps_resolve_body(PSprogram* program, uint32_t function, const PSnode& call);
+//returns a view of an ast's arrays, valid until the ast is modified
+static PSastView _ps_ast_view(const PSast* ast);
+//looks up the library function and constant each symbol of the ast names
+static void _ps_resolve_symbols(const PSastView& ast);
+
+//resolves a set of statements with their own scope, the functions they define are visible in the whole scope
+static void _ps_resolve_block(PSresolver& resolver, const PSnodeHandle* nodes, uint32_t numNodes, uint32_t depth);
+//resolves a list of statements with their own scope
+static inline void _ps_resolve_block(PSresolver& resolver, PSnodeList nodes, uint32_t depth);
+//resolves a node and its children in the order they are evaluated, variables are declared by the first assignment that executes
+static void _ps_resolve_node(PSresolver& resolver, PSnodeHandle handle, uint32_t depth);
+//resolves the variable an assignment assigns to, declaring it if it is not visible
+static void _ps_resolve_assigned(PSresolver& resolver, PSnodeHandle handle, uint32_t depth);
+//resolves a for loop, its variable and the variables its range declares are in a scope around its code
+static void _ps_resolve_for(PSresolver& resolver, PSnodeHandle handle, uint32_t depth);
+//resolves the body of a function definition, functions only see their parameters and their own variables
+static void _ps_resolve_function(PSresolver& resolver, PSnodeHandle handle, uint32_t depth);
+//declares a variable in the current scope, returns its slot
+static inline uint32_t _ps_declare(PSresolver& resolver, uint32_t symbol);
+//returns the slot of the variable a symbol names in the function being resolved, UINT32_MAX if none is visible
+static inline uint32_t _ps_find_var(PSresolver& resolver, uint32_t symbol);
+//restores the bindings hidden by the scopes that started after the given log sizes
+static inline void _ps_end_scope(PSresolver& resolver, size_t varLogStart, size_t functionLogStart);
+
+//folds the constant expressions in a node and its children, without recursing
+static void _ps_fold_node(PSast* ast, PSnodeHandle handle);
+//pushes each node in a list onto the fold stack, so that they are folded in order
+static inline void _ps_push_fold_list(PSast* ast, PSnodeList list);
+//returns whether a node can be replaced with a literal once its children are folded
+static inline bool _ps_foldable(PSast* ast, const PSnode& node);
+//returns whether every node in a list is a literal
+static inline bool _ps_all_literals(PSast* ast, PSnodeList list);
+//evaluates a node whose operands are all literals and replaces it with a literal of the result, leaves it if evaluating fails
+static void _ps_fold_value(PSast* ast, PSnodeHandle handle);
+//returns the value of a literal node
+static inline PSdata _ps_literal_value(const PSdata* constants, const PSnode& node);
 //gets the scalar value from a PSdata struct, or throws an error if the data type is not a scalar
 static inline float _ps_get_scalar(PSdata data, PSruntimeError potentialError, const PSnode& node);
 //throws an exception and sets the global error flags
 static inline void _ps_error(PSruntimeError error, PSnode errorNode);
+//returns the message printed for an error
+static const char* _ps_error_message(PSruntimeError error);
 
 //OPERATOR FUNCTIONS:
 static inline PSdata _ps_mult(const PSdata& left, const PSdata& right, const PSnode& node);
@@ -43,7 +140,8 @@ static inline PSdata _ps_mod (const PSdata& left, const PSdata& right, const PSn
 static inline PSdata _ps_add(const PSdata& left, const PSdata& right, const PSnode& node);
 static inline PSdata _ps_sub(const PSdata& left, const PSdata& right, const PSnode& node);
 
-static inline PSdata _ps_equal(PSast* ast, const PSnode& var, const PSdata& val, std::vector<std::string>& addedFuncs, std::vector<std::string>& addedVars);
+//assigns to a variable, the first assignment to a variable in its scope declares it unless mayDeclare is false
+static inline PSdata _ps_assign(PSprogram* program, PSnodeHandle handle, const PSdata& val, std::vector<uint32_t>& addedFuncs, bool mayDeclare = true);
 
 static inline PSdata _ps_lessthan        (const PSdata& left, const PSdata& right, const PSnode& node);
 static inline PSdata _ps_greaterthan     (const PSdata& left, const PSdata& right, const PSnode& node);
@@ -54,6 +152,12 @@ static inline PSdata _ps_equality        (const PSdata& left, const PSdata& righ
 static inline PSdata _ps_and(const PSdata& left, const PSdata& right, const PSnode& node);
 static inline PSdata _ps_or (const PSdata& left, const PSdata& right, const PSnode& node);
 
+//applies a binary operator that does not assign
+static inline PSdata _ps_apply_op(const PSdata& left, const PSdata& right, const PSnode& node);
+
+//adds bytes to a 64 bit FNV-1a hash
+static uint64_t _ps_hash_bytes(uint64_t hash, const void* data, size_t size);
+
 //DEFAULT LIBRARY FUNCTIONS (more will be added as i need them):
 static PSdata _ps_range(const std::vector<PSdata>& params, const PSnode& node, void* userData);
 static PSdata _ps_print(const std::vector<PSdata>& params, const PSnode& node, void* userData);
@@ -82,23 +186,23 @@ static PSruntimeError g_psError;
 static PSnode g_psErrorNode;
 
 const std::vector<PSfunctionSignature> PS_DEFAULT_LIB_FUNCTIONS = {
-	{"range"     , _ps_range},
-	{"print"     , _ps_print},
-	{"rand"      , _ps_rand},
-	{"int"       , _ps_int},
-	{"vec2"      , _ps_vec2},
-	{"vec3"      , _ps_vec3},
-	{"vec4"      , _ps_vec4},
-	{"quaternion", _ps_quaternion},
-	{"sqrt"      , _ps_sqrt},
-	{"pow"       , _ps_pow},
-	{"abs"       , _ps_abs},
-	{"sin"       , _ps_sin},
-	{"cos"       , _ps_cos},
-	{"tan"       , _ps_tan},
-	{"asin"      , _ps_asin},
-	{"acos"      , _ps_acos},
-	{"atan"      , _ps_atan},
+	{"range"     , _ps_range     , true },
+	{"print"     , _ps_print     , false},
+	{"rand"      , _ps_rand      , false},
+	{"int"       , _ps_int       , true },
+	{"vec2"      , _ps_vec2      , true },
+	{"vec3"      , _ps_vec3      , true },
+	{"vec4"      , _ps_vec4      , true },
+	{"quaternion", _ps_quaternion, true },
+	{"sqrt"      , _ps_sqrt      , true },
+	{"pow"       , _ps_pow       , true },
+	{"abs"       , _ps_abs       , true },
+	{"sin"       , _ps_sin       , true },
+	{"cos"       , _ps_cos       , true },
+	{"tan"       , _ps_tan       , true },
+	{"asin"      , _ps_asin      , true },
+	{"acos"      , _ps_acos      , true },
+	{"atan"      , _ps_atan      , true },
 };
 
 const std::vector<PSconstant> PS_DEFAULT_CONSTANTS = {
@@ -111,10 +215,18 @@ static std::unordered_map<std::string, PSfunctionSignature> g_psLibFunctions;
 static std::unordered_map<std::string, PSdata> g_psConstants;
 static void* g_psLibFunctionUserData = nullptr;
 
-static std::unordered_map<std::string, PSnode> g_psFunctions;
-static std::unordered_map<std::string, PSdata> g_psVariables;
+//the library function and constant each symbol of the executing ast names, nullptr if it names none:
+static std::vector<const PSfunctionSignature*> g_psSymbolLibFunctions;
+static std::vector<const PSdata*> g_psSymbolConstants;
+
+static std::vector<PSfoldItem> g_psFoldStack;
 
-static bool g_psInLoop = false;
+static std::vector<PSdata> g_psSlots;  //the frames of the functions being executed, each holds the variables of its function
+static size_t g_psFrame = 0;            //the first slot of the frame of the function being executed
+static std::vector<uint8_t> g_psDefined; //whether the definition of each script function has executed and its scope has not ended
+
+static uint32_t g_psDepth = 0; //the number of nodes currently being evaluated within each other
+static uint32_t g_psMaxDepth = PS_DEFAULT_MAX_EVAL_DEPTH;
 
 static bool g_psReturnFlag   = false;
 static bool g_psBreakFlag    = false;
@@ -150,12 +262,65 @@ void ps_set_function_user_data(void* userData)
 	g_psLibFunctionUserData = userData;
 }
 
+uint64_t ps_host_hash()
+{
+	if(g_psLibFunctions.size() == 0)
+		ps_set_functions({});
+
+	if(g_psConstants.size() == 0)
+		ps_set_constants({});
+
+	//hash in order of name, map order can differ between processes:
+	std::vector<const PSfunctionSignature*> functions;
+	for(const auto& function : g_psLibFunctions)
+		functions.push_back(&function.second);
+	std::sort(functions.begin(), functions.end(), [](const PSfunctionSignature* a, const PSfunctionSignature* b) { return a->name < b->name; });
+
+	std::vector<const std::pair<const std::string, PSdata>*> constants;
+	for(const auto& constant : g_psConstants)
+		constants.push_back(&constant);
+	std::sort(constants.begin(), constants.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+	uint64_t hash = 14695981039346656037ull; //FNV-1a
+	uint64_t counts[2] = {functions.size(), constants.size()};
+	hash = _ps_hash_bytes(hash, counts, sizeof(counts));
+
+	for(const PSfunctionSignature* function : functions)
+	{
+		uint8_t pure = function->pure;
+		hash = _ps_hash_bytes(hash, function->name.c_str(), function->name.size() + 1);
+		hash = _ps_hash_bytes(hash, &pure, sizeof(pure));
+	}
+
+	//only the bytes the constant's type uses are hashed, the rest is undefined:
+	const size_t valueSizes[] = {0, sizeof(int32_t), sizeof(float), sizeof(qm::vec2), sizeof(qm::vec3), sizeof(qm::vec4), sizeof(qm::quaternion)};
+	for(const auto* constant : constants)
+	{
+		uint32_t type = constant->second.type;
+		hash = _ps_hash_bytes(hash, constant->first.c_str(), constant->first.size() + 1);
+		hash = _ps_hash_bytes(hash, &type, sizeof(type));
+		hash = _ps_hash_bytes(hash, &constant->second.intVal, type < 7 ? valueSizes[type] : 0);
+	}
+
+	return hash;
+}
+
+void ps_set_max_depth(uint32_t maxDepth)
+{
+	g_psMaxDepth = maxDepth;
+}
+
+uint32_t ps_get_max_depth()
+{
+	return g_psMaxDepth;
+}
+
 void ps_throw_invalid_param_error(PSnode node)
 {
 	_ps_error(PSruntimeError::INVALID_PARAMS, node);
 }
 
-void ps_execute(PSast* ast)
+void ps_fold_constants(PSast* ast)
 {
 	if(g_psLibFunctions.size() == 0)
 		ps_set_functions({});
@@ -163,174 +328,322 @@ void ps_execute(PSast* ast)
 	if(g_psConstants.size() == 0)
 		ps_set_constants({});
 
+	_ps_resolve_symbols(_ps_ast_view(ast));
+
+	for(int i = 0; i < ast->parentNodes.size(); i++)
+		_ps_fold_node(ast, ast->parentNodes[i]);
+}
+
+PSprogram* ps_resolve(PSast* ast)
+{
+	return _ps_resolve(_ps_ast_view(ast), nullptr);
+}
+
+PSprogram* ps_resolve(PSobject* object)
+{
+	return _ps_resolve(object->ast, object);
+}
+
+void ps_free_program(PSprogram* program)
+{
+	delete program;
+}
+
+void ps_execute(PSprogram* program)
+{
+	const PSastView& ast = program->ast;
+	g_psSlots.resize(program->numSlots);
+	g_psFrame = 0;
+	g_psDefined.assign(program->functions.size(), false);
+
 	try
 	{
-		_ps_execute_statements(ast, ast->parentNodes);
+		_ps_execute_statements(program, ast.parentNodes, ast.numParentNodes);
 
 		if(g_psReturnFlag)
 			g_psReturnFlag = false;
 	}
 	catch(std::exception e)
 	{
-		std::string errMsg;
-		PSnode testNode = g_psErrorNode;
-		switch(g_psError)
+		std::cout << "PROPSCRIPT RUNTIME ERROR: " << _ps_error_message(g_psError) << " ON LINE " << g_psErrorNode.lineNum << std::endl;
+
+		//there might be unfinished frames and flags if we run into an error:
+		g_psDepth = 0;
+		g_psReturnFlag = false;
+		g_psBreakFlag = false;
+		g_psContinueFlag = false;
+	}
+
+	g_psSlots.clear();
+}
+
+void ps_execute(PSast* ast)
+{
+	PSprogram* program = ps_resolve(ast);
+	if(!program)
+		return;
+
+	ps_execute(program);
+	ps_free_program(program);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static PSprogram* _ps_resolve(const PSastView& ast, PSobject* object)
+{
+	if(g_psLibFunctions.size() == 0)
+		ps_set_functions({});
+
+	if(g_psConstants.size() == 0)
+		ps_set_constants({});
+
+	_ps_resolve_symbols(ast);
+
+	PSprogram* program = new PSprogram;
+	program->ast = ast;
+	program->object = object;
+	program->bindings.resize(ast.numNodes);
+
+	uint32_t numSymbols = ast.numSymbols;
+	std::shared_ptr<PSresolver> state = std::make_shared<PSresolver>();
+	PSresolver& resolver = *state;
+	resolver.program = program;
+	resolver.vars.assign(numSymbols, {0, UINT32_MAX});
+	resolver.functions.assign(numSymbols, UINT32_MAX);
+	resolver.natives.assign(numSymbols, UINT32_MAX);
+	resolver.constants.assign(numSymbols, UINT32_MAX);
+
+	if(object)
+		for(uint32_t i = 0; i < object->numFunctions; i++)
+			resolver.bodies[object->functions[i].definition] = i;
+
+	try
+	{
+		_ps_resolve_block(resolver, ast.parentNodes, ast.numParentNodes, 1);
+		program->numSlots = resolver.maxSlots;
+	}
+	catch(std::exception e)
+	{
+		std::cout << "PROPSCRIPT RESOLVE ERROR: " << _ps_error_message(g_psError) << " ON LINE " << g_psErrorNode.lineNum << std::endl;
+
+		delete program;
+		return nullptr;
+	}
+
+	for(const PSresolvedFunction& function : program->functions)
+		if(function.body != UINT32_MAX)
 		{
-		case PSruntimeError::INVALID_ASSIGNMENT:
-			errMsg = "INVALID ASSIGNMENT";
-			break;
-		case PSruntimeError::INVALID_OP:
-			errMsg = "INVALID OPERATION";
-			break;
-		case PSruntimeError::UNSUPPORTED_NODE_TYPE:
-			errMsg = "UNSUPPORTED NODE TYPE (i must've forgot to implement something in the interpreter)";
-			break;
-		case PSruntimeError::UNDEFINED_VARIABLE:
-			errMsg = "UNDEFINED VARIABLE";
-			break;
-		case PSruntimeError::UNDEFINED_FUNCTION:
-			errMsg = "UNDEFINED FUNCTION";
-			break;
-		case PSruntimeError::INVALID_PARAMS:
-			errMsg = "INVALID PARAMETERS";
-			break;
-		case PSruntimeError::INVALID_INDEX:
-			errMsg = "INVALID INDEX";
-			break;
-		case PSruntimeError::INVALID_CONDITION:
-			errMsg = "INVALID CONDITION";
-			break;
-		case PSruntimeError::INVALID_BREAK_CONTINUE:
-			errMsg = "INVALID BREAK/CONTINUE";
-			break;
-		case PSruntimeError::FUNCTION_REDEFINITION:
-			errMsg = "FUNCTION REDEFINITION";
-			break;
-		case PSruntimeError::ARGUMENT_NAME_REDEFINITION:
-			errMsg = "ARGUMENT NAME REDEFINITION";
+			_ps_keep_resolver(program, state);
 			break;
 		}
 
-		std::cout << "PROPSCRIPT RUNTIME ERROR: " << errMsg << " ON LINE " << g_psErrorNode.lineNum << std::endl;
-	
-		//there might be uncleared vars/funcs if we run into an error:
-		g_psFunctions.clear();
-		g_psVariables.clear();
+	return program;
+}
+
+static void _ps_keep_resolver(PSprogram* program, const std::shared_ptr<PSresolver>& state)
+{
+	PSresolver& resolver = *state;
+	const PSastView& ast = program->ast;
+
+	//parent functions are out of scope after the parent nodes, but visible from every body:
+	for(uint32_t i = 0; i < ast.numParentNodes; i++)
+	{
+		const PSnode& node = ast.nodePool[ast.parentNodes[i]];
+		if(node.type == PSnode::KEYWORD && node.keyword.type == PSnode::Keyword::FUNC)
+			resolver.functions[node.keyword.name] = program->bindings[ast.parentNodes[i]].index;
+	}
+
+	//copy the library functions and constants the symbols name, sized up front so pointers stay valid:
+	uint32_t numSymbols = ast.numSymbols;
+	size_t numLibFunctions = 0;
+	size_t numLibConstants = 0;
+	for(uint32_t i = 0; i < numSymbols; i++)
+	{
+		numLibFunctions += g_psSymbolLibFunctions[i] != nullptr;
+		numLibConstants += g_psSymbolConstants[i] != nullptr;
+	}
+
+	resolver.libFunctions.reserve(numLibFunctions);
+	resolver.libConstants.reserve(numLibConstants);
+	resolver.symbolLibFunctions.assign(numSymbols, nullptr);
+	resolver.symbolConstants.assign(numSymbols, nullptr);
+	for(uint32_t i = 0; i < numSymbols; i++)
+	{
+		if(g_psSymbolLibFunctions[i])
+		{
+			resolver.libFunctions.push_back(*g_psSymbolLibFunctions[i]);
+			resolver.symbolLibFunctions[i] = &resolver.libFunctions.back();
+		}
+
+		if(g_psSymbolConstants[i])
+		{
+			resolver.libConstants.push_back(*g_psSymbolConstants[i]);
+			resolver.symbolConstants[i] = &resolver.libConstants.back();
+		}
+	}
+
+	program->resolver = state;
+}
+
+static void _ps_resolve_body(PSprogram* program, uint32_t function, const PSnode& call)
+{
+	PSresolver& resolver = *program->resolver;
+	if(!ps_object_load_function(program->object, program->functions[function].body))
+		_ps_error(PSruntimeError::FUNCTION_NOT_LOADED, call);
+
+	//resolve the body as if with the parent nodes, seeing only parent functions and its own variables:
+	std::swap(g_psSymbolLibFunctions, resolver.symbolLibFunctions);
+	std::swap(g_psSymbolConstants, resolver.symbolConstants);
+
+	uint32_t restFunction = resolver.function;
+	uint32_t restNextSlot = resolver.nextSlot;
+	uint32_t restMaxSlots = resolver.maxSlots;
+	size_t varLogStart = resolver.varLog.size();
+	size_t functionLogStart = resolver.functionLog.size();
+
+	try
+	{
+		_ps_resolve_function(resolver, program->functions[function].definition, 1);
 	}
+	catch(std::exception e)
+	{
+		//the body is resolved again, and fails again, the next time the function is called:
+		_ps_end_scope(resolver, varLogStart, functionLogStart);
+		resolver.function = restFunction;
+		resolver.nextSlot = restNextSlot;
+		resolver.maxSlots = restMaxSlots;
+		resolver.loopDepth = 0;
+
+		std::swap(g_psSymbolLibFunctions, resolver.symbolLibFunctions);
+		std::swap(g_psSymbolConstants, resolver.symbolConstants);
+		throw;
+	}
+
+	std::swap(g_psSymbolLibFunctions, resolver.symbolLibFunctions);
+	std::swap(g_psSymbolConstants, resolver.symbolConstants);
+
+	//the body might define functions of its own:
+	program->functions[function].body = UINT32_MAX;
+	g_psDefined.resize(program->functions.size(), false);
+}
+
+static PSastView _ps_ast_view(const PSast* ast)
+{
+	PSastView view;
+	view.parentNodes = ast->parentNodes.data();
+	view.numParentNodes = (uint32_t)ast->parentNodes.size();
+	view.nodePool = ast->nodePool.data();
+	view.numNodes = (uint32_t)ast->nodePool.size();
+	view.lists = ast->lists.data();
+	view.symbolNames = ast->symbols.names.data();
+	view.symbolStarts = ast->symbols.offsets.data();
+	view.symbolEnds = ast->symbols.offsets.data() + 1;
+	view.numSymbols = ps_symbol_count(ast->symbols);
+	view.constants = ast->constants.data();
+
+	return view;
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------//
 
-static void _ps_execute_statements(PSast* ast, const std::vector<PSnodeHandle>& nodes)
+static void _ps_execute_statements(PSprogram* program, const PSnodeHandle* nodes, uint32_t numNodes)
 {
-	std::vector<std::string> addedFuncs;				
-	std::vector<std::string> addedVars;
+	std::vector<uint32_t> addedFuncs;
 
-	for(int i = 0; i < nodes.size(); i++)
+	for(int i = 0; i < numNodes; i++)
 	{
-		_ps_evaluate_statement(ast, ast->nodePool[nodes[i]], addedFuncs, addedVars);
+		_ps_evaluate_statement(program, nodes[i], addedFuncs);
 
 		if(g_psReturnFlag || g_psBreakFlag || g_psContinueFlag)
 			break;
 	}
 
 	for(int i = 0; i < addedFuncs.size(); i++)
-		g_psFunctions.erase(addedFuncs[i]);
-	for(int i = 0; i < addedVars.size(); i++)
-		g_psVariables.erase(addedVars[i]);
+		g_psDefined[addedFuncs[i]] = false;
+}
+
+static inline void _ps_execute_statements(PSprogram* program, PSnodeList nodes)
+{
+	_ps_execute_statements(program, program->ast.list_data(nodes), program->ast.list_size(nodes));
 }
 
-static PSdata _ps_evaluate_statement(PSast* ast, const PSnode& node, std::vector<std::string>& addedFuncs, std::vector<std::string>& addedVars)
+static inline PSdata _ps_evaluate_statement(PSprogram* program, PSnodeHandle handle, std::vector<uint32_t>& addedFuncs)
 {
+	//the evaluator recurses on the native stack, so nesting is limited here instead of overflowing it:
+	if(g_psDepth >= g_psMaxDepth)
+		_ps_error(PSruntimeError::MAX_DEPTH_EXCEEDED, program->ast.nodePool[handle]);
+
+	g_psDepth++;
+	PSdata result = _ps_evaluate_node(program, handle, addedFuncs);
+	g_psDepth--;
+
+	return result;
+}
+
+static PSdata _ps_evaluate_node(PSprogram* program, PSnodeHandle handle, std::vector<uint32_t>& addedFuncs)
+{
+	const PSastView& ast = program->ast;
+	const PSnode& node = ast.nodePool[handle];
+
 	switch(node.type)
 	{
 	case PSnode::OP:
 	{
 		if(node.op.type == PSnode::OP::EQUAL)
-			return _ps_equal(ast, ast->nodePool[node.op.left], _ps_evaluate_statement(ast, ast->nodePool[node.op.right], addedFuncs, addedVars), addedFuncs, addedVars);
+			return _ps_assign(program, node.op.left, _ps_evaluate_statement(program, node.op.right, addedFuncs), addedFuncs);
 
-		PSdata left  = _ps_evaluate_statement(ast, ast->nodePool[node.op.left ], addedFuncs, addedVars);
-		PSdata right = _ps_evaluate_statement(ast, ast->nodePool[node.op.right], addedFuncs, addedVars);
+		if(node.op.type == PSnode::OP::NEG)
+			return _ps_mult(PSdata(PSdata::INT, -1), _ps_evaluate_statement(program, node.op.left, addedFuncs), node);
+
+		PSdata left  = _ps_evaluate_statement(program, node.op.left , addedFuncs);
+		PSdata right = _ps_evaluate_statement(program, node.op.right, addedFuncs);
 
 		switch(node.op.type)
 		{
-		case PSnode::OP::MULT:
-			return _ps_mult(left, right, node);
-		case PSnode::OP::DIV:
-			return _ps_div(left, right, node);
-		case PSnode::OP::MOD:
-			return _ps_mod(left, right, node);
-		case PSnode::OP::ADD:
-			return _ps_add(left, right, node);
-		case PSnode::OP::SUB:
-			return _ps_sub(left, right, node);
 		case PSnode::OP::MULTEQUAL:
-			return _ps_equal(ast, ast->nodePool[node.op.left], _ps_mult(left, right, node), addedFuncs, addedVars);
+			return _ps_assign(program, node.op.left, _ps_mult(left, right, node), addedFuncs);
 		case PSnode::OP::DIVEQUAL:
-			return _ps_equal(ast, ast->nodePool[node.op.left], _ps_div(left, right, node), addedFuncs, addedVars);
+			return _ps_assign(program, node.op.left, _ps_div(left, right, node), addedFuncs);
 		case PSnode::OP::MODEQUAL:
-			return _ps_equal(ast, ast->nodePool[node.op.left], _ps_mod(left, right, node), addedFuncs, addedVars);
+			return _ps_assign(program, node.op.left, _ps_mod(left, right, node), addedFuncs);
 		case PSnode::OP::ADDEQUAL:
-			return _ps_equal(ast, ast->nodePool[node.op.left], _ps_add(left, right, node), addedFuncs, addedVars);
+			return _ps_assign(program, node.op.left, _ps_add(left, right, node), addedFuncs);
 		case PSnode::OP::SUBEQUAL:
-			return _ps_equal(ast, ast->nodePool[node.op.left], _ps_sub(left, right, node), addedFuncs, addedVars);
-		case PSnode::OP::LESSTHAN:
-			return _ps_lessthan(left, right, node);
-		case PSnode::OP::GREATERTHAN:
-			return _ps_greaterthan(left, right, node);
-		case PSnode::OP::LESSTHANEQUAL:
-			return _ps_lessthanequal(left, right, node);
-		case PSnode::OP::GREATERTHANEQUAL:
-			return _ps_greaterthanequal(left, right, node);
-		case PSnode::OP::EQUALITY:
-			return _ps_equality(left, right, node);
-		case PSnode::OP::NONEQUALITY:
-		{
-			PSdata equality = _ps_equality(left, right, node);
-			equality.intVal = !equality.intVal;
-			return equality;
-		}
-		case PSnode::OP::AND:
-			return _ps_and(left, right, node);
-		case PSnode::OP::OR:
-			return _ps_or(left, right, node);
+			return _ps_assign(program, node.op.left, _ps_sub(left, right, node), addedFuncs);
 		default:
-			_ps_error(PSruntimeError::UNSUPPORTED_NODE_TYPE, node);
+			return _ps_apply_op(left, right, node);
 		}
-
-		return {};
 	}
 	case PSnode::ID:
 	{
+		const PSbinding& binding = program->bindings[handle];
+		const PSnodeHandle* nodeParams = ast.list_data(node.id.params);
+		uint32_t numParams = ast.list_size(node.id.params);
+
 		if(node.id.type == PSnode::ID::FUNC)
 		{
+			if(binding.type == PSbinding::SCRIPT)
+				return _ps_execute_function(program, handle, addedFuncs);
+
 			std::vector<PSdata> params;
-			for(int i = 0; i < node.id.params.size(); i++)
-				params.push_back(_ps_evaluate_statement(ast, ast->nodePool[node.id.params[i]], addedFuncs, addedVars));
+			for(int i = 0; i < numParams; i++)
+				params.push_back(_ps_evaluate_statement(program, nodeParams[i], addedFuncs));
 
-			if(g_psLibFunctions.count(node.id.name) > 0)
-				return g_psLibFunctions[node.id.name].func(params, node, g_psLibFunctionUserData);
-			else if(g_psFunctions.count(node.id.name) > 0)
-				return _ps_execute_function(ast, node, addedFuncs, addedVars);
-			else
-				_ps_error(PSruntimeError::UNDEFINED_FUNCTION, node);
+			return program->natives[binding.index].func(params, node, g_psLibFunctionUserData);
 		}
 		else
 		{
-			if(g_psConstants.count(node.id.name) == 1)
-				return g_psConstants[node.id.name];
+			if(binding.type == PSbinding::CONSTANT)
+				return program->constants[binding.index];
 
-			if(g_psVariables.count(node.id.name) == 0)
-				_ps_error(PSruntimeError::UNDEFINED_VARIABLE, node);
-
-			PSdata var = g_psVariables[node.id.name];
-			if(node.id.params.size() == 0)
+			PSdata var = g_psSlots[g_psFrame + binding.index];
+			if(numParams == 0)
 				return var;
 
 			if(var.type == PSdata::INT || var.type == PSdata::FLOAT)
 				_ps_error(PSruntimeError::INVALID_INDEX, node);
 
-			PSdata index = _ps_evaluate_statement(ast, ast->nodePool[node.id.params[0]], addedFuncs, addedVars);
+			PSdata index = _ps_evaluate_statement(program, nodeParams[0], addedFuncs);
 			if(index.type != PSdata::INT)
 				_ps_error(PSruntimeError::INVALID_INDEX, node);
 
@@ -348,64 +661,31 @@ static PSdata _ps_evaluate_statement(PSast* ast, const PSnode& node, std::vector
 
 			return result;
 		}
-
-		return {};
 	}
 	case PSnode::NUMBER:
-	{
-		PSdata num;
-
-		if(node.literal.type == PSnode::Literal::INT)
-		{
-			num.type = PSdata::INT;
-			num.intVal = node.literal.intNum;
-		}
-		else
-		{
-			num.type = PSdata::FLOAT;
-			num.floatVal = node.literal.floatNum;
-		}
-
-		return num;
-	}
+		return _ps_literal_value(ast.constants, node);
 	case PSnode::KEYWORD:
 	{
 		switch(node.keyword.type)
 		{
 		case PSnode::Keyword::IF:
 		{
-			PSdata condition = _ps_evaluate_statement(ast, ast->nodePool[node.keyword.condition], addedVars, addedFuncs);
+			PSdata condition = _ps_evaluate_statement(program, node.keyword.condition, addedFuncs);
 			if(_ps_get_scalar(condition, PSruntimeError::INVALID_CONDITION, node) != 0.0f)
-				_ps_execute_statements(ast, node.keyword.code);
+				_ps_execute_statements(program, node.keyword.code);
 			else if(node.keyword.hasElse)
-				_ps_execute_statements(ast, node.keyword.elseCode);
+				_ps_execute_statements(program, node.keyword.elseCode);
 
 			return {};
 		}
 		case PSnode::Keyword::FOR:
 		{
-			if(ast->nodePool[node.keyword.condition].type != PSnode::OP ||
-			   ast->nodePool[node.keyword.condition].op.type != PSnode::OP::IN)
-			   	_ps_error(PSruntimeError::INVALID_CONDITION, node);
-
-			PSnode var = ast->nodePool[ast->nodePool[node.keyword.condition].op.left];
-			if(var.type != PSnode::ID || var.id.type != PSnode::ID::VAR || g_psVariables.count(var.id.name) > 0)
-				_ps_error(PSruntimeError::INVALID_CONDITION, node);
-
-			std::vector<std::string> forFuncs;
-			std::vector<std::string> forVars;
+			const PSnode& condition = ast.nodePool[node.keyword.condition];
 
-			PSdata range = _ps_evaluate_statement(ast, ast->nodePool[ast->nodePool[node.keyword.condition].op.right], forFuncs, forVars);
+			PSdata range = _ps_evaluate_statement(program, condition.op.right, addedFuncs);
 			if(range.type != PSdata::VEC2)
 				_ps_error(PSruntimeError::INVALID_CONDITION, node);
 
-			bool outermostLoop = false;
-			if(!g_psInLoop)
-			{
-				outermostLoop = true;
-				g_psInLoop = true;
-			}
-
 			int32_t min = (int32_t)ceilf (range.vec2Val.x);
 			int32_t max = (int32_t)floorf(range.vec2Val.y);
 			for(int32_t i = min; i <= max; i++)
@@ -413,9 +693,9 @@ static PSdata _ps_evaluate_statement(PSast* ast, const PSnode& node, std::vector
 				PSdata val;
 				val.type = PSdata::INT;
 				val.intVal = i;
-				_ps_equal(ast, var, val, forFuncs, forVars);
+				_ps_assign(program, condition.op.left, val, addedFuncs, i == min);
 
-				_ps_execute_statements(ast, node.keyword.code);
+				_ps_execute_statements(program, node.keyword.code);
 
 				if(g_psBreakFlag)
 				{
@@ -430,23 +710,16 @@ static PSdata _ps_evaluate_statement(PSast* ast, const PSnode& node, std::vector
 				}
 			}
 
-			for(int i = 0; i < forFuncs.size(); i++)
-				g_psFunctions.erase(forFuncs[i]);
-			for(int i = 0; i < forVars.size(); i++)
-				g_psVariables.erase(forVars[i]);
-
-			if(outermostLoop)
-				g_psInLoop = false;
-
 			return {};
 		}
 		case PSnode::Keyword::FUNC:
 		{
-			if(g_psFunctions.count(node.keyword.name) > 0)
+			uint32_t function = program->bindings[handle].index;
+			if(g_psDefined[function])
 				_ps_error(PSruntimeError::FUNCTION_REDEFINITION, node);
 
-			g_psFunctions[node.keyword.name] = node;
-			addedFuncs.push_back(node.keyword.name);
+			g_psDefined[function] = true;
+			addedFuncs.push_back(function);
 
 			return {};
 		}
@@ -455,7 +728,7 @@ static PSdata _ps_evaluate_statement(PSast* ast, const PSnode& node, std::vector
 			g_psReturnFlag = true;
 
 			if(node.keyword.returnVal < UINT32_MAX)
-				g_psReturnVal = _ps_evaluate_statement(ast, ast->nodePool[node.keyword.returnVal], addedFuncs, addedVars);
+				g_psReturnVal = _ps_evaluate_statement(program, node.keyword.returnVal, addedFuncs);
 			else
 				g_psReturnVal = {};
 
@@ -463,17 +736,11 @@ static PSdata _ps_evaluate_statement(PSast* ast, const PSnode& node, std::vector
 		}
 		case PSnode::Keyword::BREAK:
 		{
-			if(!g_psInLoop)
-				_ps_error(PSruntimeError::INVALID_BREAK_CONTINUE, node);
-
 			g_psBreakFlag = true;
 			return {};
 		}
 		case PSnode::Keyword::CONTINUE:
 		{
-			if(!g_psInLoop)
-				_ps_error(PSruntimeError::INVALID_BREAK_CONTINUE, node);
-
 			g_psContinueFlag = true;
 			return {};
 		}
@@ -489,29 +756,36 @@ static PSdata _ps_evaluate_statement(PSast* ast, const PSnode& node, std::vector
 	}
 }
 
-static inline PSdata _ps_execute_function(PSast* ast, const PSnode& node, std::vector<std::string>& addedFuncs, std::vector<std::string>& addedVars)
+static inline PSdata _ps_execute_function(PSprogram* program, PSnodeHandle handle, std::vector<uint32_t>& addedFuncs)
 {
-	PSnode funcNode = g_psFunctions[node.id.name];
+	const PSastView& ast = program->ast;
+	const PSnode& node = ast.nodePool[handle];
+	uint32_t function = program->bindings[handle].index;
 
-	if(funcNode.keyword.paramNames.size() != node.id.params.size())
-		_ps_error(PSruntimeError::INVALID_PARAMS, node);
+	//the parameters are evaluated onto the slot stack, where they become the first slots of the frame:
+	size_t frame = g_psSlots.size();
+	for(uint32_t i = 0; i < program->functions[function].numParams; i++)
+	{
+		PSdata param = _ps_evaluate_statement(program, ast.list_data(node.id.params)[i], addedFuncs);
+		g_psSlots.push_back(param);
+	}
 
-	std::unordered_map<std::string, PSdata> funcVars;
+	if(!g_psDefined[function])
+		_ps_error(PSruntimeError::UNDEFINED_FUNCTION, node);
 
-	for(int i = 0; i < funcNode.keyword.paramNames.size(); i++)
-	{
-		if(funcVars.count(funcNode.keyword.paramNames[i]) > 0)
-			_ps_error(PSruntimeError::ARGUMENT_NAME_REDEFINITION, funcNode);
+	//copied, since resolving bodies adds the functions they define:
+	if(program->functions[function].body != UINT32_MAX)
+		_ps_resolve_body(program, function, node);
+	PSresolvedFunction func = program->functions[function];
 
-		funcVars[funcNode.keyword.paramNames[i]] = _ps_evaluate_statement(ast, ast->nodePool[node.id.params[i]], addedFuncs, addedVars);
-	}
+	size_t callerFrame = g_psFrame;
+	g_psSlots.resize(frame + func.numSlots);
+	g_psFrame = frame;
 
-	funcVars.swap(g_psVariables);
-	_ps_execute_statements(ast, funcNode.keyword.code);
-	funcVars.swap(g_psVariables);
+	_ps_execute_statements(program, ast.nodePool[func.definition].keyword.code);
 
-	for(int i = 0; i < funcNode.keyword.paramNames.size(); i++)
-		g_psVariables.erase(funcNode.keyword.paramNames[i]);
+	g_psFrame = callerFrame;
+	g_psSlots.resize(frame);
 
 	if(g_psReturnFlag)
 	{
@@ -524,6 +798,550 @@ static inline PSdata _ps_execute_function(PSast* ast, const PSnode& node, std::v
 
 //--------------------------------------------------------------------------------------------------------------------------------//
 
+static void _ps_resolve_symbols(const PSastView& ast)
+{
+	uint32_t numSymbols = ast.numSymbols;
+	g_psSymbolLibFunctions.assign(numSymbols, nullptr);
+	g_psSymbolConstants.assign(numSymbols, nullptr);
+
+	for(uint32_t i = 0; i < numSymbols; i++)
+	{
+		std::string name(ast.symbol_name(i));
+
+		auto func = g_psLibFunctions.find(name);
+		if(func != g_psLibFunctions.end())
+			g_psSymbolLibFunctions[i] = &func->second;
+
+		auto constant = g_psConstants.find(name);
+		if(constant != g_psConstants.end())
+			g_psSymbolConstants[i] = &constant->second;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static void _ps_resolve_block(PSresolver& resolver, const PSnodeHandle* nodes, uint32_t numNodes, uint32_t depth)
+{
+	PSprogram* program = resolver.program;
+	const PSastView& ast = program->ast;
+	size_t varLogStart = resolver.varLog.size();
+	size_t functionLogStart = resolver.functionLog.size();
+	uint32_t slotStart = resolver.nextSlot;
+
+	//bind a block's functions up front, calls that run before the definition still fail at runtime:
+	for(uint32_t i = 0; i < numNodes; i++)
+	{
+		const PSnode& node = ast.nodePool[nodes[i]];
+		if(node.type != PSnode::KEYWORD || node.keyword.type != PSnode::Keyword::FUNC)
+			continue;
+
+		if(resolver.functions[node.keyword.name] != UINT32_MAX)
+			_ps_error(PSruntimeError::FUNCTION_REDEFINITION, node);
+
+		resolver.functions[node.keyword.name] = (uint32_t)program->functions.size();
+		resolver.functionLog.push_back(node.keyword.name);
+
+		program->bindings[nodes[i]] = {PSbinding::SCRIPT, (uint32_t)program->functions.size()};
+		program->functions.push_back({nodes[i], ast.list_size(node.keyword.paramNames), 0, UINT32_MAX});
+	}
+
+	for(uint32_t i = 0; i < numNodes; i++)
+		_ps_resolve_node(resolver, nodes[i], depth);
+
+	//the slots of the block's variables are reused by the blocks after it:
+	_ps_end_scope(resolver, varLogStart, functionLogStart);
+	resolver.nextSlot = slotStart;
+}
+
+static inline void _ps_resolve_block(PSresolver& resolver, PSnodeList nodes, uint32_t depth)
+{
+	const PSastView& ast = resolver.program->ast;
+	_ps_resolve_block(resolver, ast.list_data(nodes), ast.list_size(nodes), depth);
+}
+
+static void _ps_resolve_node(PSresolver& resolver, PSnodeHandle handle, uint32_t depth)
+{
+	PSprogram* program = resolver.program;
+	const PSnode& node = program->ast.nodePool[handle];
+
+	//the evaluator fails at the same depth:
+	if(depth > g_psMaxDepth)
+		_ps_error(PSruntimeError::MAX_DEPTH_EXCEEDED, node);
+
+	switch(node.type)
+	{
+	case PSnode::OP:
+	{
+		switch(node.op.type)
+		{
+		case PSnode::OP::EQUAL:
+			_ps_resolve_node(resolver, node.op.right, depth + 1);
+			_ps_resolve_assigned(resolver, node.op.left, depth + 1);
+			break;
+		case PSnode::OP::NEG:
+			_ps_resolve_node(resolver, node.op.left, depth + 1);
+			break;
+		case PSnode::OP::IN: //only valid as a for loop condition
+			_ps_error(PSruntimeError::INVALID_OP, node);
+			break;
+		default:
+		{
+			_ps_resolve_node(resolver, node.op.left, depth + 1);
+			_ps_resolve_node(resolver, node.op.right, depth + 1);
+
+			//compound assignments read their variable first, so it is already bound:
+			const PSnode& left = program->ast.nodePool[node.op.left];
+			if(node.op.type >= PSnode::OP::MULTEQUAL && node.op.type <= PSnode::OP::SUBEQUAL &&
+			   (left.type != PSnode::ID || left.id.type != PSnode::ID::VAR || program->bindings[node.op.left].type != PSbinding::SLOT))
+				_ps_error(PSruntimeError::INVALID_ASSIGNMENT, left);
+			break;
+		}
+		}
+
+		break;
+	}
+	case PSnode::ID:
+	{
+		const PSastView& ast = program->ast;
+		const PSnodeHandle* params = ast.list_data(node.id.params);
+		uint32_t numParams = ast.list_size(node.id.params);
+		uint32_t name = node.id.name;
+
+		if(node.id.type == PSnode::ID::FUNC)
+		{
+			for(uint32_t i = 0; i < numParams; i++)
+				_ps_resolve_node(resolver, params[i], depth + 1);
+
+			//LIBRARY FUNCTIONS TAKE PRECEDENCE OVER SCRIPT FUNCTIONS:
+			if(g_psSymbolLibFunctions[name])
+			{
+				if(resolver.natives[name] == UINT32_MAX)
+				{
+					resolver.natives[name] = (uint32_t)program->natives.size();
+					program->natives.push_back(*g_psSymbolLibFunctions[name]);
+				}
+
+				program->bindings[handle] = {PSbinding::NATIVE, resolver.natives[name]};
+			}
+			else if(resolver.functions[name] != UINT32_MAX)
+			{
+				if(program->functions[resolver.functions[name]].numParams != numParams)
+					_ps_error(PSruntimeError::INVALID_PARAMS, node);
+
+				program->bindings[handle] = {PSbinding::SCRIPT, resolver.functions[name]};
+			}
+			else
+				_ps_error(PSruntimeError::UNDEFINED_FUNCTION, node);
+		}
+		else
+		{
+			//CONSTANTS TAKE PRECEDENCE OVER VARIABLES:
+			//constants ignore indices
+			if(g_psSymbolConstants[name])
+			{
+				if(resolver.constants[name] == UINT32_MAX)
+				{
+					resolver.constants[name] = (uint32_t)program->constants.size();
+					program->constants.push_back(*g_psSymbolConstants[name]);
+				}
+
+				program->bindings[handle] = {PSbinding::CONSTANT, resolver.constants[name]};
+				break;
+			}
+
+			uint32_t slot = _ps_find_var(resolver, name);
+			if(slot == UINT32_MAX)
+				_ps_error(PSruntimeError::UNDEFINED_VARIABLE, node);
+
+			program->bindings[handle] = {PSbinding::SLOT, slot};
+			if(numParams > 0)
+				_ps_resolve_node(resolver, params[0], depth + 1);
+		}
+
+		break;
+	}
+	case PSnode::KEYWORD:
+	{
+		switch(node.keyword.type)
+		{
+		case PSnode::Keyword::IF:
+			_ps_resolve_node(resolver, node.keyword.condition, depth + 1);
+			_ps_resolve_block(resolver, node.keyword.code, depth + 1);
+			if(node.keyword.hasElse)
+				_ps_resolve_block(resolver, node.keyword.elseCode, depth + 1);
+			break;
+		case PSnode::Keyword::FOR:
+			_ps_resolve_for(resolver, handle, depth);
+			break;
+		case PSnode::Keyword::FUNC:
+		{
+			//the bodies of parent functions in an object's function table are resolved when the function is first called:
+			auto body = depth == 1 ? resolver.bodies.find(handle) : resolver.bodies.end();
+			if(body != resolver.bodies.end())
+				program->functions[program->bindings[handle].index].body = body->second;
+			else
+				_ps_resolve_function(resolver, handle, depth);
+			break;
+		}
+		case PSnode::Keyword::RETURN:
+			if(node.keyword.returnVal < UINT32_MAX)
+				_ps_resolve_node(resolver, node.keyword.returnVal, depth + 1);
+			break;
+		case PSnode::Keyword::BREAK:
+		case PSnode::Keyword::CONTINUE:
+			if(resolver.loopDepth == 0)
+				_ps_error(PSruntimeError::INVALID_BREAK_CONTINUE, node);
+			break;
+		default:
+			_ps_error(PSruntimeError::UNSUPPORTED_NODE_TYPE, node);
+		}
+
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static void _ps_resolve_assigned(PSresolver& resolver, PSnodeHandle handle, uint32_t depth)
+{
+	PSprogram* program = resolver.program;
+	const PSnode& var = program->ast.nodePool[handle];
+
+	if(var.type != PSnode::ID || var.id.type != PSnode::ID::VAR || g_psSymbolConstants[var.id.name])
+		_ps_error(PSruntimeError::INVALID_ASSIGNMENT, var);
+
+	uint32_t numParams = program->ast.list_size(var.id.params);
+	uint32_t slot = _ps_find_var(resolver, var.id.name);
+	if(slot != UINT32_MAX)
+	{
+		program->bindings[handle] = {PSbinding::SLOT, slot};
+		if(numParams == 1)
+			_ps_resolve_node(resolver, program->ast.list_data(var.id.params)[0], depth + 1);
+	}
+	else if(numParams != 0)
+		_ps_error(PSruntimeError::INVALID_INDEX, var);
+	else
+		program->bindings[handle] = {PSbinding::DECLARE, _ps_declare(resolver, var.id.name)};
+}
+
+static void _ps_resolve_for(PSresolver& resolver, PSnodeHandle handle, uint32_t depth)
+{
+	PSprogram* program = resolver.program;
+	const PSastView& ast = program->ast;
+	const PSnode& node = ast.nodePool[handle];
+
+	const PSnode& condition = ast.nodePool[node.keyword.condition];
+	if(condition.type != PSnode::OP || condition.op.type != PSnode::OP::IN)
+		_ps_error(PSruntimeError::INVALID_CONDITION, node);
+
+	const PSnode& var = ast.nodePool[condition.op.left];
+	if(var.type != PSnode::ID || var.id.type != PSnode::ID::VAR || g_psSymbolConstants[var.id.name] ||
+	   _ps_find_var(resolver, var.id.name) != UINT32_MAX)
+		_ps_error(PSruntimeError::INVALID_CONDITION, node);
+
+	size_t varLogStart = resolver.varLog.size();
+	uint32_t slotStart = resolver.nextSlot;
+
+	//EVALUATE THE RANGE BEFORE ASSIGNING THE VARIABLE:
+	//the range might declare it
+	_ps_resolve_node(resolver, condition.op.right, depth + 1);
+	_ps_resolve_assigned(resolver, condition.op.left, depth + 1);
+
+	resolver.loopDepth++;
+	_ps_resolve_block(resolver, node.keyword.code, depth + 1);
+	resolver.loopDepth--;
+
+	_ps_end_scope(resolver, varLogStart, resolver.functionLog.size());
+	resolver.nextSlot = slotStart;
+}
+
+static void _ps_resolve_function(PSresolver& resolver, PSnodeHandle handle, uint32_t depth)
+{
+	PSprogram* program = resolver.program;
+	const PSnode& node = program->ast.nodePool[handle];
+	uint32_t function = program->bindings[handle].index;
+
+	uint32_t enclosingFunction = resolver.function;
+	uint32_t enclosingNextSlot = resolver.nextSlot;
+	uint32_t enclosingMaxSlots = resolver.maxSlots;
+	uint32_t enclosingLoopDepth = resolver.loopDepth;
+
+	size_t varLogStart = resolver.varLog.size();
+	resolver.function = function + 1;
+	resolver.nextSlot = 0;
+	resolver.maxSlots = 0;
+	resolver.loopDepth = 0;
+
+	const uint32_t* paramNames = program->ast.list_data(node.keyword.paramNames);
+	for(uint32_t i = 0; i < program->ast.list_size(node.keyword.paramNames); i++)
+	{
+		if(_ps_find_var(resolver, paramNames[i]) != UINT32_MAX)
+			_ps_error(PSruntimeError::ARGUMENT_NAME_REDEFINITION, node);
+
+		_ps_declare(resolver, paramNames[i]);
+	}
+
+	_ps_resolve_block(resolver, node.keyword.code, depth + 1);
+	program->functions[function].numSlots = resolver.maxSlots;
+
+	_ps_end_scope(resolver, varLogStart, resolver.functionLog.size());
+	resolver.function = enclosingFunction;
+	resolver.nextSlot = enclosingNextSlot;
+	resolver.maxSlots = enclosingMaxSlots;
+	resolver.loopDepth = enclosingLoopDepth;
+}
+
+static inline uint32_t _ps_declare(PSresolver& resolver, uint32_t symbol)
+{
+	resolver.varLog.push_back({symbol, resolver.vars[symbol]});
+	resolver.vars[symbol] = {resolver.nextSlot, resolver.function};
+
+	resolver.maxSlots = std::max(resolver.maxSlots, resolver.nextSlot + 1);
+	return resolver.nextSlot++;
+}
+
+static inline uint32_t _ps_find_var(PSresolver& resolver, uint32_t symbol)
+{
+	const PSresolvedVar& var = resolver.vars[symbol];
+	return var.function == resolver.function ? var.slot : UINT32_MAX;
+}
+
+static inline void _ps_end_scope(PSresolver& resolver, size_t varLogStart, size_t functionLogStart)
+{
+	while(resolver.varLog.size() > varLogStart)
+	{
+		resolver.vars[resolver.varLog.back().first] = resolver.varLog.back().second;
+		resolver.varLog.pop_back();
+	}
+
+	while(resolver.functionLog.size() > functionLogStart)
+	{
+		resolver.functions[resolver.functionLog.back()] = UINT32_MAX;
+		resolver.functionLog.pop_back();
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static void _ps_fold_node(PSast* ast, PSnodeHandle handle)
+{
+	g_psFoldStack.clear();
+	g_psFoldStack.push_back({handle, PSfoldItem::VISIT});
+
+	//children are pushed in reverse, so they're folded in the same order as a recursive walk:
+	while(!g_psFoldStack.empty())
+	{
+		PSfoldItem item = g_psFoldStack.back();
+		g_psFoldStack.pop_back();
+		const PSnode& node = ast->nodePool[item.handle];
+
+		if(item.state == PSfoldItem::FOLD)
+		{
+			if(_ps_foldable(ast, node))
+				_ps_fold_value(ast, item.handle);
+			continue;
+		}
+
+		//assigned variables need to stay a variable, only their index is folded:
+		if(item.state == PSfoldItem::VISIT_ASSIGNED && node.type == PSnode::ID)
+		{
+			_ps_push_fold_list(ast, node.id.params);
+			continue;
+		}
+
+		switch(node.type)
+		{
+		case PSnode::OP:
+		{
+			//assignments and for loop conditions need their left side to stay a variable:
+			if(node.op.type == PSnode::OP::IN || (node.op.type >= PSnode::OP::EQUAL && node.op.type <= PSnode::OP::SUBEQUAL))
+			{
+				g_psFoldStack.push_back({node.op.right, PSfoldItem::VISIT});
+				g_psFoldStack.push_back({node.op.left, PSfoldItem::VISIT_ASSIGNED});
+				break;
+			}
+
+			g_psFoldStack.push_back({item.handle, PSfoldItem::FOLD});
+			if(node.op.type != PSnode::OP::NEG)
+				g_psFoldStack.push_back({node.op.right, PSfoldItem::VISIT});
+			g_psFoldStack.push_back({node.op.left, PSfoldItem::VISIT});
+			break;
+		}
+		case PSnode::ID:
+		{
+			g_psFoldStack.push_back({item.handle, PSfoldItem::FOLD});
+			_ps_push_fold_list(ast, node.id.params);
+			break;
+		}
+		case PSnode::KEYWORD:
+		{
+			switch(node.keyword.type)
+			{
+			case PSnode::Keyword::IF:
+			case PSnode::Keyword::FOR:
+				if(node.keyword.hasElse)
+					_ps_push_fold_list(ast, node.keyword.elseCode);
+				_ps_push_fold_list(ast, node.keyword.code);
+				g_psFoldStack.push_back({node.keyword.condition, PSfoldItem::VISIT});
+				break;
+			case PSnode::Keyword::FUNC:
+				_ps_push_fold_list(ast, node.keyword.code);
+				break;
+			case PSnode::Keyword::RETURN:
+				if(node.keyword.returnVal < UINT32_MAX)
+					g_psFoldStack.push_back({node.keyword.returnVal, PSfoldItem::VISIT});
+				break;
+			default:
+				break;
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+static inline void _ps_push_fold_list(PSast* ast, PSnodeList list)
+{
+	for(uint32_t i = ast->list_size(list); i > 0; i--)
+		g_psFoldStack.push_back({ast->list_data(list)[i - 1], PSfoldItem::VISIT});
+}
+
+static inline bool _ps_foldable(PSast* ast, const PSnode& node)
+{
+	switch(node.type)
+	{
+	case PSnode::OP:
+	{
+		if(node.op.type == PSnode::OP::NEG)
+			return ast->nodePool[node.op.left].type == PSnode::NUMBER;
+
+		if(ast->nodePool[node.op.left].type != PSnode::NUMBER || ast->nodePool[node.op.right].type != PSnode::NUMBER)
+			return false;
+
+		//integer division by zero is left to fail at runtime, and only if it is reached:
+		const PSnode& right = ast->nodePool[node.op.right];
+		if(node.op.type == PSnode::OP::DIV || node.op.type == PSnode::OP::MOD)
+			return !(right.literal.type == PSnode::Literal::INT && right.literal.intNum == 0);
+
+		return true;
+	}
+	case PSnode::ID:
+	{
+		if(node.id.type == PSnode::ID::FUNC)
+		{
+			const PSfunctionSignature* func = g_psSymbolLibFunctions[node.id.name];
+			return func && func->pure && _ps_all_literals(ast, node.id.params);
+		}
+		else
+			return g_psSymbolConstants[node.id.name] && ast->list_size(node.id.params) == 0;
+	}
+	default:
+		return false;
+	}
+}
+
+static inline bool _ps_all_literals(PSast* ast, PSnodeList list)
+{
+	for(uint32_t i = 0; i < ast->list_size(list); i++)
+		if(ast->nodePool[ast->list_data(list)[i]].type != PSnode::NUMBER)
+			return false;
+
+	return true;
+}
+
+static void _ps_fold_value(PSast* ast, PSnodeHandle handle)
+{
+	const PSnode& node = ast->nodePool[handle];
+	PSdata value;
+	try
+	{
+		switch(node.type)
+		{
+		case PSnode::OP:
+		{
+			PSdata left = _ps_literal_value(ast->constants.data(), ast->nodePool[node.op.left]);
+			if(node.op.type == PSnode::OP::NEG)
+				value = _ps_mult(PSdata(PSdata::INT, -1), left, node);
+			else
+				value = _ps_apply_op(left, _ps_literal_value(ast->constants.data(), ast->nodePool[node.op.right]), node);
+			break;
+		}
+		case PSnode::ID:
+		{
+			if(node.id.type == PSnode::ID::VAR)
+			{
+				value = *g_psSymbolConstants[node.id.name];
+				break;
+			}
+
+			std::vector<PSdata> params;
+			for(uint32_t i = 0; i < ast->list_size(node.id.params); i++)
+				params.push_back(_ps_literal_value(ast->constants.data(), ast->nodePool[ast->list_data(node.id.params)[i]]));
+
+			value = g_psSymbolLibFunctions[node.id.name]->func(params, node, g_psLibFunctionUserData);
+			break;
+		}
+		default:
+			return;
+		}
+	}
+	catch(std::exception e)
+	{
+		return;
+	}
+
+	PSnode literal;
+	literal.type = PSnode::NUMBER;
+	literal.lineNum = ast->nodePool[handle].lineNum;
+	literal.literal.intNum = 0;
+	literal.literal.floatNum = 0.0f;
+	literal.literal.constant = 0;
+
+	switch(value.type)
+	{
+	case PSdata::VOID:
+		return;
+	case PSdata::INT:
+		literal.literal.type = PSnode::Literal::INT;
+		literal.literal.intNum = value.intVal;
+		break;
+	case PSdata::FLOAT:
+		literal.literal.type = PSnode::Literal::FLOAT;
+		literal.literal.floatNum = value.floatVal;
+		break;
+	default:
+		literal.literal.type = PSnode::Literal::CONSTANT;
+		literal.literal.constant = (uint32_t)ast->constants.size();
+		ast->constants.push_back(value);
+		break;
+	}
+
+	ast->nodePool[handle] = literal;
+}
+
+static inline PSdata _ps_literal_value(const PSdata* constants, const PSnode& node)
+{
+	PSdata num;
+
+	if(node.literal.type == PSnode::Literal::INT)
+	{
+		num.type = PSdata::INT;
+		num.intVal = node.literal.intNum;
+	}
+	else if(node.literal.type == PSnode::Literal::FLOAT)
+	{
+		num.type = PSdata::FLOAT;
+		num.floatVal = node.literal.floatNum;
+	}
+	else
+		num = constants[node.literal.constant];
+
+	return num;
+}
+
 static inline float _ps_get_scalar(PSdata data, PSruntimeError potentialError, const PSnode& node)
 {
 	if(data.type == PSdata::INT)
@@ -543,6 +1361,41 @@ static inline void _ps_error(PSruntimeError error, PSnode errorNode)
 	throw std::exception();
 }
 
+static const char* _ps_error_message(PSruntimeError error)
+{
+	switch(error)
+	{
+	case PSruntimeError::INVALID_ASSIGNMENT:
+		return "INVALID ASSIGNMENT";
+	case PSruntimeError::INVALID_OP:
+		return "INVALID OPERATION";
+	case PSruntimeError::UNSUPPORTED_NODE_TYPE:
+		return "UNSUPPORTED NODE TYPE (i must've forgot to implement something in the interpreter)";
+	case PSruntimeError::UNDEFINED_VARIABLE:
+		return "UNDEFINED VARIABLE";
+	case PSruntimeError::UNDEFINED_FUNCTION:
+		return "UNDEFINED FUNCTION";
+	case PSruntimeError::INVALID_PARAMS:
+		return "INVALID PARAMETERS";
+	case PSruntimeError::INVALID_INDEX:
+		return "INVALID INDEX";
+	case PSruntimeError::INVALID_CONDITION:
+		return "INVALID CONDITION";
+	case PSruntimeError::INVALID_BREAK_CONTINUE:
+		return "INVALID BREAK/CONTINUE";
+	case PSruntimeError::FUNCTION_REDEFINITION:
+		return "FUNCTION REDEFINITION";
+	case PSruntimeError::ARGUMENT_NAME_REDEFINITION:
+		return "ARGUMENT NAME REDEFINITION";
+	case PSruntimeError::MAX_DEPTH_EXCEEDED:
+		return "MAXIMUM DEPTH EXCEEDED";
+	case PSruntimeError::FUNCTION_NOT_LOADED:
+		return "FUNCTION BODY COULD NOT BE LOADED";
+	}
+
+	return "";
+}
+
 //--------------------------------------------------------------------------------------------------------------------------------//
 
 static inline PSdata _ps_mult(const PSdata& left, const PSdata& right, const PSnode& node)
@@ -819,53 +1672,60 @@ static inline PSdata _ps_sub(const PSdata& left, const PSdata& right, const PSno
 	return result;
 }
 
-static inline PSdata _ps_equal(PSast* ast, const PSnode& var, const PSdata& val, std::vector<std::string>& addedFuncs, std::vector<std::string>& addedVars)
+static inline PSdata _ps_assign(PSprogram* program, PSnodeHandle handle, const PSdata& val, std::vector<uint32_t>& addedFuncs, bool mayDeclare)
 {
-	if(var.type != PSnode::ID || var.id.type != PSnode::ID::VAR)
-		_ps_error(PSruntimeError::INVALID_ASSIGNMENT, var);
-			
+	const PSastView& ast = program->ast;
+	const PSnode& var = ast.nodePool[handle];
+	const PSbinding& binding = program->bindings[handle];
+	size_t slot = g_psFrame + binding.index;
+
 	if(val.type == PSdata::VOID)
 		_ps_error(PSruntimeError::INVALID_ASSIGNMENT, var);
 
-	if(g_psVariables.count(var.id.name) > 0)
+	//the resolver found the assignments that create their variable, those take the type of the value:
+	if(binding.type == PSbinding::DECLARE && mayDeclare)
 	{
-		if(g_psVariables[var.id.name].type == PSdata::FLOAT && val.type == PSdata::INT)
-		{
-			g_psVariables[var.id.name].floatVal = (float)val.intVal;
-			return g_psVariables[var.id.name];
-		}
-		else if(var.id.params.size() == 1)
-		{
-			PSdata index = _ps_evaluate_statement(ast, ast->nodePool[var.id.params[0]], addedFuncs, addedVars);
-			if(index.type != PSdata::INT)
-				_ps_error(PSruntimeError::INVALID_INDEX, var);
+		g_psSlots[slot] = val;
+		return val;
+	}
 
-			PSdata* varRef = &g_psVariables[var.id.name];
-			float floatVal = _ps_get_scalar(val, PSruntimeError::INVALID_ASSIGNMENT, var);
+	//the index is evaluated even if unused, so every variable it declares exists afterwards:
+	uint32_t numParams = ast.list_size(var.id.params);
+	PSdata index;
+	if(numParams == 1)
+		index = _ps_evaluate_statement(program, ast.list_data(var.id.params)[0], addedFuncs);
 
-			if(varRef->type == PSdata::VEC2 && index.intVal <= 1)
-				*((float*)&varRef->vec2Val + index.intVal) = floatVal;
-			else if(varRef->type == PSdata::VEC3 && index.intVal <= 2)
-				*((float*)&varRef->vec3Val + index.intVal) = floatVal;
-			else if(varRef->type == PSdata::VEC4 && index.intVal <= 3)
-				*((float*)&varRef->vec4Val + index.intVal) = floatVal;
-			else
-				_ps_error(PSruntimeError::INVALID_INDEX, var);
+	PSdata* varRef = &g_psSlots[slot];
+	if(varRef->type == PSdata::FLOAT && val.type == PSdata::INT)
+	{
+		varRef->floatVal = (float)val.intVal;
+		return *varRef;
+	}
+	else if(numParams == 1)
+	{
+		if(index.type != PSdata::INT)
+			_ps_error(PSruntimeError::INVALID_INDEX, var);
 
-			PSdata result;
-			result.type = PSdata::FLOAT;
-			result.floatVal = floatVal;
-			return result;
-		}
-		else if(g_psVariables[var.id.name].type != val.type)
-			_ps_error(PSruntimeError::INVALID_ASSIGNMENT, var);
+		float floatVal = _ps_get_scalar(val, PSruntimeError::INVALID_ASSIGNMENT, var);
+
+		if(varRef->type == PSdata::VEC2 && index.intVal <= 1)
+			*((float*)&varRef->vec2Val + index.intVal) = floatVal;
+		else if(varRef->type == PSdata::VEC3 && index.intVal <= 2)
+			*((float*)&varRef->vec3Val + index.intVal) = floatVal;
+		else if(varRef->type == PSdata::VEC4 && index.intVal <= 3)
+			*((float*)&varRef->vec4Val + index.intVal) = floatVal;
+		else
+			_ps_error(PSruntimeError::INVALID_INDEX, var);
+
+		PSdata result;
+		result.type = PSdata::FLOAT;
+		result.floatVal = floatVal;
+		return result;
 	}
-	else if(var.id.params.size() != 0)
-		_ps_error(PSruntimeError::INVALID_INDEX, var);
-	else
-		addedVars.push_back(var.id.name);
+	else if(varRef->type != val.type)
+		_ps_error(PSruntimeError::INVALID_ASSIGNMENT, var);
 
-	g_psVariables[var.id.name] = val;
+	*varRef = val;
 	return val;
 }
 
@@ -948,6 +1808,57 @@ static inline PSdata _ps_or (const PSdata& left, const PSdata& right, const PSno
 	return result;	
 }
 
+static inline PSdata _ps_apply_op(const PSdata& left, const PSdata& right, const PSnode& node)
+{
+	switch(node.op.type)
+	{
+	case PSnode::OP::MULT:
+		return _ps_mult(left, right, node);
+	case PSnode::OP::DIV:
+		return _ps_div(left, right, node);
+	case PSnode::OP::MOD:
+		return _ps_mod(left, right, node);
+	case PSnode::OP::ADD:
+		return _ps_add(left, right, node);
+	case PSnode::OP::SUB:
+		return _ps_sub(left, right, node);
+	case PSnode::OP::LESSTHAN:
+		return _ps_lessthan(left, right, node);
+	case PSnode::OP::GREATERTHAN:
+		return _ps_greaterthan(left, right, node);
+	case PSnode::OP::LESSTHANEQUAL:
+		return _ps_lessthanequal(left, right, node);
+	case PSnode::OP::GREATERTHANEQUAL:
+		return _ps_greaterthanequal(left, right, node);
+	case PSnode::OP::EQUALITY:
+		return _ps_equality(left, right, node);
+	case PSnode::OP::NONEQUALITY:
+	{
+		PSdata equality = _ps_equality(left, right, node);
+		equality.intVal = !equality.intVal;
+		return equality;
+	}
+	case PSnode::OP::AND:
+		return _ps_and(left, right, node);
+	case PSnode::OP::OR:
+		return _ps_or(left, right, node);
+	default:
+		_ps_error(PSruntimeError::UNSUPPORTED_NODE_TYPE, node);
+	}
+
+	return {};
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static uint64_t _ps_hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+	for(size_t i = 0; i < size; i++)
+		hash = (hash ^ ((const uint8_t*)data)[i]) * 1099511628211ull;
+
+	return hash;
+}
+
 //--------------------------------------------------------------------------------------------------------------------------------//
 
 static PSdata _ps_range(const std::vector<PSdata>& params, const PSnode& node, void* userData)
@@ -1,165 +1,1545 @@
 #include "propscript.hpp"
 
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
 #include <iostream>
+#include <thread>
 
-//--------------------------------------------------------------------------------------------------------------------------------//
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
 
-//returns whether or not the given character exists in an operator at the given index
-bool is_op_char(char ch, size_t idx);
-//returns whether a given string is an operator
-bool is_op_str(std::string op);
-//adds an id token to the token list if idLen is not 0
-void try_add_id_token(std::string idString, size_t& idLen, uint32_t lineNum, std::vector<PStoken>& tokens);
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define PS_LEXER_SSE2
+	#include <emmintrin.h>
 
-//--------------------------------------------------------------------------------------------------------------------------------//
+	#if defined(__GNUC__) || defined(_MSC_VER)
+		#define PS_LEXER_AVX2
+		#include <immintrin.h>
+	#endif
+#endif
 
-size_t g_maxOpLen;
+#ifdef PS_LEXER_AVX2
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define PS_TARGET_AVX2
+	#else
+		#define PS_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
 
 //--------------------------------------------------------------------------------------------------------------------------------//
 
-std::vector<PStoken> ps_lex_file(std::string path)
+//the class of a source character, determines how the lexer handles it
+enum PScharClass : uint8_t
+{
+	PS_CHAR_ID,
+	PS_CHAR_WHITESPACE,
+	PS_CHAR_NEWLINE,
+	PS_CHAR_OPERATOR
+};
+
+//a token string, used to generate the lexer tables
+struct PStokenString
+{
+	PStoken::Type type;
+	std::string_view str;
+};
+
+#define PS_TOKEN_STRING(type, str, ...) {PStoken::type, str},
+#define PS_TOKEN_STRING_NO_OP(type, str) {PStoken::type, str},
+
+constexpr PStokenString PS_OPERATOR_STRINGS[] = {
+	PS_OPERATOR_TOKENS(PS_TOKEN_STRING)
+	PS_SEPERATOR_TOKENS(PS_TOKEN_STRING_NO_OP)
+	{PStoken::TYPE_COUNT, PS_COMMENT} //comments are recognized like operators, but never emitted
+};
+
+constexpr PStokenString PS_KEYWORD_STRINGS[] = {
+	PS_KEYWORD_OPERATOR_TOKENS(PS_TOKEN_STRING)
+	PS_KEYWORD_TOKENS(PS_TOKEN_STRING_NO_OP)
+};
+
+#undef PS_TOKEN_STRING
+#undef PS_TOKEN_STRING_NO_OP
+
+constexpr uint8_t PS_DFA_NO_ACCEPT = UINT8_MAX;
+constexpr size_t PS_SHORT_RUN_LENGTH = 8;
+constexpr size_t PS_PARALLEL_MIN_CHUNK_SIZE = 1024 * 1024;
+
+//a deterministic finite automaton that recognizes operators, state 0 is the start state and a transition to state 0 means no transition
+struct PSoperatorDFA
+{
+	uint8_t transitions[32][256];
+	uint8_t accept[32]; //the token type accepted in each state, PS_DFA_NO_ACCEPT if none
+};
+
+//a perfect hash table mapping keyword strings to their token types
+struct PSkeywordTable
+{
+	uint32_t seed;
+	uint8_t keywords[32]; //indices into PS_KEYWORD_STRINGS, UINT8_MAX if empty
+	size_t minLen;
+	size_t maxLen;
+};
+
+//the scanning routines for one instruction set, each returns the index of the first matching character at or after start, or size
+struct PSlexScanners
 {
-	//GET MAX OPERATOR LEN:
-	for(int i = 0; i < PS_LEXER_OPERATORS.size(); i++)
-		if(PS_LEXER_OPERATORS[i].length() > g_maxOpLen)
-			g_maxOpLen = PS_LEXER_OPERATORS[i].length();
+	size_t (*whitespace)(const char* source, size_t start, size_t size); //first character that is not whitespace
+	size_t (*comment)(const char* source, size_t start, size_t size);    //first newline
+	size_t (*id)(const char* source, size_t start, size_t size);         //first character that may end an identifier, must be checked against PS_CHAR_CLASSES
+};
+
+//the result of lexing a single token
+enum PSlexResult
+{
+	PS_LEX_TOKEN,     //the maximum number of tokens was lexed
+	PS_LEX_NEED_MORE, //the end of the available source was reached, but more may follow
+	PS_LEX_END,       //the end of the source was reached
+	PS_LEX_ERROR      //an error occured, it has already been reported
+};
+
+//a chunk of a source that is lexed on its own thread
+struct PSlexChunk
+{
+	size_t start;
+	size_t end; //always just past a newline, or the end of the source
 
-	//LEX:
 	std::vector<PStoken> tokens;
-	std::ifstream file(path);
-	if(!file.is_open())
+	size_t numValues;
+	PSsymbolTable symbols;
+	PSlexState state;
+	PSlexResult result;
+
+	size_t tokenBase;                  //the index of the chunk's first token in the whole source
+	size_t valueBase;                  //the index of the chunk's first value in the whole source
+	uint32_t lineBase;                 //the number of lines before the chunk
+	std::vector<uint32_t> symbolRemap; //maps the chunk's symbols to the symbols of the whole source
+};
+
+//lexes up to maxTokens tokens from the source in [base, end) and passes them to emit, source points to the character at base.
+//if final is false, tokens that reach end are not lexed since they may continue past it
+template<typename Emit>
+static inline PSlexResult _ps_lex_tokens(PSlexState& state, PSsymbolTable& symbols, const char* source, size_t base, size_t end, bool final, size_t maxTokens, Emit emit);
+//lexes a large source by splitting it into numChunks chunks and lexing them in parallel, returns false on error
+static bool _ps_lex_parallel(PStokenBuffer& tokens, const char* source, size_t size, size_t numChunks);
+//lexes a single chunk given the number of tokens before it and the type of the last one
+static void _ps_lex_chunk(PSlexChunk& chunk, const char* source, bool final, size_t prevNumTokens, PStoken::Type prevLastType);
+//appends a token to the arrays of a token buffer, the value index must be rebuilt with _ps_index_token_values afterwards
+static inline void _ps_push_token(PStokenBuffer& tokens, const PStoken& token);
+//builds the value mask and offsets of a token buffer from its types
+static void _ps_index_token_values(PStokenBuffer& tokens);
+//updates the value mask and offsets of a token buffer after tokens [first, newEnd) replaced others, moving the tokens after them by delta
+static void _ps_reindex_token_values(PStokenBuffer& tokens, size_t first, size_t newEnd, int64_t delta);
+//returns the index in a token buffer's values of the first value at or after token idx
+static inline size_t _ps_value_index(const PStokenBuffer& tokens, size_t idx);
+//returns the number of newlines in source[start, end)
+static inline uint32_t _ps_count_lines(const char* source, size_t start, size_t end);
+//returns whether tokens of a type have a value stored (identifiers and numbers)
+static inline bool _ps_token_has_value(PStoken::Type type);
+//lexes the next token of a streaming lexer into its window, returns false at the end of the source or on error
+static bool _ps_lexer_lex_token(PSlexer* lexer);
+//discards source that is no longer needed and reads the next chunk, returns false on error
+static bool _ps_lexer_refill(PSlexer* lexer);
+//returns a token with no symbol, its offset is set when it is emitted
+static inline PStoken _ps_make_token(PStoken::Type type, size_t length, uint32_t lineNum);
+//returns the token type of an identifier-like string (keyword or identifier)
+static inline PStoken::Type _ps_keyword_type(std::string_view str);
+//decodes a number literal into a token's type and value, numbers are digits with at most one decimal point
+static inline std::errc _ps_lex_number(std::string_view str, PStoken& token);
+
+//hashes a symbol name
+static inline uint32_t _ps_hash_symbol(std::string_view name);
+//rebuilds the hash table of a symbol table with the given number of buckets
+static void _ps_rehash_symbols(PSsymbolTable& table, size_t numBuckets);
+
+//scalar scanning routines, used when no simd instruction set is available and for the tails of buffers
+static size_t _ps_scan_whitespace_scalar(const char* source, size_t start, size_t size);
+static size_t _ps_scan_comment_scalar(const char* source, size_t start, size_t size);
+static size_t _ps_scan_id_scalar(const char* source, size_t start, size_t size);
+#ifdef PS_LEXER_SSE2
+//sse2 scanning routines, scan 16 bytes at a time
+static size_t _ps_scan_whitespace_sse2(const char* source, size_t start, size_t size);
+static size_t _ps_scan_comment_sse2(const char* source, size_t start, size_t size);
+static size_t _ps_scan_id_sse2(const char* source, size_t start, size_t size);
+#endif
+#ifdef PS_LEXER_AVX2
+//avx2 scanning routines, scan 32 bytes at a time
+PS_TARGET_AVX2 static size_t _ps_scan_whitespace_avx2(const char* source, size_t start, size_t size);
+PS_TARGET_AVX2 static size_t _ps_scan_comment_avx2(const char* source, size_t start, size_t size);
+PS_TARGET_AVX2 static size_t _ps_scan_id_avx2(const char* source, size_t start, size_t size);
+#endif
+//scans up to PS_SHORT_RUN_LENGTH characters of the given class without simd, most runs are short enough to end here
+static inline size_t _ps_scan_short_run(const char* source, size_t start, size_t size, PScharClass charClass);
+//returns the index of the lowest set bit of a nonzero mask
+static inline uint32_t _ps_lowest_bit(uint32_t mask);
+//returns the number of set bits in a mask
+static inline uint32_t _ps_count_bits(uint64_t mask);
+
+//returns the fastest instruction set supported by the cpu
+static PSlexerSimd _ps_best_lex_simd();
+//returns the scanning routines for an instruction set
+static PSlexScanners _ps_get_lex_scanners(PSlexerSimd simd);
+
+//maps a file into memory for reading, returns false on failure
+static bool _ps_map_file(const std::string& path, const char** data, size_t* size);
+//unmaps a file mapped with _ps_map_file
+static void _ps_unmap_file(const char* data, size_t size);
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+//builds the operator DFA from PS_OPERATOR_STRINGS
+static constexpr PSoperatorDFA _ps_build_operator_dfa()
+{
+	PSoperatorDFA dfa = {};
+	for(size_t i = 0; i < 32; i++)
+		dfa.accept[i] = PS_DFA_NO_ACCEPT;
+
+	uint8_t numStates = 1; //running out of states is a compile error since the table is built at compile time
+	for(const PStokenString& op : PS_OPERATOR_STRINGS)
+	{
+		uint8_t state = 0;
+		for(char ch : op.str)
+		{
+			uint8_t& next = dfa.transitions[state][(uint8_t)ch];
+			if(next == 0)
+				next = numStates++;
+
+			state = next;
+		}
+
+		dfa.accept[state] = op.type;
+	}
+
+	return dfa;
+}
+
+//builds the character class table from the operator DFA
+static constexpr std::array<PScharClass, 256> _ps_build_char_classes(const PSoperatorDFA& dfa)
+{
+	std::array<PScharClass, 256> classes = {};
+	for(size_t i = 0; i < 256; i++)
+		classes[i] = dfa.transitions[0][i] != 0 ? PS_CHAR_OPERATOR : PS_CHAR_ID;
+
+	classes[' ' ] = PS_CHAR_WHITESPACE;
+	classes['\t'] = PS_CHAR_WHITESPACE;
+	classes['\v'] = PS_CHAR_WHITESPACE;
+	classes['\f'] = PS_CHAR_WHITESPACE;
+	classes['\r'] = PS_CHAR_WHITESPACE;
+	classes['\n'] = PS_CHAR_NEWLINE;
+
+	return classes;
+}
+
+//hashes a keyword candidate with the given seed, only looks at the first two characters and the length
+static constexpr uint32_t _ps_hash_keyword(std::string_view str, uint32_t seed)
+{
+	uint32_t key = (uint8_t)str[0] | ((uint8_t)str[1] << 8) | ((uint32_t)str.length() << 16);
+	return (key * seed) >> 27;
+}
+
+//searches for a seed that hashes every keyword to a unique slot and builds the keyword table
+static constexpr PSkeywordTable _ps_build_keyword_table()
+{
+	PSkeywordTable table = {};
+	table.minLen = SIZE_MAX;
+	for(const PStokenString& keyword : PS_KEYWORD_STRINGS)
+	{
+		table.minLen = keyword.str.length() < table.minLen ? keyword.str.length() : table.minLen;
+		table.maxLen = keyword.str.length() > table.maxLen ? keyword.str.length() : table.maxLen;
+	}
+
+	for(uint32_t seed = 1; seed < 100000; seed += 2)
+	{
+		for(size_t i = 0; i < 32; i++)
+			table.keywords[i] = UINT8_MAX;
+
+		bool collision = false;
+		for(size_t i = 0; i < std::size(PS_KEYWORD_STRINGS) && !collision; i++)
+		{
+			uint8_t& slot = table.keywords[_ps_hash_keyword(PS_KEYWORD_STRINGS[i].str, seed)];
+			if(slot != UINT8_MAX)
+				collision = true;
+
+			slot = (uint8_t)i;
+		}
+
+		if(!collision)
+		{
+			table.seed = seed;
+			return table;
+		}
+	}
+
+	table.seed = 0;
+	return table;
+}
+
+static constexpr PSoperatorDFA PS_OPERATOR_DFA = _ps_build_operator_dfa();
+static constexpr std::array<PScharClass, 256> PS_CHAR_CLASSES = _ps_build_char_classes(PS_OPERATOR_DFA);
+static constexpr PSkeywordTable PS_KEYWORD_TABLE = _ps_build_keyword_table();
+
+static_assert(PS_KEYWORD_TABLE.seed != 0, "no perfect hash seed found for keyword table");
+
+//returns whether a character may end an identifier, the simd scanners search for these
+static constexpr bool _ps_is_id_boundary_candidate(uint8_t ch)
+{
+	return (ch <= '/' && ch != '.') || (ch >= '<' && ch <= '>') || ch == '[' || ch == ']' || ch == '{' || ch == '}';
+}
+
+//checks that the simd identifier scanners can never skip over a character that ends an identifier
+static constexpr bool _ps_check_id_boundary_candidates()
+{
+	for(size_t i = 0; i < 256; i++)
+		if(PS_CHAR_CLASSES[i] != PS_CHAR_ID && !_ps_is_id_boundary_candidate((uint8_t)i))
+			return false;
+
+	return true;
+}
+
+static_assert(_ps_check_id_boundary_candidates(), "identifier scanners would skip over an operator or whitespace character");
+
+static PSlexerSimd g_psLexSimd = _ps_best_lex_simd();
+static PSlexScanners g_psLexScanners = _ps_get_lex_scanners(g_psLexSimd);
+static uint32_t g_psLexThreads = 0;
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+PStokenBuffer ps_lex_file(std::string path)
+{
+	std::shared_ptr<const char> source;
+	size_t size;
+	if(!ps_map_file(path, &source, &size))
 	{
 		std::cout << "PROPSCRIPT LEX ERROR: FAILED TO OPEN \"" << path << "\" FOR READING" << std::endl;
 		return {};
 	}
 
-	bool inComment = false;
+	PStokenBuffer tokens = ps_lex_buffer(source.get(), size);
+	tokens.sourceOwner = std::move(source);
 
-	uint32_t curLine = 1;
+	return tokens;
+}
+
+bool ps_map_file(const std::string& path, std::shared_ptr<const char>* data, size_t* size)
+{
+	const char* mapping;
+	if(!_ps_map_file(path, &mapping, size))
+		return false;
 
-	std::string idString(64, ' ');
-	size_t idLen = 0;
+	size_t mappingSize = *size;
+	*data = std::shared_ptr<const char>(mapping, [mappingSize](const char* data) { _ps_unmap_file(data, mappingSize); });
+	return true;
+}
+
+PStokenBuffer ps_lex_buffer(const char* source, size_t size)
+{
+	PStokenBuffer tokens;
+	tokens.source = source;
+	tokens.sourceSize = size;
 
-	while(!file.eof())
+	if(size > UINT32_MAX)
 	{
-		char curCh = file.get();
-		if(file.eof())
+		std::cout << "PROPSCRIPT LEX ERROR: SOURCE IS TOO LARGE" << std::endl;
+		return {};
+	}
+
+	//lex large sources in parallel, on error the source is lexed again below so the error is reported normally:
+	size_t numThreads = g_psLexThreads > 0 ? g_psLexThreads : std::max(std::thread::hardware_concurrency(), 1u);
+	size_t numChunks = std::min(numThreads, size / PS_PARALLEL_MIN_CHUNK_SIZE);
+	if(numChunks <= 1 || !_ps_lex_parallel(tokens, source, size, numChunks))
+	{
+		tokens = PStokenBuffer();
+		tokens.source = source;
+		tokens.sourceSize = size;
+
+		tokens.types.reserve(size / 8);
+		tokens.offsets.reserve(size / 8);
+		tokens.lengths.reserve(size / 8);
+		tokens.lineNums.reserve(size / 8);
+		tokens.values.reserve(size / 16);
+
+		PSlexState state;
+		PSlexResult result;
+		do
+		{
+			result = _ps_lex_tokens(state, tokens.symbols, source, 0, size, true, SIZE_MAX, [&tokens](const PStoken& token) {
+				_ps_push_token(tokens, token);
+			});
+		} while(result == PS_LEX_TOKEN); //only returned after the trailing newline
+
+		if(result == PS_LEX_ERROR)
+			return {};
+	}
+
+	_ps_index_token_values(tokens);
+	return tokens;
+}
+
+bool ps_lex_edit(PStokenBuffer& tokens, const char* source, size_t size, size_t offset, size_t removedSize, size_t insertedSize, PStokenEdit* edit)
+{
+	if(size > UINT32_MAX)
+	{
+		std::cout << "PROPSCRIPT LEX ERROR: SOURCE IS TOO LARGE" << std::endl;
+		return false;
+	}
+
+	//tokens never span a newline, so only the lines the edit touches are lexed again:
+	size_t start = offset;
+	while(start > 0 && source[start - 1] != '\n')
+		start--;
+
+	const char* newline = (const char*)memchr(source + offset + insertedSize, '\n', size - offset - insertedSize);
+	size_t end = newline ? newline - source + 1 : size;
+	int64_t sizeDelta = (int64_t)insertedSize - (int64_t)removedSize;
+
+	size_t first = std::lower_bound(tokens.offsets.begin(), tokens.offsets.end(), (uint32_t)start) - tokens.offsets.begin();
+	size_t oldEnd = std::lower_bound(tokens.offsets.begin(), tokens.offsets.end(), (uint32_t)(end - sizeDelta)) - tokens.offsets.begin();
+
+	//find the line the lexed lines start on, from the last token before them:
+	uint32_t startLine = 1;
+	if(first > 0)
+		startLine = tokens.lineNums[first - 1] + _ps_count_lines(source, tokens.offsets[first - 1], start);
+	else
+		startLine = 1 + _ps_count_lines(source, 0, start);
+
+	//lex the lines, and the rest of the source too if the tokens after them wouldn't line up again:
+	std::vector<PStoken> lexed;
+	PSlexState state;
+	while(true)
+	{
+		if(oldEnd + 1 >= tokens.size())
+		{
+			end = size;
+			oldEnd = tokens.size();
+		}
+
+		lexed.clear();
+		state = PSlexState();
+		state.pos = start;
+		state.curLine = startLine;
+		state.numTokens = first;
+		state.lastType = first > 0 ? tokens.types[first - 1] : PStoken::NEWLINE;
+
+		PSlexResult result;
+		do
+		{
+			result = _ps_lex_tokens(state, tokens.symbols, source + start, start, end, end == size, SIZE_MAX, [&lexed](const PStoken& token) {
+				lexed.push_back(token);
+			});
+		} while(result == PS_LEX_TOKEN);
+
+		if(result == PS_LEX_ERROR)
+			return false;
+
+		PStoken::Type oldLastType = oldEnd > 0 ? tokens.types[oldEnd - 1] : PStoken::NEWLINE;
+		if(end == size || (state.lastType == oldLastType && (state.numTokens > 1) == (oldEnd > 1)))
 			break;
 
-		if(curCh == '\n')
+		oldEnd = tokens.size();
+	}
+
+	//the lines after the lexed ones move by the change in their number of lines:
+	int64_t lineDelta = 0;
+	uint32_t endLine = 0;
+	if(oldEnd < tokens.size())
+	{
+		uint32_t gapLines = _ps_count_lines(source, end, (size_t)(tokens.offsets[oldEnd] + sizeDelta));
+		endLine = tokens.lineNums[oldEnd] - gapLines;
+		lineDelta = (int64_t)state.curLine - endLine;
+	}
+
+	//replace the old tokens with the lexed ones and shift the tokens after them:
+	size_t valueFirst = _ps_value_index(tokens, first);
+	size_t valueEnd = _ps_value_index(tokens, oldEnd);
+	std::vector<PStoken::Value> values;
+	for(const PStoken& token : lexed)
+		if(_ps_token_has_value(token.type))
+			values.push_back(token.value);
+
+	if(values.size() != valueEnd - valueFirst)
+	{
+		tokens.values.erase(tokens.values.begin() + valueFirst, tokens.values.begin() + valueEnd);
+		tokens.values.insert(tokens.values.begin() + valueFirst, values.size(), PStoken::Value());
+	}
+	std::copy(values.begin(), values.end(), tokens.values.begin() + valueFirst);
+
+	//(retyping within a line usually keeps the number of tokens, so nothing needs to move)
+	size_t numErased = oldEnd - first;
+	if(lexed.size() != numErased)
+	{
+		tokens.types.erase(tokens.types.begin() + first, tokens.types.begin() + oldEnd);
+		tokens.offsets.erase(tokens.offsets.begin() + first, tokens.offsets.begin() + oldEnd);
+		tokens.lengths.erase(tokens.lengths.begin() + first, tokens.lengths.begin() + oldEnd);
+		tokens.lineNums.erase(tokens.lineNums.begin() + first, tokens.lineNums.begin() + oldEnd);
+
+		tokens.types.insert(tokens.types.begin() + first, lexed.size(), PStoken::NEWLINE);
+		tokens.offsets.insert(tokens.offsets.begin() + first, lexed.size(), 0);
+		tokens.lengths.insert(tokens.lengths.begin() + first, lexed.size(), 0);
+		tokens.lineNums.insert(tokens.lineNums.begin() + first, lexed.size(), 0);
+	}
+
+	for(size_t i = 0; i < lexed.size(); i++)
+	{
+		tokens.types[first + i] = lexed[i].type;
+		tokens.offsets[first + i] = lexed[i].offset;
+		tokens.lengths[first + i] = lexed[i].length;
+		tokens.lineNums[first + i] = lexed[i].lineNum;
+	}
+
+	size_t newEnd = first + lexed.size();
+	if(sizeDelta != 0)
+		for(size_t i = newEnd; i < tokens.size(); i++)
+			tokens.offsets[i] = (uint32_t)(tokens.offsets[i] + sizeDelta);
+	if(lineDelta != 0)
+		for(size_t i = newEnd; i < tokens.size(); i++)
+			tokens.lineNums[i] = (uint32_t)(tokens.lineNums[i] + lineDelta);
+
+	_ps_reindex_token_values(tokens, first, newEnd, (int64_t)newEnd - (int64_t)oldEnd);
+	tokens.source = source;
+	tokens.sourceSize = size;
+	tokens.sourceOwner = nullptr;
+
+	if(edit)
+	{
+		edit->first = (uint32_t)first;
+		edit->oldEnd = (uint32_t)(first + numErased);
+		edit->newEnd = (uint32_t)newEnd;
+		edit->line = endLine;
+		edit->lineDelta = (int32_t)lineDelta;
+	}
+
+	return true;
+}
+
+std::string_view ps_token_str(const PStokenBuffer& tokens, const PStoken& token)
+{
+	return std::string_view(tokens.source + token.offset, token.length);
+}
+
+PStoken PStokenBuffer::operator[](size_t idx) const
+{
+	PStoken token;
+	token.type = types[idx];
+	token.length = lengths[idx];
+	token.offset = offsets[idx];
+	token.lineNum = lineNums[idx];
+
+	//the value's index is the number of values before it in its group plus the group's offset:
+	uint64_t bit = 1ull << (idx % 64);
+	if(valueMask[idx / 64] & bit)
+		token.value = values[valueOffsets[idx / 64] + _ps_count_bits(valueMask[idx / 64] & (bit - 1))];
+	else
+		token.value.symbol = UINT32_MAX;
+
+	return token;
+}
+
+PSlexer* ps_lexer_open_file(std::string path)
+{
+	std::shared_ptr<std::ifstream> file = std::make_shared<std::ifstream>(path, std::ios_base::binary);
+	if(!file->is_open())
+	{
+		std::cout << "PROPSCRIPT LEX ERROR: FAILED TO OPEN \"" << path << "\" FOR READING" << std::endl;
+		return nullptr;
+	}
+
+	return ps_lexer_open_reader([file](char* dest, size_t size) {
+		file->read(dest, size);
+		return (size_t)file->gcount();
+	});
+}
+
+PSlexer* ps_lexer_open_reader(std::function<size_t(char* dest, size_t size)> read)
+{
+	PSlexer* lexer = new PSlexer;
+	lexer->read = read;
+	lexer->chunk.reserve(PS_LEXER_CHUNK_SIZE * 2);
+
+	return lexer;
+}
+
+void ps_lexer_free(PSlexer* lexer)
+{
+	delete lexer;
+}
+
+const PStoken* ps_lexer_next(PSlexer* lexer)
+{
+	const PStoken* token = ps_lexer_token(lexer, lexer->position);
+	if(token)
+		lexer->position++;
+
+	return token;
+}
+
+const PStoken* ps_lexer_peek(PSlexer* lexer, uint32_t n)
+{
+	if(n >= PS_LEXER_WINDOW_SIZE / 2)
+		return nullptr;
+
+	return ps_lexer_token(lexer, lexer->position + n);
+}
+
+const PStoken* ps_lexer_token(PSlexer* lexer, uint32_t idx)
+{
+	if(idx + PS_LEXER_WINDOW_SIZE < lexer->numLexed) //already discarded
+		return nullptr;
+
+	while(idx >= lexer->numLexed)
+		if(!_ps_lexer_lex_token(lexer))
+			return nullptr;
+
+	return &lexer->window[idx & (PS_LEXER_WINDOW_SIZE - 1)];
+}
+
+std::string_view ps_lexer_token_str(const PSlexer* lexer, const PStoken& token)
+{
+	if(token.length == 0)
+		return std::string_view();
+
+	return std::string_view(lexer->chunk.data() + (token.offset - lexer->chunkBase), token.length);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+void ps_lex_set_simd(PSlexerSimd simd)
+{
+	PSlexerSimd best = _ps_best_lex_simd();
+	g_psLexSimd = simd > best ? best : simd;
+	g_psLexScanners = _ps_get_lex_scanners(g_psLexSimd);
+}
+
+PSlexerSimd ps_lex_get_simd()
+{
+	return g_psLexSimd;
+}
+
+void ps_lex_set_threads(uint32_t numThreads)
+{
+	g_psLexThreads = numThreads;
+}
+
+uint32_t ps_lex_get_threads()
+{
+	return g_psLexThreads;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+uint32_t ps_intern_symbol(PSsymbolTable& table, std::string_view name)
+{
+	if(table.offsets.size() == 0)
+		table.offsets.push_back(0);
+
+	if((table.offsets.size() * 2) > table.buckets.size())
+		_ps_rehash_symbols(table, table.buckets.size() == 0 ? 64 : table.buckets.size() * 2);
+
+	//find existing symbol or empty bucket:
+	uint32_t mask = (uint32_t)table.buckets.size() - 1;
+	uint32_t bucket = _ps_hash_symbol(name) & mask;
+	while(table.buckets[bucket] != UINT32_MAX)
+	{
+		if(ps_symbol_name(table, table.buckets[bucket]) == name)
+			return table.buckets[bucket];
+
+		bucket = (bucket + 1) & mask;
+	}
+
+	//add new symbol:
+	uint32_t symbol = ps_symbol_count(table);
+	table.names.append(name.data(), name.length());
+	table.offsets.push_back((uint32_t)table.names.length());
+	table.buckets[bucket] = symbol;
+
+	return symbol;
+}
+
+std::string_view ps_symbol_name(const PSsymbolTable& table, uint32_t symbol)
+{
+	return std::string_view(table.names.data() + table.offsets[symbol], table.offsets[symbol + 1] - table.offsets[symbol]);
+}
+
+uint32_t ps_symbol_count(const PSsymbolTable& table)
+{
+	return table.offsets.size() == 0 ? 0 : (uint32_t)table.offsets.size() - 1;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+template<typename Emit>
+static inline PSlexResult _ps_lex_tokens(PSlexState& state, PSsymbolTable& symbols, const char* source, size_t base, size_t end, bool final, size_t maxTokens, Emit emit)
+{
+	//indices are relative to source, token offsets and state.pos are relative to the start of the whole source:
+	size_t i = state.pos - base;
+	size_t size = end - base;
+
+	uint32_t curLine = state.curLine;
+	size_t numTokens = state.numTokens;
+	PStoken::Type lastType = state.lastType;
+	size_t numEmitted = 0;
+
+	auto save_state = [&](size_t pos) {
+		state.pos = base + pos;
+		state.curLine = curLine;
+		state.numTokens = numTokens;
+		state.lastType = lastType;
+	};
+
+	//emits a token starting at offset, returns true if the maximum number of tokens has been reached
+	auto emit_token = [&](PStoken token, size_t offset) {
+		token.offset = (uint32_t)(base + offset);
+		emit(token);
+
+		numTokens++;
+		lastType = token.type;
+		return ++numEmitted >= maxTokens;
+	};
+
+	if(state.inComment)
+	{
+		i = g_psLexScanners.comment(source, i, size);
+		if(i == size && !final)
 		{
-			try_add_id_token(idString, idLen, curLine, tokens);
+			save_state(size);
+			return PS_LEX_NEED_MORE;
+		}
+
+		state.inComment = false;
+	}
+
+	while(i < size)
+	{
+		char curCh = source[i];
 
+		switch(PS_CHAR_CLASSES[(uint8_t)curCh])
+		{
+		case PS_CHAR_NEWLINE:
+		{
 			//remove duplicate newlines:
-			if(tokens.size() > 1 && tokens[tokens.size() - 1].type != PStoken::NEWLINE)
+			if(numTokens > 1 && lastType != PStoken::NEWLINE && emit_token(_ps_make_token(PStoken::NEWLINE, 0, curLine), i))
 			{
-				PStoken newlineToken;
-				newlineToken.type = PStoken::NEWLINE;
-				newlineToken.lineNum = curLine;
-				tokens.push_back(newlineToken);
+				curLine++;
+				save_state(i + 1);
+				return PS_LEX_TOKEN;
 			}
 
-			inComment = false;
 			curLine++;
+			i++;
+			break;
 		}
-		else if(inComment)
+		case PS_CHAR_WHITESPACE:
 		{
-			continue;
+			size_t wsEnd = _ps_scan_short_run(source, i + 1, size, PS_CHAR_WHITESPACE);
+			if(wsEnd < size && PS_CHAR_CLASSES[(uint8_t)source[wsEnd]] == PS_CHAR_WHITESPACE)
+				wsEnd = g_psLexScanners.whitespace(source, wsEnd, size);
+
+			i = wsEnd;
+			break;
 		}
-		else if(std::isspace(curCh))
+		case PS_CHAR_OPERATOR:
 		{
-			try_add_id_token(idString, idLen, curLine, tokens);
-		} 
-		else if(is_op_char(curCh, 0))
-		{
-			try_add_id_token(idString, idLen, curLine, tokens);
+			//run the dfa, keeping track of the longest accepted operator:
+			uint8_t dfaState = 0;
+			size_t opLen = 0;
+			uint8_t opType = PS_DFA_NO_ACCEPT;
+			size_t j = i;
+			for(; j < size; j++)
+			{
+				dfaState = PS_OPERATOR_DFA.transitions[dfaState][(uint8_t)source[j]];
+				if(dfaState == 0)
+					break;
 
-			std::string opString(g_maxOpLen, curCh);
-			size_t opLen = 1;
+				if(PS_OPERATOR_DFA.accept[dfaState] != PS_DFA_NO_ACCEPT)
+				{
+					opLen = j - i + 1;
+					opType = PS_OPERATOR_DFA.accept[dfaState];
+				}
+			}
 
-			while(is_op_char(file.peek(), opLen))
+			if(j == size && !final) //the operator may continue in the next chunk
 			{
-				curCh = file.get();
-				opString[opLen++] = curCh;
+				save_state(i);
+				return PS_LEX_NEED_MORE;
 			}
 
-			while(!is_op_str(opString.substr(0, opLen)))
+			if(opType == PS_DFA_NO_ACCEPT)
 			{
-				opLen--;
-				file.unget();
+				if(!state.quiet)
+					std::cout << "PROPSCRIPT LEX ERROR: INVALID OPERATOR \"" << curCh << "\" ON LINE " << curLine << std::endl;
+				return PS_LEX_ERROR;
 			}
 
-			opString = opString.substr(0, opLen);
+			if(opType == PStoken::TYPE_COUNT) //skip to the end of the comment, the newline is lexed normally
+			{
+				i = g_psLexScanners.comment(source, i + 1, size);
+				if(i == size && !final)
+				{
+					state.inComment = true;
+					save_state(size);
+					return PS_LEX_NEED_MORE;
+				}
+
+				break;
+			}
 
-			if(opString == PS_COMMENT)
-				inComment = true;
-			else if(opLen > 0)
+			if(emit_token(_ps_make_token((PStoken::Type)opType, opLen, curLine), i))
 			{
-				PStoken opToken;
-				opToken.type = PStoken::OP;
-				opToken.str = opString;
-				opToken.lineNum = curLine;
-				tokens.push_back(opToken);
+				save_state(i + opLen);
+				return PS_LEX_TOKEN;
 			}
+
+			i += opLen;
+			break;
 		}
-		else
+		default: //start of an identifier or number, find the end of it
 		{
-			idString[idLen++] = curCh;
-			if(idLen >= idString.length())
-				idString.resize(idString.length() * 2);
+			size_t idEnd = _ps_scan_short_run(source, i + 1, size, PS_CHAR_ID);
+			while(idEnd < size && PS_CHAR_CLASSES[(uint8_t)source[idEnd]] == PS_CHAR_ID)
+				idEnd = g_psLexScanners.id(source, idEnd + 1, size);
+
+			if(idEnd - i > UINT16_MAX)
+			{
+				if(!state.quiet)
+					std::cout << "PROPSCRIPT LEX ERROR: TOKEN TOO LONG ON LINE " << curLine << std::endl;
+				return PS_LEX_ERROR;
+			}
+
+			if(idEnd == size && !final) //the identifier may continue in the next chunk
+			{
+				save_state(i);
+				return PS_LEX_NEED_MORE;
+			}
+
+			std::string_view idString(source + i, idEnd - i);
+			bool isNumber = (idString[0] >= '0' && idString[0] <= '9') || idString[0] == '.';
+			PStoken token = _ps_make_token(isNumber ? PStoken::ID : _ps_keyword_type(idString), idEnd - i, curLine);
+
+			if(isNumber) //numbers are decoded here so the parser doesnt need to, they dont get a symbol
+			{
+				std::errc error = _ps_lex_number(idString, token);
+				if(error != std::errc())
+				{
+					if(!state.quiet)
+					{
+						const char* message = error == std::errc::result_out_of_range ? "NUMBER OUT OF RANGE" : "INVALID NUMBER";
+						std::cout << "PROPSCRIPT LEX ERROR: " << message << " \"" << idString << "\" ON LINE " << curLine << std::endl;
+					}
+					return PS_LEX_ERROR;
+				}
+			}
+			else if(token.type == PStoken::ID)
+				token.value.symbol = ps_intern_symbol(symbols, idString);
+
+			if(emit_token(token, i))
+			{
+				save_state(idEnd);
+				return PS_LEX_TOKEN;
+			}
+
+			i = idEnd;
+			break;
+		}
 		}
 	}
 
-	try_add_id_token(idString, idLen, curLine, tokens);
+	save_state(size);
+	if(!final)
+		return PS_LEX_NEED_MORE;
 
 	//make sure tokens end with newline:
-	if(tokens[tokens.size() - 1].type != PStoken::NEWLINE)
+	if(numTokens > 0 && lastType != PStoken::NEWLINE)
 	{
-		PStoken newlineToken;
-		newlineToken.type = PStoken::NEWLINE;
-		newlineToken.lineNum = curLine;
-		tokens.push_back(newlineToken);
+		emit_token(_ps_make_token(PStoken::NEWLINE, 0, curLine), size);
+		save_state(size);
+		return PS_LEX_TOKEN;
 	}
 
-	file.close();
-	return tokens;
+	return PS_LEX_END;
 }
 
-//--------------------------------------------------------------------------------------------------------------------------------//
+static bool _ps_lex_parallel(PStokenBuffer& tokens, const char* source, size_t size, size_t numChunks)
+{
+	//split the source after newlines, so every chunk starts between tokens:
+	std::vector<PSlexChunk> chunks;
+	size_t start = 0;
+	while(start < size)
+	{
+		size_t end = size;
+		if(chunks.size() + 1 < numChunks)
+		{
+			size_t target = std::max(start, size / numChunks * (chunks.size() + 1));
+			const char* newline = (const char*)memchr(source + target, '\n', size - target);
+			if(newline)
+				end = newline - source + 1;
+		}
+
+		chunks.emplace_back();
+		chunks.back().start = start;
+		chunks.back().end = end;
+		start = end;
+	}
+
+	//lex each chunk on its own thread, assuming the state after a newline that follows 2 tokens:
+	std::vector<std::thread> threads;
+	for(size_t i = 1; i < chunks.size(); i++)
+		threads.emplace_back(_ps_lex_chunk, std::ref(chunks[i]), source, i == chunks.size() - 1, 2, PStoken::NEWLINE);
+
+	_ps_lex_chunk(chunks[0], source, chunks.size() == 1, 0, PStoken::NEWLINE);
+	for(std::thread& thread : threads)
+		thread.join();
 
-bool is_op_char(char ch, size_t idx)
+	//relex chunks that assumed the wrong state, and merge the symbol tables in order:
+	size_t numTokens = 0;
+	size_t numValues = 0;
+	PStoken::Type lastType = PStoken::NEWLINE;
+	uint32_t numLines = 0;
+	for(size_t i = 0; i < chunks.size(); i++)
+	{
+		PSlexChunk& chunk = chunks[i];
+		if(i > 0 && numTokens < 2) //only happens when the first chunks are nearly empty
+			_ps_lex_chunk(chunk, source, i == chunks.size() - 1, numTokens, lastType);
+
+		if(chunk.result == PS_LEX_ERROR)
+			return false;
+
+		chunk.tokenBase = numTokens;
+		chunk.valueBase = numValues;
+		chunk.lineBase = numLines;
+		numTokens += chunk.tokens.size();
+		numValues += chunk.numValues;
+		numLines += chunk.state.curLine - 1;
+		if(chunk.tokens.size() > 0)
+			lastType = chunk.tokens.back().type;
+
+		uint32_t numSymbols = ps_symbol_count(chunk.symbols);
+		chunk.symbolRemap.resize(numSymbols);
+		for(uint32_t j = 0; j < numSymbols; j++)
+			chunk.symbolRemap[j] = ps_intern_symbol(tokens.symbols, ps_symbol_name(chunk.symbols, j));
+	}
+
+	//concatenate the tokens in parallel, rebasing their lines and symbols:
+	tokens.types.resize(numTokens);
+	tokens.offsets.resize(numTokens);
+	tokens.lengths.resize(numTokens);
+	tokens.lineNums.resize(numTokens);
+	tokens.values.resize(numValues);
+	auto copy_chunk = [&tokens](const PSlexChunk& chunk) {
+		size_t valueIdx = chunk.valueBase;
+		for(size_t i = 0; i < chunk.tokens.size(); i++)
+		{
+			const PStoken& token = chunk.tokens[i];
+			size_t idx = chunk.tokenBase + i;
+			tokens.types[idx] = token.type;
+			tokens.offsets[idx] = token.offset;
+			tokens.lengths[idx] = token.length;
+			tokens.lineNums[idx] = token.lineNum + chunk.lineBase;
+
+			if(token.type == PStoken::ID)
+				tokens.values[valueIdx++].symbol = chunk.symbolRemap[token.value.symbol];
+			else if(_ps_token_has_value(token.type))
+				tokens.values[valueIdx++] = token.value;
+		}
+	};
+
+	threads.clear();
+	for(size_t i = 1; i < chunks.size(); i++)
+		threads.emplace_back(copy_chunk, std::cref(chunks[i]));
+
+	copy_chunk(chunks[0]);
+	for(std::thread& thread : threads)
+		thread.join();
+
+	return true;
+}
+
+static void _ps_lex_chunk(PSlexChunk& chunk, const char* source, bool final, size_t prevNumTokens, PStoken::Type prevLastType)
 {
-	for(int i = 0; i < PS_LEXER_OPERATORS.size(); i++)
-		if(PS_LEXER_OPERATORS[i][idx] == ch)
-			return true;
+	chunk.tokens.clear();
+	chunk.tokens.reserve((chunk.end - chunk.start) / 8);
+	chunk.numValues = 0;
+	chunk.symbols = PSsymbolTable();
 
-	return false;
+	chunk.state = PSlexState();
+	chunk.state.pos = chunk.start;
+	chunk.state.numTokens = prevNumTokens;
+	chunk.state.lastType = prevLastType;
+	chunk.state.quiet = true;
+
+	//non-final chunks end in NEED_MORE, since they end with a newline no token is cut off:
+	do
+	{
+		chunk.result = _ps_lex_tokens(chunk.state, chunk.symbols, source + chunk.start, chunk.start, chunk.end, final, SIZE_MAX, [&chunk](const PStoken& token) {
+			chunk.tokens.push_back(token);
+			chunk.numValues += _ps_token_has_value(token.type);
+		});
+	} while(chunk.result == PS_LEX_TOKEN);
+}
+
+static inline void _ps_push_token(PStokenBuffer& tokens, const PStoken& token)
+{
+	tokens.types.push_back(token.type);
+	tokens.offsets.push_back(token.offset);
+	tokens.lengths.push_back(token.length);
+	tokens.lineNums.push_back(token.lineNum);
+	if(_ps_token_has_value(token.type))
+		tokens.values.push_back(token.value);
+}
+
+static void _ps_index_token_values(PStokenBuffer& tokens)
+{
+	size_t numGroups = (tokens.size() + 63) / 64;
+	tokens.valueMask.assign(numGroups, 0);
+	tokens.valueOffsets.resize(numGroups);
+
+	uint32_t numValues = 0;
+	for(size_t i = 0; i < tokens.size(); i++)
+	{
+		if(i % 64 == 0)
+			tokens.valueOffsets[i / 64] = numValues;
+
+		if(_ps_token_has_value(tokens.types[i]))
+		{
+			tokens.valueMask[i / 64] |= 1ull << (i % 64);
+			numValues++;
+		}
+	}
+}
+
+static void _ps_reindex_token_values(PStokenBuffer& tokens, size_t first, size_t newEnd, int64_t delta)
+{
+	size_t firstGroup = first / 64;
+	size_t numGroups = (tokens.size() + 63) / 64;
+	size_t shiftedGroup = (newEnd + 63) / 64;
+	size_t shiftedStart = std::min(shiftedGroup * 64, tokens.size());
+
+	//the groups after the new tokens only hold moved tokens, so their bits are copied 64 at a time:
+	if(delta != 0)
+	{
+		std::vector<uint64_t> oldMask = tokens.valueMask;
+		tokens.valueMask.resize(numGroups);
+		for(size_t group = shiftedGroup; group < numGroups; group++)
+		{
+			size_t bit = (size_t)(group * 64 - delta);
+			size_t word = bit / 64;
+			size_t shift = bit % 64;
+
+			uint64_t bits = oldMask[word] >> shift;
+			if(shift > 0 && word + 1 < oldMask.size())
+				bits |= oldMask[word + 1] << (64 - shift);
+
+			tokens.valueMask[group] = bits;
+		}
+
+		if(tokens.size() % 64 != 0)
+			tokens.valueMask[numGroups - 1] &= (1ull << (tokens.size() % 64)) - 1;
+	}
+
+	//the groups holding the new tokens are built from their types:
+	uint32_t oldNumValues = 0;
+	for(size_t group = firstGroup; group < std::min(shiftedGroup, numGroups); group++)
+	{
+		oldNumValues += _ps_count_bits(tokens.valueMask[group]);
+		tokens.valueMask[group] = 0;
+	}
+
+	uint32_t numValues = 0;
+	for(size_t i = firstGroup * 64; i < shiftedStart; i++)
+	{
+		if(_ps_token_has_value(tokens.types[i]))
+		{
+			tokens.valueMask[i / 64] |= 1ull << (i % 64);
+			numValues++;
+		}
+	}
+
+	//value offsets only change from the new tokens on if their number of values changed:
+	if(delta == 0 && numValues == oldNumValues)
+		return;
+
+	tokens.valueOffsets.resize(numGroups);
+	numValues = firstGroup > 0 ? tokens.valueOffsets[firstGroup - 1] + _ps_count_bits(tokens.valueMask[firstGroup - 1]) : 0;
+	for(size_t group = firstGroup; group < numGroups; group++)
+	{
+		tokens.valueOffsets[group] = numValues;
+		numValues += _ps_count_bits(tokens.valueMask[group]);
+	}
+}
+
+static inline size_t _ps_value_index(const PStokenBuffer& tokens, size_t idx)
+{
+	if(idx >= tokens.size())
+		return tokens.values.size();
+
+	uint64_t bit = 1ull << (idx % 64);
+	return tokens.valueOffsets[idx / 64] + _ps_count_bits(tokens.valueMask[idx / 64] & (bit - 1));
+}
+
+static inline uint32_t _ps_count_lines(const char* source, size_t start, size_t end)
+{
+	return start < end ? (uint32_t)std::count(source + start, source + end, '\n') : 0;
 }
 
-bool is_op_str(std::string str)
+static inline bool _ps_token_has_value(PStoken::Type type)
 {
-	for(int i = 0; i < PS_LEXER_OPERATORS.size(); i++)
-		if(PS_LEXER_OPERATORS[i] == str)
+	return type == PStoken::ID || type == PStoken::NUMBER_INT || type == PStoken::NUMBER_FLOAT;
+}
+
+static bool _ps_lexer_lex_token(PSlexer* lexer)
+{
+	while(!lexer->failed)
+	{
+		PSlexResult result = _ps_lex_tokens(lexer->state, lexer->symbols, lexer->chunk.data(), lexer->chunkBase, lexer->chunkBase + lexer->chunk.size(),
+		                                    lexer->readFinished, 1, [lexer](const PStoken& token) {
+			lexer->window[lexer->numLexed & (PS_LEXER_WINDOW_SIZE - 1)] = token;
+			lexer->numLexed++;
+		});
+
+		switch(result)
+		{
+		case PS_LEX_TOKEN:
 			return true;
+		case PS_LEX_NEED_MORE:
+			if(!_ps_lexer_refill(lexer))
+				lexer->failed = true;
+			break;
+		case PS_LEX_END:
+			return false;
+		case PS_LEX_ERROR:
+			lexer->failed = true;
+			break;
+		}
+	}
 
 	return false;
 }
 
-void try_add_id_token(std::string idString, size_t& idLen, uint32_t lineNum, std::vector<PStoken>& tokens)
+static bool _ps_lexer_refill(PSlexer* lexer)
 {
-	if(idLen <= 0)
-		return;
+	//discard source that is before the oldest token in the window and has already been lexed:
+	size_t keepFrom = lexer->state.pos;
+	if(lexer->numLexed > 0)
+	{
+		uint32_t oldest = lexer->numLexed > PS_LEXER_WINDOW_SIZE ? lexer->numLexed - PS_LEXER_WINDOW_SIZE : 0;
+		size_t oldestOffset = lexer->window[oldest & (PS_LEXER_WINDOW_SIZE - 1)].offset;
+		keepFrom = oldestOffset < keepFrom ? oldestOffset : keepFrom;
+	}
+
+	lexer->chunk.erase(lexer->chunk.begin(), lexer->chunk.begin() + (keepFrom - lexer->chunkBase));
+	lexer->chunkBase = keepFrom;
+
+	//read the next chunk:
+	size_t oldSize = lexer->chunk.size();
+	lexer->chunk.resize(oldSize + PS_LEXER_CHUNK_SIZE);
+	size_t numRead = lexer->read(lexer->chunk.data() + oldSize, PS_LEXER_CHUNK_SIZE);
+	lexer->chunk.resize(oldSize + numRead);
 
-	PStoken idToken;
-	idToken.type = PStoken::ID;
+	if(numRead == 0)
+		lexer->readFinished = true;
 
-	idString = idString.substr(0, idLen);
-	if(idString == PS_KEYWORD_AND || idString == PS_KEYWORD_OR || idString == PS_KEYWORD_IN)
-		idToken.type = PStoken::OP;
+	if(lexer->chunkBase + lexer->chunk.size() > UINT32_MAX)
+	{
+		std::cout << "PROPSCRIPT LEX ERROR: SOURCE IS TOO LARGE" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static inline PStoken _ps_make_token(PStoken::Type type, size_t length, uint32_t lineNum)
+{
+	PStoken token;
+	token.type = type;
+	token.length = (uint16_t)length;
+	token.offset = 0;
+	token.value.symbol = UINT32_MAX;
+	token.lineNum = lineNum;
+
+	return token;
+}
+
+static inline PStoken::Type _ps_keyword_type(std::string_view str)
+{
+	if(str.length() < PS_KEYWORD_TABLE.minLen || str.length() > PS_KEYWORD_TABLE.maxLen)
+		return PStoken::ID;
+
+	uint8_t keyword = PS_KEYWORD_TABLE.keywords[_ps_hash_keyword(str, PS_KEYWORD_TABLE.seed)];
+	if(keyword != UINT8_MAX && PS_KEYWORD_STRINGS[keyword].str == str)
+		return PS_KEYWORD_STRINGS[keyword].type;
+
+	return PStoken::ID;
+}
+
+static inline std::errc _ps_lex_number(std::string_view str, PStoken& token)
+{
+	const char* end = str.data() + str.length();
+	std::from_chars_result result;
+	if(str.find('.') != std::string_view::npos)
+	{
+		token.type = PStoken::NUMBER_FLOAT;
+		result = std::from_chars(str.data(), end, token.value.floatNum, std::chars_format::fixed);
+	}
+	else
+	{
+		token.type = PStoken::NUMBER_INT;
+		result = std::from_chars(str.data(), end, token.value.intNum);
+	}
+
+	if(result.ec == std::errc() && result.ptr != end) //trailing characters, such as a second decimal point
+		return std::errc::invalid_argument;
+
+	return result.ec;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static inline uint32_t _ps_hash_symbol(std::string_view name)
+{
+	uint32_t hash = 2166136261u; //FNV-1a
+	for(size_t i = 0; i < name.length(); i++)
+		hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+
+	return hash;
+}
 
-	idToken.str = idString;
-	idToken.lineNum = lineNum;
-	tokens.push_back(idToken);
-	idLen = 0;
-}
\ No newline at end of file
+static void _ps_rehash_symbols(PSsymbolTable& table, size_t numBuckets)
+{
+	table.buckets.assign(numBuckets, UINT32_MAX);
+
+	uint32_t mask = (uint32_t)numBuckets - 1;
+	for(uint32_t i = 0; i < ps_symbol_count(table); i++)
+	{
+		uint32_t bucket = _ps_hash_symbol(ps_symbol_name(table, i)) & mask;
+		while(table.buckets[bucket] != UINT32_MAX)
+			bucket = (bucket + 1) & mask;
+
+		table.buckets[bucket] = i;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static size_t _ps_scan_whitespace_scalar(const char* source, size_t start, size_t size)
+{
+	while(start < size && PS_CHAR_CLASSES[(uint8_t)source[start]] == PS_CHAR_WHITESPACE)
+		start++;
+
+	return start;
+}
+
+static size_t _ps_scan_comment_scalar(const char* source, size_t start, size_t size)
+{
+	while(start < size && source[start] != '\n')
+		start++;
+
+	return start;
+}
+
+static size_t _ps_scan_id_scalar(const char* source, size_t start, size_t size)
+{
+	while(start < size && PS_CHAR_CLASSES[(uint8_t)source[start]] == PS_CHAR_ID)
+		start++;
+
+	return start;
+}
+
+#ifdef PS_LEXER_SSE2
+
+static size_t _ps_scan_whitespace_sse2(const char* source, size_t start, size_t size)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i controlRange = _mm_set1_epi8('\r' - '\t'); //\t, \n, \v, \f and \r are contiguous
+
+	for(; start + 16 <= size; start += 16)
+	{
+		__m128i chars = _mm_loadu_si128((const __m128i*)(source + start));
+		__m128i control = _mm_sub_epi8(chars, tab);
+		__m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(control, controlRange), control);
+		__m128i isWhitespace = _mm_or_si128(_mm_cmpeq_epi8(chars, space), _mm_andnot_si128(_mm_cmpeq_epi8(chars, newline), isControl));
+
+		uint32_t mask = ~(uint32_t)_mm_movemask_epi8(isWhitespace) & 0xFFFF;
+		if(mask != 0)
+			return start + _ps_lowest_bit(mask);
+	}
+
+	return _ps_scan_whitespace_scalar(source, start, size);
+}
+
+static size_t _ps_scan_comment_sse2(const char* source, size_t start, size_t size)
+{
+	const __m128i newline = _mm_set1_epi8('\n');
+
+	for(; start + 16 <= size; start += 16)
+	{
+		__m128i chars = _mm_loadu_si128((const __m128i*)(source + start));
+
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, newline));
+		if(mask != 0)
+			return start + _ps_lowest_bit(mask);
+	}
+
+	return _ps_scan_comment_scalar(source, start, size);
+}
+
+static size_t _ps_scan_id_sse2(const char* source, size_t start, size_t size)
+{
+	//matches _ps_is_id_boundary_candidate:
+	const __m128i slash = _mm_set1_epi8('/');
+	const __m128i dot = _mm_set1_epi8('.');
+	const __m128i lessThan = _mm_set1_epi8('<');
+	const __m128i compareRange = _mm_set1_epi8('>' - '<');
+	const __m128i squareOpen = _mm_set1_epi8('[');
+	const __m128i squareClose = _mm_set1_epi8(']');
+	const __m128i curlyOpen = _mm_set1_epi8('{');
+	const __m128i curlyClose = _mm_set1_epi8('}');
+
+	for(; start + 16 <= size; start += 16)
+	{
+		__m128i chars = _mm_loadu_si128((const __m128i*)(source + start));
+		__m128i compare = _mm_sub_epi8(chars, lessThan);
+
+		__m128i isLow = _mm_andnot_si128(_mm_cmpeq_epi8(chars, dot), _mm_cmpeq_epi8(_mm_min_epu8(chars, slash), chars));
+		__m128i isCompare = _mm_cmpeq_epi8(_mm_min_epu8(compare, compareRange), compare);
+		__m128i isBracket = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, squareOpen), _mm_cmpeq_epi8(chars, squareClose)),
+		                                 _mm_or_si128(_mm_cmpeq_epi8(chars, curlyOpen), _mm_cmpeq_epi8(chars, curlyClose)));
+
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(isLow, isCompare), isBracket));
+		if(mask != 0)
+			return start + _ps_lowest_bit(mask);
+	}
+
+	return _ps_scan_id_scalar(source, start, size);
+}
+
+#endif
+
+#ifdef PS_LEXER_AVX2
+
+PS_TARGET_AVX2 static size_t _ps_scan_whitespace_avx2(const char* source, size_t start, size_t size)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i newline = _mm256_set1_epi8('\n');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i controlRange = _mm256_set1_epi8('\r' - '\t');
+
+	for(; start + 32 <= size; start += 32)
+	{
+		__m256i chars = _mm256_loadu_si256((const __m256i*)(source + start));
+		__m256i control = _mm256_sub_epi8(chars, tab);
+		__m256i isControl = _mm256_cmpeq_epi8(_mm256_min_epu8(control, controlRange), control);
+		__m256i isWhitespace = _mm256_or_si256(_mm256_cmpeq_epi8(chars, space), _mm256_andnot_si256(_mm256_cmpeq_epi8(chars, newline), isControl));
+
+		uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(isWhitespace);
+		if(mask != 0)
+			return start + _ps_lowest_bit(mask);
+	}
+
+	return _ps_scan_whitespace_sse2(source, start, size);
+}
+
+PS_TARGET_AVX2 static size_t _ps_scan_comment_avx2(const char* source, size_t start, size_t size)
+{
+	const __m256i newline = _mm256_set1_epi8('\n');
+
+	for(; start + 32 <= size; start += 32)
+	{
+		__m256i chars = _mm256_loadu_si256((const __m256i*)(source + start));
+
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, newline));
+		if(mask != 0)
+			return start + _ps_lowest_bit(mask);
+	}
+
+	return _ps_scan_comment_sse2(source, start, size);
+}
+
+PS_TARGET_AVX2 static size_t _ps_scan_id_avx2(const char* source, size_t start, size_t size)
+{
+	const __m256i slash = _mm256_set1_epi8('/');
+	const __m256i dot = _mm256_set1_epi8('.');
+	const __m256i lessThan = _mm256_set1_epi8('<');
+	const __m256i compareRange = _mm256_set1_epi8('>' - '<');
+	const __m256i squareOpen = _mm256_set1_epi8('[');
+	const __m256i squareClose = _mm256_set1_epi8(']');
+	const __m256i curlyOpen = _mm256_set1_epi8('{');
+	const __m256i curlyClose = _mm256_set1_epi8('}');
+
+	for(; start + 32 <= size; start += 32)
+	{
+		__m256i chars = _mm256_loadu_si256((const __m256i*)(source + start));
+		__m256i compare = _mm256_sub_epi8(chars, lessThan);
+
+		__m256i isLow = _mm256_andnot_si256(_mm256_cmpeq_epi8(chars, dot), _mm256_cmpeq_epi8(_mm256_min_epu8(chars, slash), chars));
+		__m256i isCompare = _mm256_cmpeq_epi8(_mm256_min_epu8(compare, compareRange), compare);
+		__m256i isBracket = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chars, squareOpen), _mm256_cmpeq_epi8(chars, squareClose)),
+		                                    _mm256_or_si256(_mm256_cmpeq_epi8(chars, curlyOpen), _mm256_cmpeq_epi8(chars, curlyClose)));
+
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(isLow, isCompare), isBracket));
+		if(mask != 0)
+			return start + _ps_lowest_bit(mask);
+	}
+
+	return _ps_scan_id_sse2(source, start, size);
+}
+
+#endif
+
+static inline size_t _ps_scan_short_run(const char* source, size_t start, size_t size, PScharClass charClass)
+{
+	size_t end = start + PS_SHORT_RUN_LENGTH < size ? start + PS_SHORT_RUN_LENGTH : size;
+	while(start < end && PS_CHAR_CLASSES[(uint8_t)source[start]] == charClass)
+		start++;
+
+	return start;
+}
+
+static inline uint32_t _ps_lowest_bit(uint32_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward(&idx, mask);
+	return (uint32_t)idx;
+#else
+	return (uint32_t)__builtin_ctz(mask);
+#endif
+}
+
+static inline uint32_t _ps_count_bits(uint64_t mask)
+{
+#ifdef _MSC_VER
+	return (uint32_t)__popcnt64(mask);
+#else
+	return (uint32_t)__builtin_popcountll(mask);
+#endif
+}
+
+static PSlexerSimd _ps_best_lex_simd()
+{
+#if defined(PS_LEXER_AVX2) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if(info[0] < 7)
+		return PSlexerSimd::SSE2;
+
+	__cpuid(info, 1);
+	bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6; //OSXSAVE, AVX and ymm state enabled
+	if(!osSavesYmm)
+		return PSlexerSimd::SSE2;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) ? PSlexerSimd::AVX2 : PSlexerSimd::SSE2;
+#elif defined(PS_LEXER_AVX2)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? PSlexerSimd::AVX2 : PSlexerSimd::SSE2;
+#elif defined(PS_LEXER_SSE2)
+	return PSlexerSimd::SSE2;
+#else
+	return PSlexerSimd::SCALAR;
+#endif
+}
+
+static PSlexScanners _ps_get_lex_scanners(PSlexerSimd simd)
+{
+	switch(simd)
+	{
+#ifdef PS_LEXER_AVX2
+	case PSlexerSimd::AVX2:
+		return {_ps_scan_whitespace_avx2, _ps_scan_comment_avx2, _ps_scan_id_avx2};
+#endif
+#ifdef PS_LEXER_SSE2
+	case PSlexerSimd::SSE2:
+		return {_ps_scan_whitespace_sse2, _ps_scan_comment_sse2, _ps_scan_id_sse2};
+#endif
+	default:
+		return {_ps_scan_whitespace_scalar, _ps_scan_comment_scalar, _ps_scan_id_scalar};
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static bool _ps_map_file(const std::string& path, const char** data, size_t* size)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	*size = (size_t)fileSize.QuadPart;
+	if(*size == 0) //cant map empty files
+	{
+		*data = nullptr;
+		CloseHandle(file);
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if(mapping == NULL)
+		return false;
+
+	*data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+
+	return *data != nullptr;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if(file < 0)
+		return false;
+
+	struct stat fileStat;
+	if(fstat(file, &fileStat) != 0)
+	{
+		close(file);
+		return false;
+	}
+
+	*size = (size_t)fileStat.st_size;
+	if(*size == 0) //cant map empty files
+	{
+		*data = nullptr;
+		close(file);
+		return true;
+	}
+
+	void* mapping = mmap(nullptr, *size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if(mapping == MAP_FAILED)
+		return false;
+
+	*data = (const char*)mapping;
+	return true;
+#endif
+}
+
+static void _ps_unmap_file(const char* data, size_t size)
+{
+	if(data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap((void*)data, size);
+#endif
+}
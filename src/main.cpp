@@ -4,12 +4,14 @@
 
 int main()
 {
-	std::vector<PStoken> tokens = ps_lex_file("examples/example.ps");
+	PStokenBuffer tokens = ps_lex_file("examples/example.ps");
 	
 	PSast* ast = ps_parse_tokens(tokens);
 	if(!ast)
 		return -1;
 
+	ps_fold_constants(ast);
+	ps_compact_ast(ast);
 	ps_execute(ast);
 
 	ps_save_ast("examples/example.psobj", ast);
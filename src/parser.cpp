@@ -1,9 +1,16 @@
 #include "propscript.hpp"
 
 #include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <exception>
+#include <filesystem>
 #include <iostream>
-#include <unordered_map>
+#include <new>
+#include <random>
+#include <thread>
 
 //--------------------------------------------------------------------------------------------------------------------------------//
 
@@ -13,100 +20,381 @@ enum class PSparseError
 	UNEXPECTED_OPERATOR,
 	EXPECTED_OPERATOR,
 	INVALID_TOKEN,
-	EXPECTED_OPENING_CURLY
+	EXPECTED_OPENING_CURLY,
+	MAX_DEPTH_EXCEEDED
 };
 
-//parses a single statement
-static PSnodeHandle _ps_parse_statement(PSast* ast, const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
+//the tokens being parsed, either an already lexed token buffer or a streaming lexer
+struct PSparseTokens
+{
+	const PStokenBuffer* buffer;
+	PSlexer* lexer;
+};
 
-//parses any token that is not an operator or control flow (statement in parens, variable, function, literal)
-static PSnodeHandle _ps_parse_non_op(PSast* ast, const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
-//parses a statement that is in parenthesis
-static PSnodeHandle _ps_parse_statement_in_parens(PSast* ast, const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
-//parses an identifier (variable, function, literal)
-static PSnodeHandle _ps_parse_id(PSast* ast, const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
-//returns the node for a given operator
-static PSnode _ps_get_op_node(PSast* ast, const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
+//a run of parent statements in a token buffer that is parsed on its own thread
+struct PSparseChunk
+{
+	uint32_t start; //the first token, the start of a top-level function definition for every chunk but the first
+	uint32_t end;   //the next chunk's first token, or the number of tokens
+
+	PSast ast;   //the parent statements' nodes and lists, numbered from 0
+	bool failed; //whether the chunk had an error, or its last statement did not end at the next chunk's first token
+
+	size_t nodeBase;   //the index of the chunk's first node in the whole ast
+	size_t listBase;   //the offset of the chunk's lists in the whole ast
+	size_t parentBase; //the index of the chunk's first parent node in the whole ast
+};
+
+//how far a frame of the parser's work stack has been parsed
+enum PSparseStep : uint8_t
+{
+	PS_PARSE_STEP_START,     //nothing has been parsed
+	PS_PARSE_STEP_CONDITION, //control flow: the condition is on the list stack
+	PS_PARSE_STEP_CODE,      //control flow and functions: the code is on the list stack
+	PS_PARSE_STEP_ELSE_CODE, //control flow: the else code is on the list stack
+	PS_PARSE_STEP_STATEMENT, //block: a statement is on the list stack
+	PS_PARSE_STEP_OPERATOR,  //expression: the left side is on the list stack
+	PS_PARSE_STEP_RIGHT,     //expression: the left and right side of an operator are on the list stack
+	PS_PARSE_STEP_PARENS,    //operand: the statement in parenthesis is on the list stack
+	PS_PARSE_STEP_ARGUMENT,  //operand: a function argument is on the list stack
+	PS_PARSE_STEP_INDEX      //operand: the index into a variable is on the list stack
+};
+
+//a construct on the parser's work stack. the parser never recurses, a frame pushes a frame for each nested construct and
+//continues once that frame leaves its node on the list stack, so nesting costs heap memory instead of native stack
+struct PSparseFrame
+{
+	enum Type : uint8_t
+	{
+		STATEMENT,  //a statement, dispatched on its first token
+		CONTROL,    //an if statement or for loop
+		FUNC,       //a function definition
+		RETURN,     //a return statement with a return value
+		BLOCK,      //statements in curly braces, left on the list stack for the frame below instead of a node
+		EXPRESSION, //operators and their operands
+		OPERAND     //any token that is not an operator or control flow (statement in parens, variable, function, literal)
+	} type;
+
+	PSparseStep step;
+	bool negative;            //whether an operand is negated
+	uint32_t depth;           //the number of statements the frame is nested in
+	int maxPrecedence;        //an expression stops at the first operator with a precedence above this
+	size_t listStart;         //the start of the list being built on the list stack
+	PSincrementalBlock* body; //the block a function body records its statements in, or nullptr
+	PSnode node;              //the node being built
+};
+
+#define PS_OBJECT_BYTE_ORDER 0x01020304 //written in native byte order, reads differently on machines with the other byte order
+#define PS_OBJECT_ALIGNMENT  16         //the alignment of each section of a .psobj file, the strictest alignment of any section
+
+//the sections of a .psobj file, each is an array laid out exactly as it is in memory
+enum PSobjectSection
+{
+	PS_OBJECT_SECTION_PARENT_NODES,
+	PS_OBJECT_SECTION_NODES,
+	PS_OBJECT_SECTION_LISTS,
+	PS_OBJECT_SECTION_SYMBOL_OFFSETS,
+	PS_OBJECT_SECTION_SYMBOL_NAMES,
+	PS_OBJECT_SECTION_CONSTANTS,
+	PS_OBJECT_SECTION_FUNCTIONS, //the parent functions whose bodies can be loaded on their own, sorted by their nodes
+
+	PS_OBJECT_SECTION_COUNT
+};
+
+//the header at the start of a .psobj file. every field is fixed-width, so the header and sections can be used in place once mapped
+struct PSobjectHeader
+{
+	char magic[4];       //PS_OBJECT_MAGIC, without its null terminator
+	uint32_t version;    //PS_OBJECT_VERSION
+	uint32_t byteOrder;  //PS_OBJECT_BYTE_ORDER
+	uint32_t nodeSize;   //sizeof(PSnode) in the build that saved the file
+	uint32_t dataSize;   //sizeof(PSdata) in the build that saved the file
+	uint32_t numSymbols;
+	uint64_t fileSize;   //the size of the header and every section, in bytes
+
+	uint64_t sectionOffsets[PS_OBJECT_SECTION_COUNT]; //the offset of each section from the start of the header
+	uint64_t sectionSizes[PS_OBJECT_SECTION_COUNT];   //the number of elements in each section
+};
+
+//the header at the start of an archive, followed by the index and the string table, then the sections of each script
+struct PSarchiveHeader
+{
+	char magic[4];       //PS_ARCHIVE_MAGIC, without its null terminator
+	uint32_t version;    //PS_ARCHIVE_VERSION
+	uint32_t byteOrder;  //PS_OBJECT_BYTE_ORDER
+	uint32_t nodeSize;   //sizeof(PSnode) in the build that saved the file
+	uint32_t dataSize;   //sizeof(PSdata) in the build that saved the file
+	uint32_t numScripts;
+	uint64_t fileSize;   //the size of the whole archive, in bytes
+
+	uint64_t indexOffset;   //the offset of the index, an entry for each script sorted by name
+	uint64_t stringsOffset; //the offset of the string table, which holds every script and symbol name once
+	uint64_t stringsSize;   //the size of the string table, in bytes
+};
+
+//an entry of an archive's index, describes the sections of a script like the header of a .psobj file does
+struct PSarchiveEntry
+{
+	uint32_t nameStart; //the offset of the script's name in the string table
+	uint32_t nameEnd;   //the offset of the end of the script's name in the string table
+	uint32_t numSymbols;
+	uint32_t padding;
+
+	//the offset of each section from the start of the archive, and its number of elements. the symbol offsets section holds the
+	//start of each symbol's name in the string table followed by the end of each, the symbol names section is always empty:
+	uint64_t sectionOffsets[PS_OBJECT_SECTION_COUNT];
+	uint64_t sectionSizes[PS_OBJECT_SECTION_COUNT];
+};
+
+#define PS_PACKED_COMPRESSED 0x1       //the flag set in a packed file's header when its payload is split into compressed blocks
+#define PS_PACKED_BLOCK_SIZE (1 << 20) //the most payload bytes a compressed block holds, matches never reach outside their block
+#define PS_PACKED_HASH_BITS  16        //the size of the compressor's table of recent positions, as a power of two
+#define PS_PACKED_MIN_MATCH  4         //the shortest repeat the compressor encodes as a match
+
+#define PS_UNVERSIONED_OP_SIZE     16 //sizeof(PSnode::OP) in the last build that wrote unversioned files: its type, children and a flag
+#define PS_UNVERSIONED_OLD_OP_SIZE 12 //sizeof(PSnode::OP) in older builds, which had no flag and didn't repeat the children
+
+//reads a packed or unversioned file from memory. reading past the end returns 0 and sets failed, so checks can wait for the
+//values that have to be in range
+struct PSpackedReader
+{
+	const uint8_t* cur;
+	const uint8_t* end;
+	bool failed;
+};
 
+//the part of a loaded ast its nodes may reference. the bodies of a partly loaded object aren't read yet, so the nodes outside them
+//may only reference each other, and the nodes of a body only that body
+struct PSloadBounds
+{
+	const PSnode* nodes;
+	const uint32_t* lists;
+	uint64_t numSymbols;
+	uint64_t numConstants;
+
+	uint64_t firstNode;
+	uint64_t endNode;
+	uint64_t firstList;
+	uint64_t endList;
+
+	const PSobjectFunction* functions = nullptr; //the bodies between the first and end node that are left out, sorted by their nodes
+	uint32_t numFunctions = 0;
+	std::vector<std::pair<uint64_t, uint64_t>> bodyLists = {}; //the range of lists each body with lists uses, sorted
+	std::vector<PSnodeHandle> definitions = {};                //the definitions of the bodies, sorted, only parent nodes may reference them
+	const std::vector<bool>* listStarts = nullptr;             //where each list a packed file stored starts, every reference has to be to one
+};
+
+constexpr size_t PS_PARALLEL_MIN_CHUNK_TOKENS = 128 * 1024;
+
+//parses every statement in the tokens
+static PSast* _ps_parse(PSparseTokens& tokens);
+//parses a token buffer split into chunks on multiple threads, returns false if a chunk had an error
+static bool _ps_parse_parallel(PSast* ast, const PStokenBuffer& tokens, size_t numChunks);
+//parses the parent statements of a chunk
+static void _ps_parse_chunk(PSparseChunk& chunk, const PStokenBuffer& buffer);
+//copies a chunk's nodes, lists and parent nodes into an ast, offsetting the handles and lists they reference
+static void _ps_merge_chunk(PSast* ast, const PSparseChunk& chunk);
+//parses a single statement nested in depth statements, starting from 1 for parent statements
+static PSnodeHandle _ps_parse_statement(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens, uint32_t depth);
+//parses a parent function definition, recording the statements of its body in body if it is not nullptr
+static PSnodeHandle _ps_parse_func(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens, PSincrementalBlock* body);
+//runs the parser's work stack from a first frame until it is parsed, returns its node
+static PSnodeHandle _ps_parse_frames(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens, const PSparseFrame& first);
+//prints the message of the last parse error
+static void _ps_print_error(PSparseTokens& tokens);
+
+//compiles an incremental script from scratch, returns false on error
+static bool _ps_incremental_compile(PSincrementalScript* script);
+//parses the statements of a function body touched by an edit again, returns false if the edit is not inside a single function body
+//or changed where the body ends
+static bool _ps_reparse_func_body(PSincrementalScript* script, PSparseTokens& tokens, const PStokenEdit& edit);
+//parses the statements of a block again from the first one an edit touches, until they line up with the old statements after the
+//edit. funcBlocks is nullptr for function bodies. returns false if a function body's closing curly brace moved
+static bool _ps_reparse_block(PSincrementalScript* script, PSparseTokens& tokens, const PStokenEdit& edit, PSincrementalBlock& block,
+                              std::vector<PSnodeHandle>& handles, std::vector<PSincrementalBlock>* funcBlocks);
+//returns the number of nodes and list elements a node and its children use
+static size_t _ps_node_size(PSast* ast, PSnodeHandle handle);
+//returns the number of list elements a list uses, and pushes its nodes onto the stack of nodes to count
+static size_t _ps_list_size(PSast* ast, PSnodeList list, std::vector<PSnodeHandle>& stack);
+
+//pushes the nodes of a list onto the stack of nodes to lay out, so that they are popped in order
+static inline void _ps_push_compact_list(const uint32_t* handles, uint32_t numHandles, std::vector<PSnodeHandle>& stack);
+//copies a list to the end of a new list vector, renumbering its elements if they are node handles. returns the new list
+static inline PSnodeList _ps_compact_list(PSast* ast, PSnodeList list, const std::vector<PSnodeHandle>& newHandles, std::vector<uint32_t>& lists, bool handles);
+
+//parses the next step of the frame on top of the work stack, for each type of frame:
+static void _ps_step_statement(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
+static void _ps_step_control(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx);
+static void _ps_step_func(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
+static void _ps_step_block(PSparseTokens& tokens, uint32_t& curTokenIdx);
+static void _ps_step_expression(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
+static void _ps_step_operand(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
+//returns the node for a given operator
+static PSnode _ps_get_op_node(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
+
+//pushes a frame onto the work stack, returns it
+static inline PSparseFrame& _ps_push_frame(PSparseFrame::Type type, uint32_t depth);
+//pushes a statement onto the work stack, throws an exception if it is nested too deeply
+static inline void _ps_push_statement(PSparseTokens& tokens, uint32_t curTokenIdx, uint32_t depth);
+//pushes the code of a control flow statement onto the work stack, a block in curly braces or a single statement
+static inline void _ps_push_code(PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t depth);
+//parses an operand that is a number or a variable without an index without pushing a frame, leaves it on the list stack.
+//returns false for any other operand
+static inline bool _ps_parse_simple_operand(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
+//adds the node of the frame on top of the work stack to the ast, leaves it on the list stack and pops the frame
+static inline void _ps_finish_frame(PSast* ast, const PSnode& node);
+//adds the node of the operand on top of the work stack to the ast, negated if needed, and finishes the operand
+static inline void _ps_add_operand(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
+//pops the operand on top of the work stack, whose node is on the list stack
+static inline void _ps_finish_operand(PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
 //adds a node to the ast
-static inline PSnodeHandle _ps_add_node(PSast* ast, PSnode node);
+static inline PSnodeHandle _ps_add_node(PSast* ast, const PSnode& node);
+//moves the elements pushed to the list stack since start into a list in the ast
+static inline PSnodeList _ps_pop_list(PSast* ast, size_t start);
 //removes a newline from the token list if there are unclosed parenthesis
-static inline void _ps_continue_statement(const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
+static inline void _ps_continue_statement(PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens);
 //removes a newline from the token list
-static inline void _ps_remove_newline(const std::vector<PStoken>& tokens, uint32_t& curTokenIdx);
+static inline void _ps_remove_newline(PSparseTokens& tokens, uint32_t& curTokenIdx);
+//returns whether a token is an operator, seperator, or operator keyword
+static inline bool _ps_is_op_token(PStoken::Type type);
+//gets the operator type of a token, returns false if the token is not an operator
+static inline bool _ps_token_op_type(PStoken::Type type, PSnode::OP::Type* opType);
 //returns the operator precedence of a given operator
 static inline int _ps_precedence(PSnode::OP::Type op);
+//returns whether a token closes an expression (closing parenthesis, bracket, or curly brace, or a comma)
+static inline bool _ps_is_closed_seperator(PStoken::Type type);
+//returns whether a token ends an expression (newline, opening curly brace, or a closing seperator)
+static inline bool _ps_ends_expression(PStoken::Type type);
+//returns the token at the given index, or a newline token past the end of the tokens
+static inline PStoken _ps_token(PSparseTokens& tokens, uint32_t idx);
+//returns the type of the token at the given index, or a newline past the end of the tokens. only reads the type array of buffers
+static inline PStoken::Type _ps_token_type(PSparseTokens& tokens, uint32_t idx);
+//returns whether the given index is past the end of the tokens
+static inline bool _ps_at_end(PSparseTokens& tokens, uint32_t idx);
+//returns the text of the token at the given index
+static inline std::string_view _ps_token_str(PSparseTokens& tokens, uint32_t idx);
+//returns the text of a token
+static inline std::string_view _ps_token_str(PSparseTokens& tokens, const PStoken& token);
 //throws an exception if the given token is not an identifier
-static inline void _ps_force_id(PStoken token);
+static inline void _ps_force_id(PSparseTokens& tokens, uint32_t idx);
 //throws an exception and sets the global error variables
 static void _ps_error(PSparseError error, PStoken errorToken);
 
+//returns a copy of a node with only the members its type uses, and every other byte zeroed
+static PSnode _ps_object_node(const PSnode& node);
+//returns the nodes of an ast as they are written to a file, without the bytes their type doesn't use so that saving the same ast
+//always gives the same file
+static std::vector<PSnode> _ps_object_nodes(PSast* ast);
+//returns the bytes of an ast's constants as they are written to a file, without the bytes their type doesn't use
+static std::vector<char> _ps_object_constants(PSast* ast);
+//returns the parent functions of an ast whose bodies use contiguous nodes and lists, which ps_compact_ast lays them out in
+static std::vector<PSobjectFunction> _ps_object_functions(PSast* ast);
+//returns whether a function table is sorted, and each body is inside the nodes and lists and after the one before it
+static bool _ps_valid_object_functions(const PSobjectFunction* functions, uint64_t numFunctions, uint64_t numNodes, uint64_t listsSize);
+//returns the function whose body a node is in, numFunctions if it isn't in one
+static uint32_t _ps_object_body(const PSobjectFunction* functions, uint32_t numFunctions, PSnodeHandle handle);
+//returns the bounds of the nodes outside the bodies of an object, fails if a body's definition isn't a parent node outside them
+static bool _ps_object_parent_bounds(const PSastView& ast, const PSobjectFunction* functions, uint32_t numFunctions,
+                                     uint64_t listsSize, uint64_t numConstants, PSloadBounds* bounds);
+//returns whether a node handle is in the bounds and not in a body or a body's definition, or is UINT32_MAX where that's allowed
+static bool _ps_valid_handle(const PSloadBounds& bounds, PSnodeHandle handle, bool allowNone);
+//returns whether a list and its elements lie in the bounds and not in a body. list 0 is always empty and valid
+static bool _ps_valid_list(const PSloadBounds& bounds, PSnodeList list);
+//returns whether a node's type is valid, and every node, list, symbol and constant it references is in the bounds
+static bool _ps_valid_node(const PSloadBounds& bounds, PSnodeHandle handle);
+//returns whether every node in the bounds is valid, skipping the bodies left out of them
+static bool _ps_valid_nodes(const PSloadBounds& bounds);
+//returns whether every node, parent node and constant of an ast read from a file is valid, so it can be resolved safely. if
+//listStarts is given, lists may only be referenced where one starts
+static bool _ps_valid_loaded_ast(const PSast* ast, const std::vector<bool>* listStarts = nullptr);
+//returns whether symbol offsets never decrease and end within the names
+static bool _ps_valid_symbol_offsets(const uint32_t* offsets, uint64_t numOffsets, uint64_t namesSize);
+//returns whether every constant has a valid type
+static bool _ps_valid_constants(const PSdata* constants, uint64_t numConstants);
+//returns a view of the sections of an object that start at base
+static PSastView _ps_object_view(const char* base, const uint64_t* offsets, const uint64_t* sizes);
+//returns the size of each element of a .psobj section, in bytes
+static size_t _ps_object_element_size(PSobjectSection section);
+//rounds an offset up to the alignment of a section
+static uint64_t _ps_object_align(uint64_t offset);
+//pads a file from written bytes up to offset, then writes a section there and advances written past it
+static void _ps_write_section(std::ofstream& file, uint64_t* written, uint64_t offset, const void* data, size_t size);
+//returns whether a .psobj header can be used by this build and describes sections that fit in size bytes
+static bool _ps_valid_object_header(const PSobjectHeader& header, size_t size);
+//returns whether the sections of an object are aligned and lie between minOffset and the end of the file
+static bool _ps_valid_sections(const uint64_t* offsets, const uint64_t* sizes, uint64_t minOffset, uint64_t fileSize);
+//returns whether an archive header can be used by this build, and its index and string table fit in size bytes
+static bool _ps_valid_archive_header(const PSarchiveHeader& header, size_t size);
+//returns a view of a script in an archive
+static PSastView _ps_archive_view(PSarchive* archive, const PSarchiveEntry& entry);
+//returns the entry of the script with a name in an archive's sorted index, nullptr if there is none or its symbols are invalid
+static const PSarchiveEntry* _ps_find_archive_entry(PSarchive* archive, std::string_view name);
+//adds bytes to a 64 bit FNV-1a hash
+static uint64_t _ps_hash_bytes(uint64_t hash, const void* data, size_t size);
+//saves an ast to a temporary file next to path and renames it to path, so readers never see a partly written file
+static bool _ps_save_ast_atomic(const std::string& path, PSast* ast);
+//appends an unsigned LEB128 varint
+static inline void _ps_write_varint(std::vector<char>& out, uint64_t value);
+//appends a float as its 4 bytes in little endian order
+static inline void _ps_write_float(std::vector<char>& out, float value);
+static inline uint64_t _ps_read_varint(PSpackedReader& reader);
+static inline float _ps_read_float(PSpackedReader& reader);
+//maps signed values to unsigned ones so small negative deltas stay short as varints
+static inline uint64_t _ps_zigzag(int64_t value);
+static inline int64_t _ps_unzigzag(uint64_t value);
+//returns the number of 4 byte components a constant's type stores
+static uint32_t _ps_packed_components(PSdata::Type type);
+//encodes an ast's symbols, constants, nodes and lists as varints. fails if the lists aren't stored one after another
+static bool _ps_encode_packed_payload(PSast* ast, std::vector<char>& out);
+//decodes a payload written by _ps_encode_packed_payload in a single pass, nullptr if it is corrupt
+static PSast* _ps_decode_packed_payload(const uint8_t* data, size_t size);
+//compresses a buffer as LZ77 sequences, each a run of literal bytes followed by a match copied from earlier in the block
+static void _ps_compress_block(const uint8_t* data, size_t size, std::vector<char>& out);
+//decompresses a block written by _ps_compress_block, returns false if it is corrupt or doesn't fill the output exactly
+static bool _ps_decompress_block(PSpackedReader& reader, uint8_t* out, size_t size);
+//loads an ast saved before .psobj files had a header, which wrote each node's names and lists inline
+static PSast* _ps_load_unversioned_ast(std::ifstream& file);
+//copies bytes out of a reader, setting failed if it runs past the end
+static inline void _ps_read_bytes(PSpackedReader& reader, void* dest, size_t size);
+static inline uint32_t _ps_read_uint32(PSpackedReader& reader);
+//reads a size_t length and checks that as many elements of elementSize bytes are left, 0 if they aren't
+static inline uint64_t _ps_read_length(PSpackedReader& reader, size_t elementSize);
+//reads an unversioned list of node handles and adds it to an ast, list 0 if it is empty
+static PSnodeList _ps_read_unversioned_list(PSpackedReader& reader, PSast* ast);
+//adds a list to an ast, list 0 if it is empty
+static PSnodeList _ps_add_unversioned_list(PSast* ast, const std::vector<uint32_t>& elements);
+//reads an unversioned name, its length followed by its characters
+static std::string_view _ps_read_unversioned_name(PSpackedReader& reader);
+
 //--------------------------------------------------------------------------------------------------------------------------------//
 
-static PSparseError g_psError;
-static PStoken g_psErrorToken;
-
-const std::unordered_map<std::string, PSnode::OP::Type> PS_STRING_TO_OP_TYPE = {
-	{PS_KEYWORD_IN         , PSnode::OP::Type::IN},
-	{PS_OP_MULT            , PSnode::OP::Type::MULT},
-	{PS_OP_DIV             , PSnode::OP::Type::DIV},
-	{PS_OP_MOD             , PSnode::OP::Type::MOD},
-	{PS_OP_ADD             , PSnode::OP::Type::ADD},
-	{PS_OP_SUB             , PSnode::OP::Type::SUB},
-	{PS_OP_EQUAL           , PSnode::OP::Type::EQUAL},
-	{PS_OP_MULTEQUAL       , PSnode::OP::Type::MULTEQUAL},
-	{PS_OP_DIVEQUAL        , PSnode::OP::Type::DIVEQUAL},
-	{PS_OP_MODEQUAL        , PSnode::OP::Type::MODEQUAL},
-	{PS_OP_ADDEQUAL        , PSnode::OP::Type::ADDEQUAL},
-	{PS_OP_SUBEQUAL        , PSnode::OP::Type::SUBEQUAL},
-	{PS_OP_LESSTHAN        , PSnode::OP::Type::LESSTHAN},
-	{PS_OP_GREATERTHAN     , PSnode::OP::Type::GREATERTHAN},
-	{PS_OP_LESSTHANEQUAL   , PSnode::OP::Type::LESSTHANEQUAL},
-	{PS_OP_GREATERTHANEQUAL, PSnode::OP::Type::GREATERTHANEQUAL},
-	{PS_OP_EQUALITY        , PSnode::OP::Type::EQUALITY},
-	{PS_OP_NONEQUALITY     , PSnode::OP::Type::NONEQUALITY},
-};
+static thread_local PSparseError g_psError;
+static thread_local PStoken g_psErrorToken;
+
+static uint32_t g_psParseThreads = 0;
+static uint32_t g_psMaxParseDepth = PS_DEFAULT_MAX_PARSE_DEPTH;
+
+//the elements of the lists being parsed, each list is popped into the ast once it is complete. nested lists are pushed
+//above the lists containing them, so one stack serves every nesting level and keeps its capacity between parses
+static thread_local std::vector<uint32_t> g_psListStack;
+//the frames of the constructs being parsed, keeps its capacity between parses
+static thread_local std::vector<PSparseFrame> g_psParseStack;
+
 
 //--------------------------------------------------------------------------------------------------------------------------------//
 
-PSast* ps_parse_tokens(const std::vector<PStoken>& tokens)
+PSast* ps_parse_tokens(const PStokenBuffer& tokens)
 {
-	PSast* result = new PSast;
-
-	try
-	{
-		uint32_t curTokenIdx = 0;
-		uint32_t numOpenParens = 0;
+	PSparseTokens parseTokens = {&tokens, nullptr};
+	return _ps_parse(parseTokens);
+}
 
-		while(curTokenIdx < tokens.size())
-		{
-			result->parentNodes.push_back(_ps_parse_statement(result, tokens, curTokenIdx, numOpenParens));
-			_ps_remove_newline(tokens, curTokenIdx);
-		}
-	}
-	catch(std::exception e)
+PSast* ps_parse_lexer(PSlexer* lexer)
+{
+	PSparseTokens parseTokens = {nullptr, lexer};
+	PSast* result = _ps_parse(parseTokens);
+	if(result && lexer->failed) //lexing errors have already been reported
 	{
-		std::string errMsg;
-		switch(g_psError)
-		{
-		case PSparseError::EXPECTED_CLOSING_PAREN:
-			errMsg = "EXPECTED CLOSING PARENTHESIS";
-			break;
-		case PSparseError::UNEXPECTED_OPERATOR:
-			errMsg = "UNEXPECTED OPERATOR \"" + g_psErrorToken.str + "\"";
-			break;
-		case PSparseError::EXPECTED_OPERATOR:
-			errMsg = "EXPECTED OPERATOR";
-			break;
-		case PSparseError::INVALID_TOKEN:
-			errMsg = "INVALID TOKEN \"" + g_psErrorToken.str + "\"";
-			break;
-		case PSparseError::EXPECTED_OPENING_CURLY:
-			errMsg = "EXPECTED OPENING CURLY BRACE";
-			break;
-		}
-
-		std::cout << "PROPSCRIPT PARSE ERROR: " << errMsg << " ON LINE " << g_psErrorToken.lineNum << std::endl;
 		delete result;
 		return nullptr;
 	}
@@ -114,105 +402,312 @@ PSast* ps_parse_tokens(const std::vector<PStoken>& tokens)
 	return result;
 }
 
-void ps_free_ast(PSast* ast)
+PSast* ps_parse_source(const char* source, size_t size)
 {
-	delete ast;
+	PStokenBuffer tokens = ps_lex_buffer(source, size);
+	if(size > 0 && !tokens.source) //lexing errors have already been reported
+		return nullptr;
+
+	return ps_parse_tokens(tokens);
 }
 
-void ps_save_ast(std::string path, PSast* ast)
+PSast* ps_parse_source(const std::string& source)
 {
-	std::ofstream file(path, std::ios_base::binary);
-	if(!file.is_open())
+	return ps_parse_source(source.data(), source.size());
+}
+
+PSincrementalScript* ps_incremental_open(std::string source)
+{
+	PSincrementalScript* script = new PSincrementalScript;
+	script->source = std::move(source);
+	_ps_incremental_compile(script);
+
+	return script;
+}
+
+bool ps_incremental_edit(PSincrementalScript* script, size_t offset, size_t removedSize, std::string_view inserted)
+{
+	offset = std::min(offset, script->source.size());
+	removedSize = std::min(removedSize, script->source.size() - offset);
+	script->source.replace(offset, removedSize, inserted.data(), inserted.size());
+
+	//CHECK FOR A FULL COMPILE:
+	//edits need a valid compile to start from, a full compile also drops the nodes edits left unreferenced
+	PSast* ast = script->ast;
+	if(!ast || script->numGarbage > (ast->nodePool.size() + ast->lists.size()) / 2)
+		return _ps_incremental_compile(script);
+
+	PStokenEdit edit;
+	uint32_t numSymbols = ps_symbol_count(script->tokens.symbols);
+	if(!ps_lex_edit(script->tokens, script->source.data(), script->source.size(), offset, removedSize, inserted.size(), &edit))
 	{
-		std::cout << "ERROR OPENING FILE \"" << path << "\" FOR WRITING" << std::endl;
-		return;
+		ps_free_ast(script->ast);
+		script->ast = nullptr;
+		return false;
 	}
 
-	ps_save_ast(file, ast);
-	
-	file.close();
+	//SHIFT LINES AND INTERN SYMBOLS:
+	//nodes after the edit move to their new lines, new symbols are interned in the tokens' order
+	if(edit.lineDelta != 0)
+		for(PSnode& node : ast->nodePool)
+			if(node.lineNum >= edit.line)
+				node.lineNum += edit.lineDelta;
+
+	for(uint32_t i = numSymbols; i < ps_symbol_count(script->tokens.symbols); i++)
+		ps_intern_symbol(ast->symbols, ps_symbol_name(script->tokens.symbols, i));
+
+	//PARSE THE TOUCHED STATEMENTS:
+	//of a function body, or of the parent nodes if the edit is not inside one
+	PSparseTokens tokens = {&script->tokens, nullptr};
+	try
+	{
+		g_psListStack.clear();
+		if(!_ps_reparse_func_body(script, tokens, edit))
+			_ps_reparse_block(script, tokens, edit, script->parentBlock, ast->parentNodes, &script->funcBlocks);
+	}
+	catch(std::exception e)
+	{
+		_ps_print_error(tokens);
+		ps_free_ast(script->ast);
+		script->ast = nullptr;
+		return false;
+	}
+
+	return true;
 }
 
-void ps_save_ast(std::ofstream& file, PSast* ast)
+void ps_incremental_free(PSincrementalScript* script)
+{
+	ps_free_ast(script->ast);
+	delete script;
+}
+
+void ps_parse_set_threads(uint32_t numThreads)
+{
+	g_psParseThreads = numThreads;
+}
+
+uint32_t ps_parse_get_threads()
+{
+	return g_psParseThreads;
+}
+
+void ps_parse_set_max_depth(uint32_t maxDepth)
 {
-	size_t parentNodeSize = ast->parentNodes.size();
-	size_t nodePoolSize = ast->nodePool.size();
+	g_psMaxParseDepth = maxDepth;
+}
 
-	file.write((const char*)&parentNodeSize, sizeof(size_t));
-	file.write((const char*)ast->parentNodes.data(), sizeof(PSnodeHandle) * parentNodeSize);
+uint32_t ps_parse_get_max_depth()
+{
+	return g_psMaxParseDepth;
+}
 
-	file.write((const char*)&nodePoolSize, sizeof(size_t));
-	for(int i = 0; i < nodePoolSize; i++)
+void ps_compact_ast(PSast* ast)
+{
+	//FIND THE NEW HANDLE OF EVERY NODE:
+	//nodes come before their children, children in evaluation order
+	//function bodies are skipped when their definition executes, so they are laid out after all of the code around them. the
+	//functions defined in a parent function's body come right after it, so each parent function's nodes and lists are contiguous:
+	std::vector<PSnodeHandle> order;
+	std::vector<PSnodeHandle> newHandles(ast->nodePool.size(), UINT32_MAX);
+	std::vector<PSnodeHandle> stack;
+	std::vector<PSnodeHandle> parentFuncs;
+	std::vector<PSnodeHandle> funcs;
+	order.reserve(ast->nodePool.size());
+
+	_ps_push_compact_list(ast->parentNodes.data(), (uint32_t)ast->parentNodes.size(), stack);
+	size_t nextParentFunc = 0;
+	size_t nextFunc = 0;
+	while(!stack.empty() || nextFunc < funcs.size() || nextParentFunc < parentFuncs.size())
 	{
-		PSnode& node = ast->nodePool[i];
-		file.write((const char*)&node.type, sizeof(PSnode::Type));
-		file.write((const char*)&node.lineNum, sizeof(uint32_t));
+		if(stack.empty())
+		{
+			PSnodeHandle handle = nextFunc < funcs.size() ? funcs[nextFunc++] : parentFuncs[nextParentFunc++];
+			const PSnode& func = ast->nodePool[handle];
+			_ps_push_compact_list(ast->list_data(func.keyword.code), ast->list_size(func.keyword.code), stack);
+			continue;
+		}
+
+		PSnodeHandle cur = stack.back();
+		stack.pop_back();
+		if(cur == UINT32_MAX || newHandles[cur] != UINT32_MAX)
+			continue;
+
+		newHandles[cur] = (PSnodeHandle)order.size();
+		order.push_back(cur);
 
+		const PSnode& node = ast->nodePool[cur];
 		switch(node.type)
 		{
-		case PSnode::Type::OP:
+		case PSnode::OP:
 		{
-			file.write((const char*)&node.op, sizeof(PSnode::OP));
-			file.write((const char*)&node.op.left, sizeof(PSnodeHandle));
-			file.write((const char*)&node.op.right, sizeof(PSnodeHandle));
+			//assignments evaluate their value before the variable they assign to
+			PSnodeHandle first  = node.op.type == PSnode::OP::EQUAL ? node.op.right : node.op.left;
+			PSnodeHandle second = node.op.type == PSnode::OP::EQUAL ? node.op.left : node.op.right;
+			stack.push_back(second);
+			stack.push_back(first);
 			break;
 		}
-		case PSnode::Type::KEYWORD:
+		case PSnode::KEYWORD:
 		{
-			file.write((const char*)&node.keyword.type, sizeof(PSnode::Keyword::Type));
-
-			size_t codeSize = node.keyword.code.size();
-			size_t elseCodeSize = node.keyword.elseCode.size();
-			size_t paramNameSize = node.keyword.paramNames.size();
-
-			file.write((const char*)&codeSize, sizeof(size_t));
-			file.write((const char*)node.keyword.code.data(), sizeof(PSnodeHandle) * codeSize);
-
-			file.write((const char*)&node.keyword.condition, sizeof(PSnodeHandle));
-
-			file.write((const char*)&node.keyword.hasElse, sizeof(bool));
-			file.write((const char*)&elseCodeSize, sizeof(size_t));
-			file.write((const char*)node.keyword.elseCode.data(), sizeof(PSnodeHandle) * elseCodeSize);
-
-			size_t nameLen = node.keyword.name.length();
-			file.write((const char*)&nameLen, sizeof(size_t));
-			file.write((const char*)node.keyword.name.data(), sizeof(char) * nameLen);
-			file.write((const char*)&paramNameSize, sizeof(size_t));
-			for(int j = 0; j < paramNameSize; j++)
+			switch(node.keyword.type)
 			{
-				size_t paramNameLen = node.keyword.paramNames[j].length();
-				file.write((const char*)&paramNameLen, sizeof(size_t));
-				file.write((const char*)node.keyword.paramNames[j].data(), sizeof(char) * paramNameLen);
+			case PSnode::Keyword::IF:
+			case PSnode::Keyword::FOR:
+				if(node.keyword.hasElse)
+					_ps_push_compact_list(ast->list_data(node.keyword.elseCode), ast->list_size(node.keyword.elseCode), stack);
+				_ps_push_compact_list(ast->list_data(node.keyword.code), ast->list_size(node.keyword.code), stack);
+				stack.push_back(node.keyword.condition);
+				break;
+			case PSnode::Keyword::FUNC:
+				if(nextParentFunc == 0 && nextFunc == 0)
+					parentFuncs.push_back(cur);
+				else
+					funcs.push_back(cur);
+				break;
+			case PSnode::Keyword::RETURN:
+				stack.push_back(node.keyword.returnVal);
+				break;
+			default:
+				break;
 			}
-
-			file.write((const char*)&node.keyword.returnVal, sizeof(PSnodeHandle));
-
 			break;
 		}
 		case PSnode::ID:
-		{
-			file.write((const char*)&node.id.type, sizeof(PSnode::ID::Type));
-
-			size_t nameLen = node.id.name.length();
-			file.write((const char*)&nameLen, sizeof(size_t));
-			file.write((const char*)node.id.name.data(), sizeof(char) * nameLen);
+			_ps_push_compact_list(ast->list_data(node.id.params), ast->list_size(node.id.params), stack);
+			break;
+		default:
+			break;
+		}
+	}
 
-			size_t paramSize = node.id.params.size();
-			file.write((const char*)&paramSize, sizeof(size_t));
-			file.write((const char*)node.id.params.data(), sizeof(PSnodeHandle) * paramSize);
+	//COPY THE NODES TO THEIR NEW HANDLES:
+	//lists are copied in the same order so a node's lists stay together
+	std::vector<PSnode> nodePool(order.size());
+	std::vector<uint32_t> lists = {0};
+	lists.reserve(ast->lists.size());
 
+	for(size_t i = 0; i < order.size(); i++)
+	{
+		PSnode node = ast->nodePool[order[i]];
+		switch(node.type)
+		{
+		case PSnode::OP:
+		{
+			node.op.left = newHandles[node.op.left];
+			if(node.op.type != PSnode::OP::NEG)
+				node.op.right = newHandles[node.op.right];
 			break;
 		}
-		case PSnode::NUMBER:
+		case PSnode::KEYWORD:
 		{
-			file.write((const char*)&node.literal.type, sizeof(PSnode::Literal::Type));
-			file.write((const char*)&node.literal.intNum, sizeof(int32_t));
-			file.write((const char*)&node.literal.floatNum, sizeof(float));
-
+			switch(node.keyword.type)
+			{
+			case PSnode::Keyword::IF:
+			case PSnode::Keyword::FOR:
+				node.keyword.condition = newHandles[node.keyword.condition];
+				node.keyword.code = _ps_compact_list(ast, node.keyword.code, newHandles, lists, true);
+				node.keyword.elseCode = _ps_compact_list(ast, node.keyword.elseCode, newHandles, lists, true);
+				break;
+			case PSnode::Keyword::FUNC:
+				node.keyword.paramNames = _ps_compact_list(ast, node.keyword.paramNames, newHandles, lists, false);
+				node.keyword.code = _ps_compact_list(ast, node.keyword.code, newHandles, lists, true);
+				break;
+			case PSnode::Keyword::RETURN:
+				if(node.keyword.returnVal != UINT32_MAX)
+					node.keyword.returnVal = newHandles[node.keyword.returnVal];
+				break;
+			default:
+				break;
+			}
 			break;
 		}
+		case PSnode::ID:
+			node.id.params = _ps_compact_list(ast, node.id.params, newHandles, lists, true);
+			break;
+		default:
+			break;
 		}
+
+		nodePool[i] = node;
+	}
+
+	for(PSnodeHandle& handle : ast->parentNodes)
+		handle = newHandles[handle];
+
+	ast->nodePool = std::move(nodePool);
+	ast->lists = std::move(lists);
+}
+
+void ps_free_ast(PSast* ast)
+{
+	delete ast;
+}
+
+void ps_save_ast(std::string path, PSast* ast)
+{
+	std::ofstream file(path, std::ios_base::binary);
+	if(!file.is_open())
+	{
+		std::cout << "ERROR OPENING FILE \"" << path << "\" FOR WRITING" << std::endl;
+		return;
+	}
+
+	ps_save_ast(file, ast);
+	
+	file.close();
+}
+
+void ps_save_ast(std::ofstream& file, PSast* ast)
+{
+	std::vector<PSnode> nodes = _ps_object_nodes(ast);
+	std::vector<char> constants = _ps_object_constants(ast);
+	std::vector<PSobjectFunction> functions = _ps_object_functions(ast);
+
+	uint32_t numSymbols = ps_symbol_count(ast->symbols);
+	uint32_t noSymbolOffsets = 0;
+	const void* sections[PS_OBJECT_SECTION_COUNT] = {
+		ast->parentNodes.data(),
+		nodes.data(),
+		ast->lists.data(),
+		numSymbols > 0 ? ast->symbols.offsets.data() : &noSymbolOffsets,
+		ast->symbols.names.data(),
+		constants.data(),
+		functions.data()
+	};
+
+	//LAY OUT SECTIONS AFTER THE HEADER:
+	PSobjectHeader header = {};
+	std::memcpy(header.magic, PS_OBJECT_MAGIC, sizeof(header.magic));
+	header.version = PS_OBJECT_VERSION;
+	header.byteOrder = PS_OBJECT_BYTE_ORDER;
+	header.nodeSize = sizeof(PSnode);
+	header.dataSize = sizeof(PSdata);
+	header.numSymbols = numSymbols;
+
+	header.sectionSizes[PS_OBJECT_SECTION_PARENT_NODES] = ast->parentNodes.size();
+	header.sectionSizes[PS_OBJECT_SECTION_NODES] = nodes.size();
+	header.sectionSizes[PS_OBJECT_SECTION_LISTS] = ast->lists.size();
+	header.sectionSizes[PS_OBJECT_SECTION_SYMBOL_OFFSETS] = numSymbols + 1;
+	header.sectionSizes[PS_OBJECT_SECTION_SYMBOL_NAMES] = ast->symbols.names.size();
+	header.sectionSizes[PS_OBJECT_SECTION_CONSTANTS] = ast->constants.size();
+	header.sectionSizes[PS_OBJECT_SECTION_FUNCTIONS] = functions.size();
+
+	uint64_t offset = sizeof(PSobjectHeader);
+	for(int i = 0; i < PS_OBJECT_SECTION_COUNT; i++)
+	{
+		offset = _ps_object_align(offset);
+		header.sectionOffsets[i] = offset;
+		offset += header.sectionSizes[i] * _ps_object_element_size((PSobjectSection)i);
 	}
+	header.fileSize = offset;
+
+	//WRITE HEADER AND SECTIONS:
+	uint64_t written = 0;
+	_ps_write_section(file, &written, 0, &header, sizeof(PSobjectHeader));
+	for(int i = 0; i < PS_OBJECT_SECTION_COUNT; i++)
+		_ps_write_section(file, &written, header.sectionOffsets[i], sections[i],
+		                  header.sectionSizes[i] * _ps_object_element_size((PSobjectSection)i));
 }
 
 PSast* ps_load_ast(std::string path)
@@ -232,573 +727,3317 @@ PSast* ps_load_ast(std::string path)
 
 PSast* ps_load_ast(std::ifstream& file)
 {
-	PSast* result = new PSast;
-
-	size_t parentNodeSize;
-	size_t nodePoolSize;
-
-	file.read((char*)&parentNodeSize, sizeof(size_t));
-	result->parentNodes.resize(parentNodeSize);
-	file.read((char*)result->parentNodes.data(), sizeof(PSnodeHandle) * parentNodeSize);
-
-	file.read((char*)&nodePoolSize, sizeof(size_t));
-	for(int i = 0; i < nodePoolSize; i++)
+	//packed files are read whole and decoded from memory:
+	std::streampos start = file.tellg();
+	char magic[4];
+	file.read(magic, sizeof(magic));
+	if(file && std::memcmp(magic, PS_PACKED_MAGIC, sizeof(magic)) == 0)
 	{
-		PSnode node;
-		file.read((char*)&node.type, sizeof(PSnode::Type));
-		file.read((char*)&node.lineNum, sizeof(uint32_t));
-
-		switch(node.type)
+		file.seekg(0, std::ios_base::end);
+		std::vector<char> data((size_t)(file.tellg() - start));
+		file.seekg(start);
+		file.read(data.data(), data.size());
+		if(!file)
 		{
-		case PSnode::Type::OP:
-		{
-			file.read((char*)&node.op, sizeof(PSnode::OP));
-			file.read((char*)&node.op.left, sizeof(PSnodeHandle));
-			file.read((char*)&node.op.right, sizeof(PSnodeHandle));
-			break;
+			std::cout << "PROPSCRIPT LOAD ERROR: PACKED OBJECT FILE COULD NOT BE READ" << std::endl;
+			return nullptr;
 		}
-		case PSnode::Type::KEYWORD:
-		{
-			file.read((char*)&node.keyword.type, sizeof(PSnode::Keyword::Type));
-
-			size_t codeSize;
-			size_t elseCodeSize;
-			size_t paramNameSize;
 
-			file.read((char*)&codeSize, sizeof(size_t));
-			node.keyword.code.resize(codeSize);
-			file.read((char*)node.keyword.code.data(), sizeof(PSnodeHandle) * codeSize);
+		return ps_decode_ast(data.data(), data.size());
+	}
 
-			file.read((char*)&node.keyword.condition, sizeof(PSnodeHandle));
+	file.clear();
+	file.seekg(start);
 
-			file.read((char*)&node.keyword.hasElse, sizeof(bool));
-			file.read((char*)&elseCodeSize, sizeof(size_t));
-			node.keyword.elseCode.resize(elseCodeSize);
-			file.read((char*)node.keyword.elseCode.data(), sizeof(PSnodeHandle) * elseCodeSize);
+	//files that don't start with a header are in the unversioned format:
+	PSobjectHeader header;
+	file.read((char*)&header, sizeof(PSobjectHeader));
+	if(!file || std::memcmp(header.magic, PS_OBJECT_MAGIC, sizeof(header.magic)) != 0)
+	{
+		file.clear();
+		file.seekg(start);
+		return _ps_load_unversioned_ast(file);
+	}
 
-			size_t nameLen;
-			file.read((char*)&nameLen, sizeof(size_t));
-			node.keyword.name.resize(nameLen);
-			file.read(node.keyword.name.data(), sizeof(char) * nameLen);
-			file.read((char*)&paramNameSize, sizeof(size_t));
-			node.keyword.paramNames.resize(paramNameSize);
-			for(int j = 0; j < paramNameSize; j++)
-			{
-				size_t paramNameLen;
-				file.read((char*)&paramNameLen, sizeof(size_t));
-				node.keyword.paramNames[j].resize(paramNameLen);
-				file.read(node.keyword.paramNames[j].data(), sizeof(char) * paramNameLen);
-			}
+	file.seekg(0, std::ios_base::end);
+	std::streamoff size = file.tellg() - start;
+	if(!_ps_valid_object_header(header, (size_t)size))
+	{
+		std::cout << "PROPSCRIPT LOAD ERROR: UNSUPPORTED OBJECT FILE VERSION OR LAYOUT" << std::endl;
+		return nullptr;
+	}
 
-			file.read((char*)&node.keyword.returnVal, sizeof(PSnodeHandle));
+	//read each section straight into the array it was saved from:
+	PSast* result = new PSast;
+	result->parentNodes.resize(header.sectionSizes[PS_OBJECT_SECTION_PARENT_NODES]);
+	result->nodePool.resize(header.sectionSizes[PS_OBJECT_SECTION_NODES]);
+	result->lists.resize(header.sectionSizes[PS_OBJECT_SECTION_LISTS]);
+	result->constants.resize(header.sectionSizes[PS_OBJECT_SECTION_CONSTANTS]);
+	std::vector<uint32_t> symbolOffsets(header.sectionSizes[PS_OBJECT_SECTION_SYMBOL_OFFSETS]);
+	std::string symbolNames(header.sectionSizes[PS_OBJECT_SECTION_SYMBOL_NAMES], '\0');
+
+	void* sections[PS_OBJECT_SECTION_COUNT] = {
+		result->parentNodes.data(),
+		result->nodePool.data(),
+		result->lists.data(),
+		symbolOffsets.data(),
+		symbolNames.data(),
+		result->constants.data(),
+		nullptr //every body is loaded, so the function table isn't needed
+	};
+
+	for(int i = 0; i < PS_OBJECT_SECTION_FUNCTIONS && file; i++)
+	{
+		file.seekg(start + (std::streamoff)header.sectionOffsets[i]);
+		file.read((char*)sections[i], header.sectionSizes[i] * _ps_object_element_size((PSobjectSection)i));
+	}
 
-			break;
-		}
-		case PSnode::ID:
-		{
-			file.read((char*)&node.id.type, sizeof(PSnode::ID::Type));
+	if(!file)
+	{
+		std::cout << "PROPSCRIPT LOAD ERROR: OBJECT FILE IS TRUNCATED" << std::endl;
+		delete result;
+		return nullptr;
+	}
 
-			size_t nameLen;
-			file.read((char*)&nameLen, sizeof(size_t));
-			node.id.name.resize(nameLen);
-			file.read(node.id.name.data(), sizeof(char) * nameLen);
+	//symbols are interned in order so their ids match the saved ast, which also builds the table's hash buckets:
+	bool valid = _ps_valid_symbol_offsets(symbolOffsets.data(), symbolOffsets.size(), symbolNames.size());
+	for(uint32_t i = 0; i < header.numSymbols && valid; i++)
+		valid = ps_intern_symbol(result->symbols, std::string_view(symbolNames.data() + symbolOffsets[i], symbolOffsets[i + 1] - symbolOffsets[i])) == i;
 
-			size_t paramSize;
-			file.read((char*)&paramSize, sizeof(size_t));
-			node.id.params.resize(paramSize);
-			file.read((char*)node.id.params.data(), sizeof(PSnodeHandle) * paramSize);
+	if(!valid || !_ps_valid_loaded_ast(result))
+	{
+		std::cout << "PROPSCRIPT LOAD ERROR: OBJECT FILE IS CORRUPT" << std::endl;
+		delete result;
+		return nullptr;
+	}
 
-			break;
-		}
-		case PSnode::NUMBER:
-		{
-			file.read((char*)&node.literal.type, sizeof(PSnode::Literal::Type));
-			file.read((char*)&node.literal.intNum, sizeof(int32_t));
-			file.read((char*)&node.literal.floatNum, sizeof(float));
+	return result;
+}
 
-			break;
-		}
-		}
+PSobject* ps_map_object(std::string path)
+{
+	std::shared_ptr<const char> data;
+	size_t size;
+	if(!ps_map_file(path, &data, &size))
+	{
+		std::cout << "ERROR OPENING FILE \"" << path << "\" FOR READING" << std::endl;
+		return nullptr;
+	}
 
-		result->nodePool.push_back(node);
+	const PSobjectHeader* header = (const PSobjectHeader*)data.get();
+	if(size < sizeof(PSobjectHeader) || std::memcmp(header->magic, PS_OBJECT_MAGIC, sizeof(header->magic)) != 0 || !_ps_valid_object_header(*header, size) ||
+	   !_ps_valid_object_functions((const PSobjectFunction*)(data.get() + header->sectionOffsets[PS_OBJECT_SECTION_FUNCTIONS]),
+	                               header->sectionSizes[PS_OBJECT_SECTION_FUNCTIONS], header->sectionSizes[PS_OBJECT_SECTION_NODES],
+	                               header->sectionSizes[PS_OBJECT_SECTION_LISTS]))
+	{
+		std::cout << "PROPSCRIPT LOAD ERROR: \"" << path << "\" IS NOT AN OBJECT FILE OF THIS VERSION AND LAYOUT" << std::endl;
+		return nullptr;
 	}
 
-	return result;
-}
+	//point the view at each section of the mapping, nothing is copied:
+	PSobject* object = new PSobject;
+	object->ast = _ps_object_view(data.get(), header->sectionOffsets, header->sectionSizes);
+	object->functions = (const PSobjectFunction*)(data.get() + header->sectionOffsets[PS_OBJECT_SECTION_FUNCTIONS]);
+	object->numFunctions = (uint32_t)header->sectionSizes[PS_OBJECT_SECTION_FUNCTIONS];
+	object->data = std::move(data);
+	object->size = size;
 
-//--------------------------------------------------------------------------------------------------------------------------------//
+	return object;
+}
 
-static PSnodeHandle _ps_parse_statement(PSast* ast, const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+PSobject* ps_load_object(std::string path)
 {
-	//CHECK IF CONTROL FLOW STATEMENT:
-	if(tokens[curTokenIdx].str == PS_KEYWORD_IF || tokens[curTokenIdx].str == PS_KEYWORD_FOR)
+	PSobject* object = new PSobject;
+	object->file.open(path, std::ios_base::binary);
+	if(!object->file.is_open())
 	{
-		bool isFor = tokens[curTokenIdx].str == PS_KEYWORD_FOR;
+		std::cout << "ERROR OPENING FILE \"" << path << "\" FOR READING" << std::endl;
+		delete object;
+		return nullptr;
+	}
 
-		if(numOpenParens > 0)
-			_ps_error(PSparseError::INVALID_TOKEN, tokens[curTokenIdx]);
+	//the header's sizes are checked against the real size of the file, which the buffer below is allocated from:
+	PSobjectHeader header;
+	object->file.read((char*)&header, sizeof(PSobjectHeader));
+	object->file.seekg(0, std::ios_base::end);
+	std::streamoff size = object->file.tellg();
+	if(!object->file || std::memcmp(header.magic, PS_OBJECT_MAGIC, sizeof(header.magic)) != 0 || !_ps_valid_object_header(header, (size_t)size))
+	{
+		std::cout << "PROPSCRIPT LOAD ERROR: \"" << path << "\" IS NOT AN OBJECT FILE OF THIS VERSION AND LAYOUT" << std::endl;
+		delete object;
+		return nullptr;
+	}
 
-		PSnode controlNode;
-		controlNode.type = PSnode::KEYWORD;
-		controlNode.lineNum = tokens[curTokenIdx].lineNum;
-		controlNode.keyword.type = isFor ? PSnode::Keyword::FOR : PSnode::Keyword::IF;
+	//read into a buffer laid out like the file, left uninitialized so unloaded bodies are never touched:
+	char* buffer = (char*)::operator new[](header.fileSize, std::align_val_t(PS_OBJECT_ALIGNMENT));
+	object->data = std::shared_ptr<const char>(buffer, [](const char* data) { ::operator delete[]((void*)data, std::align_val_t(PS_OBJECT_ALIGNMENT)); });
+	object->size = header.fileSize;
+	object->ast = _ps_object_view(buffer, header.sectionOffsets, header.sectionSizes);
+	object->functions = (const PSobjectFunction*)(buffer + header.sectionOffsets[PS_OBJECT_SECTION_FUNCTIONS]);
+	object->numFunctions = (uint32_t)header.sectionSizes[PS_OBJECT_SECTION_FUNCTIONS];
 
-		//GET CONDITION:
-		controlNode.keyword.condition = _ps_parse_statement(ast, tokens, ++curTokenIdx, numOpenParens);
-		_ps_remove_newline(tokens, curTokenIdx);
+	for(int i = 0; i < PS_OBJECT_SECTION_COUNT && object->file; i++)
+	{
+		if(i == PS_OBJECT_SECTION_NODES || i == PS_OBJECT_SECTION_LISTS)
+			continue;
 
-		//GET CODE:
-		if(tokens[curTokenIdx].str == PS_SEPERATOR_CURLY_OPEN) //multi-line
-		{
-			curTokenIdx++;
-			_ps_remove_newline(tokens, curTokenIdx);
+		object->file.seekg(header.sectionOffsets[i]);
+		object->file.read(buffer + header.sectionOffsets[i], header.sectionSizes[i] * _ps_object_element_size((PSobjectSection)i));
+	}
 
-			while(tokens[curTokenIdx].str != PS_SEPERATOR_CURLY_CLOSE)
-			{
-				controlNode.keyword.code.push_back(_ps_parse_statement(ast, tokens, curTokenIdx, numOpenParens));
-				_ps_remove_newline(tokens, curTokenIdx);
-			}
-		
-			curTokenIdx++;
-		}
-		else //single-line
-			controlNode.keyword.code.push_back(_ps_parse_statement(ast, tokens, curTokenIdx, numOpenParens));
+	if(!object->file || !_ps_valid_object_functions(object->functions, object->numFunctions, object->ast.numNodes, header.sectionSizes[PS_OBJECT_SECTION_LISTS]))
+	{
+		std::cout << "PROPSCRIPT LOAD ERROR: OBJECT FILE \"" << path << "\" IS TRUNCATED OR INVALID" << std::endl;
+		delete object;
+		return nullptr;
+	}
 
-		//IF FOR LOOP, NO ELSE STATEMENT POSSIBLE SO JUST RETURN
-		if(isFor)
-			return _ps_add_node(ast, controlNode);
+	//read the nodes and lists between the bodies:
+	uint64_t node = 0;
+	uint64_t list = 0;
+	for(uint32_t i = 0; i <= object->numFunctions && object->file; i++)
+	{
+		const PSobjectFunction* function = i < object->numFunctions ? &object->functions[i] : nullptr;
+		uint64_t nodeEnd = function ? function->firstNode : object->ast.numNodes;
+		uint64_t nodeOffset = header.sectionOffsets[PS_OBJECT_SECTION_NODES] + node * sizeof(PSnode);
+		if(nodeEnd > node)
+		{
+			object->file.seekg(nodeOffset);
+			object->file.read(buffer + nodeOffset, (nodeEnd - node) * sizeof(PSnode));
+		}
+		if(function)
+			node = nodeEnd + function->numNodes;
 
-		//CHECK FOR ELSE:
-		_ps_remove_newline(tokens, curTokenIdx);
+		if(function && function->listsSize == 0)
+			continue;
 
-		if(tokens[curTokenIdx].str == PS_KEYWORD_ELSE)
+		uint64_t listEnd = function ? function->firstList : header.sectionSizes[PS_OBJECT_SECTION_LISTS];
+		uint64_t listOffset = header.sectionOffsets[PS_OBJECT_SECTION_LISTS] + list * sizeof(uint32_t);
+		if(listEnd > list)
 		{
-			controlNode.keyword.hasElse = true;
+			object->file.seekg(listOffset);
+			object->file.read(buffer + listOffset, (listEnd - list) * sizeof(uint32_t));
+		}
+		if(function)
+			list = listEnd + function->listsSize;
+	}
 
-			curTokenIdx++;
-			_ps_remove_newline(tokens, curTokenIdx);
-			if(tokens[curTokenIdx].str == PS_SEPERATOR_CURLY_OPEN) //multi-line
-			{
-				curTokenIdx++;
-				_ps_remove_newline(tokens, curTokenIdx);
-
-				while(tokens[curTokenIdx].str != PS_SEPERATOR_CURLY_CLOSE)
-				{
-					controlNode.keyword.elseCode.push_back(_ps_parse_statement(ast, tokens, curTokenIdx, numOpenParens));
-					_ps_remove_newline(tokens, curTokenIdx);
-				}
-			
-				curTokenIdx++;
-			}
-			else //single-line / else-if
-				controlNode.keyword.elseCode.push_back(_ps_parse_statement(ast, tokens, curTokenIdx, numOpenParens));
-		}
-		else
-			controlNode.keyword.hasElse = false;
-
-		return _ps_add_node(ast, controlNode);
+	if(!object->file)
+	{
+		std::cout << "PROPSCRIPT LOAD ERROR: OBJECT FILE \"" << path << "\" IS TRUNCATED" << std::endl;
+		delete object;
+		return nullptr;
 	}
 
-	//CHECK IF FUNCTION DEFINITION:
-	if(tokens[curTokenIdx].str == PS_KEYWORD_FUNC)
+	//check everything outside the bodies now, each body is checked when it's read:
+	PSloadBounds bounds;
+	object->numConstants = header.sectionSizes[PS_OBJECT_SECTION_CONSTANTS];
+	if(!_ps_valid_symbol_offsets(object->ast.symbolStarts, header.sectionSizes[PS_OBJECT_SECTION_SYMBOL_OFFSETS], header.sectionSizes[PS_OBJECT_SECTION_SYMBOL_NAMES]) ||
+	   !_ps_valid_constants(object->ast.constants, object->numConstants) ||
+	   !_ps_object_parent_bounds(object->ast, object->functions, object->numFunctions, header.sectionSizes[PS_OBJECT_SECTION_LISTS], object->numConstants, &bounds) ||
+	   !_ps_valid_nodes(bounds))
 	{
-		PSnode funcNode;
-		funcNode.type = PSnode::KEYWORD;
-		funcNode.lineNum = tokens[curTokenIdx].lineNum;
-		funcNode.keyword.type = PSnode::Keyword::FUNC;
-
-		curTokenIdx++;
-		_ps_remove_newline(tokens, curTokenIdx);
+		std::cout << "PROPSCRIPT LOAD ERROR: OBJECT FILE \"" << path << "\" IS CORRUPT" << std::endl;
+		delete object;
+		return nullptr;
+	}
 
-		_ps_force_id(tokens[curTokenIdx]);
+	object->loaded.assign(object->numFunctions, false);
+	return object;
+}
 
-		funcNode.keyword.name = tokens[curTokenIdx].str;
-		curTokenIdx++;
-		_ps_remove_newline(tokens, curTokenIdx);
+bool ps_object_load_function(PSobject* object, uint32_t function)
+{
+	if(function >= object->loaded.size() || object->loaded[function])
+		return true;
+
+	//read the body's nodes and lists into their place in the buffer:
+	const PSobjectFunction& func = object->functions[function];
+	char* nodes = (char*)(object->ast.nodePool + func.firstNode);
+	char* lists = (char*)(object->ast.lists + func.firstList);
+	object->file.seekg(nodes - object->data.get());
+	object->file.read(nodes, (uint64_t)func.numNodes * sizeof(PSnode));
+	object->file.seekg(lists - object->data.get());
+	object->file.read(lists, (uint64_t)func.listsSize * sizeof(uint32_t));
+
+	PSloadBounds bounds = {object->ast.nodePool, object->ast.lists, object->ast.numSymbols, object->numConstants,
+	                       func.firstNode, (uint64_t)func.firstNode + func.numNodes, func.firstList, (uint64_t)func.firstList + func.listsSize};
+	if(!object->file || !_ps_valid_nodes(bounds))
+	{
+		object->file.clear();
+		return false;
+	}
 
-		if(tokens[curTokenIdx].str == PS_SEPERATOR_PAREN_OPEN) //has parameters
-		{
-			curTokenIdx++;
-			numOpenParens++;
-			_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+	object->loaded[function] = true;
+	return true;
+}
 
-			//argument names:
-			while(true)
-			{
-				_ps_force_id(tokens[curTokenIdx]);
-				funcNode.keyword.paramNames.push_back(tokens[curTokenIdx].str);
-				curTokenIdx++;
+void ps_unmap_object(PSobject* object)
+{
+	delete object;
+}
 
-				if(tokens[curTokenIdx].str == PS_SEPERATOR_PAREN_CLOSE)
-					break;
-				else if(tokens[curTokenIdx].str != PS_SEPERATOR_COMMA)
-					_ps_error(PSparseError::EXPECTED_OPERATOR, tokens[curTokenIdx]);
+bool ps_save_archive(std::string path, const std::vector<std::string>& names, const std::vector<PSast*>& asts)
+{
+	if(names.size() != asts.size() || names.size() > UINT32_MAX)
+	{
+		std::cout << "PROPSCRIPT ARCHIVE ERROR: EVERY SCRIPT NEEDS EXACTLY ONE NAME" << std::endl;
+		return false;
+	}
 
-				curTokenIdx++;
-				_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
-			}
+	//sort the scripts by name so they can be found with a binary search:
+	std::vector<uint32_t> order(names.size());
+	for(uint32_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&names](uint32_t a, uint32_t b) { return names[a] < names[b]; });
 
-			curTokenIdx++;
-			numOpenParens--;
+	for(size_t i = 1; i < order.size(); i++)
+		if(names[order[i]] == names[order[i - 1]])
+		{
+			std::cout << "PROPSCRIPT ARCHIVE ERROR: SCRIPT NAME \"" << names[order[i]] << "\" IS USED MORE THAN ONCE" << std::endl;
+			return false;
 		}
 
-		_ps_remove_newline(tokens, curTokenIdx);
-
-		//GET CODE:
-		if(tokens[curTokenIdx].str != PS_SEPERATOR_CURLY_OPEN) //ensure open curly brace found
-			_ps_error(PSparseError::EXPECTED_OPENING_CURLY, tokens[curTokenIdx]);
+	//intern every script and symbol name into one table, so shared names are stored once:
+	PSsymbolTable strings;
+	std::vector<PSarchiveEntry> entries(order.size());
+	std::vector<std::vector<uint32_t>> symbolOffsets(order.size());
+	std::vector<std::vector<PSobjectFunction>> functions(order.size());
+	for(size_t i = 0; i < order.size(); i++)
+	{
+		PSast* ast = asts[order[i]];
+		PSarchiveEntry& entry = entries[i];
 
-		curTokenIdx++;
-		_ps_remove_newline(tokens, curTokenIdx);
+		uint32_t name = ps_intern_symbol(strings, names[order[i]]);
+		entry.nameStart = strings.offsets[name];
+		entry.nameEnd = strings.offsets[name + 1];
+		entry.numSymbols = ps_symbol_count(ast->symbols);
 
-		while(tokens[curTokenIdx].str != PS_SEPERATOR_CURLY_CLOSE)
+		symbolOffsets[i].resize(entry.numSymbols * 2);
+		for(uint32_t j = 0; j < entry.numSymbols; j++)
 		{
-			funcNode.keyword.code.push_back(_ps_parse_statement(ast, tokens, curTokenIdx, numOpenParens));
-			_ps_remove_newline(tokens, curTokenIdx);
+			uint32_t symbol = ps_intern_symbol(strings, ps_symbol_name(ast->symbols, j));
+			symbolOffsets[i][j] = strings.offsets[symbol];
+			symbolOffsets[i][entry.numSymbols + j] = strings.offsets[symbol + 1];
 		}
-		
-		curTokenIdx++;
-
-		return _ps_add_node(ast, funcNode);
 	}
 
-	//CHECK IF RETURN STATEMENT:
-	if(tokens[curTokenIdx].str == PS_KEYWORD_RETURN)
+	//lay out the index and string table after the header, then each script's sections:
+	PSarchiveHeader header = {};
+	std::memcpy(header.magic, PS_ARCHIVE_MAGIC, sizeof(header.magic));
+	header.version = PS_ARCHIVE_VERSION;
+	header.byteOrder = PS_OBJECT_BYTE_ORDER;
+	header.nodeSize = sizeof(PSnode);
+	header.dataSize = sizeof(PSdata);
+	header.numScripts = (uint32_t)entries.size();
+
+	uint64_t offset = _ps_object_align(sizeof(PSarchiveHeader));
+	header.indexOffset = offset;
+	offset = _ps_object_align(offset + entries.size() * sizeof(PSarchiveEntry));
+	header.stringsOffset = offset;
+	header.stringsSize = strings.names.size();
+	offset += header.stringsSize;
+
+	for(size_t i = 0; i < order.size(); i++)
 	{
-		PSnode returnNode;
-		returnNode.type = PSnode::KEYWORD;
-		returnNode.lineNum = tokens[curTokenIdx].lineNum;
-		returnNode.keyword.type = PSnode::Keyword::RETURN;
+		PSast* ast = asts[order[i]];
+		PSarchiveEntry& entry = entries[i];
 
-		curTokenIdx++;
-		if(tokens[curTokenIdx].type != PStoken::NEWLINE &&
-		   std::find(PS_CLOSED_SEPERATORS.begin(), PS_CLOSED_SEPERATORS.end(), tokens[curTokenIdx].str) == PS_CLOSED_SEPERATORS.end()) //get return value if not a void return
-			returnNode.keyword.returnVal = _ps_parse_statement(ast, tokens, curTokenIdx, numOpenParens);
-		else
-			returnNode.keyword.returnVal = UINT32_MAX;
+		entry.sectionSizes[PS_OBJECT_SECTION_PARENT_NODES] = ast->parentNodes.size();
+		entry.sectionSizes[PS_OBJECT_SECTION_NODES] = ast->nodePool.size();
+		entry.sectionSizes[PS_OBJECT_SECTION_LISTS] = ast->lists.size();
+		entry.sectionSizes[PS_OBJECT_SECTION_SYMBOL_OFFSETS] = symbolOffsets[i].size();
+		entry.sectionSizes[PS_OBJECT_SECTION_SYMBOL_NAMES] = 0;
+		entry.sectionSizes[PS_OBJECT_SECTION_CONSTANTS] = ast->constants.size();
+
+		functions[i] = _ps_object_functions(ast);
+		entry.sectionSizes[PS_OBJECT_SECTION_FUNCTIONS] = functions[i].size();
 
-		return _ps_add_node(ast, returnNode);
+		for(int j = 0; j < PS_OBJECT_SECTION_COUNT; j++)
+		{
+			offset = _ps_object_align(offset);
+			entry.sectionOffsets[j] = offset;
+			offset += entry.sectionSizes[j] * _ps_object_element_size((PSobjectSection)j);
+		}
 	}
+	header.fileSize = offset;
 
-	//CHECK IF BREAK/CONTINUE STATEMENT:
-	if(tokens[curTokenIdx].str == PS_KEYWORD_BREAK || tokens[curTokenIdx].str == PS_KEYWORD_CONTINUE)
+	if(header.stringsSize >= UINT32_MAX)
 	{
-		PSnode breakNode;
-		breakNode.type = PSnode::KEYWORD;
-		breakNode.lineNum = tokens[curTokenIdx].lineNum;
-		breakNode.keyword.type = tokens[curTokenIdx].str == PS_KEYWORD_BREAK ? PSnode::Keyword::BREAK : PSnode::Keyword::CONTINUE;
-
-		curTokenIdx++;
-		if(tokens[curTokenIdx].type != PStoken::NEWLINE &&
-		   std::find(PS_CLOSED_SEPERATORS.begin(), PS_CLOSED_SEPERATORS.end(), tokens[curTokenIdx].str) == PS_CLOSED_SEPERATORS.end()) //get return value if not a void return
-			_ps_error(PSparseError::INVALID_TOKEN, tokens[curTokenIdx]);
-
-		return _ps_add_node(ast, breakNode);
+		std::cout << "PROPSCRIPT ARCHIVE ERROR: TOO MANY NAMES TO ARCHIVE" << std::endl;
+		return false;
 	}
 
-	//MUST BE REGULAR OPERATION:
-	PSnodeHandle left;
-	PSnodeHandle right;
+	//WRITE EVERYTHING IN ORDER:
+	std::ofstream file(path, std::ios::out | std::ios::binary);
+	if(!file.is_open())
+	{
+		std::cout << "ERROR OPENING FILE \"" << path << "\" FOR WRITING" << std::endl;
+		return false;
+	}
 
-	//GET LEFT TOKEN:
-	left = _ps_parse_non_op(ast, tokens, curTokenIdx, numOpenParens);
+	uint64_t written = 0;
+	_ps_write_section(file, &written, 0, &header, sizeof(PSarchiveHeader));
+	_ps_write_section(file, &written, header.indexOffset, entries.data(), entries.size() * sizeof(PSarchiveEntry));
+	_ps_write_section(file, &written, header.stringsOffset, strings.names.data(), strings.names.size());
 
-	//CHECK IF LINE ENDED:
-	if(tokens[curTokenIdx].type == PStoken::NEWLINE || tokens[curTokenIdx].str == PS_SEPERATOR_CURLY_OPEN ||
-	   std::find(PS_CLOSED_SEPERATORS.begin(), PS_CLOSED_SEPERATORS.end(), tokens[curTokenIdx].str) != PS_CLOSED_SEPERATORS.end())
-		return left;
+	for(size_t i = 0; i < order.size(); i++)
+	{
+		PSast* ast = asts[order[i]];
+		std::vector<PSnode> nodes = _ps_object_nodes(ast);
+		std::vector<char> constants = _ps_object_constants(ast);
+		const void* sections[PS_OBJECT_SECTION_COUNT] = {
+			ast->parentNodes.data(),
+			nodes.data(),
+			ast->lists.data(),
+			symbolOffsets[i].data(),
+			nullptr,
+			constants.data(),
+			functions[i].data()
+		};
+
+		for(int j = 0; j < PS_OBJECT_SECTION_COUNT; j++)
+			_ps_write_section(file, &written, entries[i].sectionOffsets[j], sections[j],
+			                  entries[i].sectionSizes[j] * _ps_object_element_size((PSobjectSection)j));
+	}
 
-	//GET OP TOKEN:
-	PSnode opNode = _ps_get_op_node(ast, tokens, curTokenIdx, numOpenParens);
+	if(!file)
+	{
+		std::cout << "ERROR WRITING FILE \"" << path << "\"" << std::endl;
+		return false;
+	}
 
-	//GET RIGHT TOKEN:
-	right = _ps_parse_non_op(ast, tokens, curTokenIdx, numOpenParens);
+	return true;
+}
 
-	//CONSTRUCT OP NODE:	
-	opNode.op.inParens = false;
-	opNode.op.left  = left;
-	opNode.op.right = right;
+PSarchive* ps_open_archive(std::string path)
+{
+	std::shared_ptr<const char> data;
+	size_t size;
+	if(!ps_map_file(path, &data, &size))
+	{
+		std::cout << "ERROR OPENING FILE \"" << path << "\" FOR READING" << std::endl;
+		return nullptr;
+	}
 
-	//ITERATE TO GET REST OF NODES:
-	while(curTokenIdx < tokens.size() && tokens[curTokenIdx].type != PStoken::NEWLINE && tokens[curTokenIdx].str != PS_SEPERATOR_CURLY_OPEN &&
-	      std::find(PS_CLOSED_SEPERATORS.begin(), PS_CLOSED_SEPERATORS.end(), tokens[curTokenIdx].str) == PS_CLOSED_SEPERATORS.end())
+	const PSarchiveHeader* header = (const PSarchiveHeader*)data.get();
+	if(size < sizeof(PSarchiveHeader) || !_ps_valid_archive_header(*header, size))
 	{
-		PSnode newOp = _ps_get_op_node(ast, tokens, curTokenIdx, numOpenParens);
+		std::cout << "PROPSCRIPT LOAD ERROR: \"" << path << "\" IS NOT AN ARCHIVE OF THIS VERSION AND LAYOUT" << std::endl;
+		return nullptr;
+	}
 
-		right = _ps_parse_non_op(ast, tokens, curTokenIdx, numOpenParens);
+	PSarchive* archive = new PSarchive;
+	archive->entries = (const PSarchiveEntry*)(data.get() + header->indexOffset);
+	archive->strings = data.get() + header->stringsOffset;
+	archive->stringsSize = (uint32_t)header->stringsSize;
+	archive->numScripts = header->numScripts;
 
-		//ADD TO EXISTING NODES WITH CORRECT ORDER OF OPERATIONS:
-		if(_ps_precedence(newOp.op.type) >= _ps_precedence(opNode.op.type))
-		{
-			newOp.op.left = _ps_add_node(ast, opNode);
-			newOp.op.right = right;
-			opNode = newOp;
-		}
-		else
+	//check every entry once here, reading only the index:
+	for(uint32_t i = 0; i < archive->numScripts; i++)
+	{
+		const PSarchiveEntry& entry = archive->entries[i];
+		if(entry.nameStart > entry.nameEnd || entry.nameEnd > header->stringsSize ||
+		   !_ps_valid_sections(entry.sectionOffsets, entry.sectionSizes, header->stringsOffset, header->fileSize) ||
+		   entry.sectionSizes[PS_OBJECT_SECTION_SYMBOL_OFFSETS] != (uint64_t)entry.numSymbols * 2)
 		{
-			//find rightmost op with lesser order:
-			PSnode* rightMost = &opNode;
-			PSnode rightModeRight = ast->nodePool[rightMost->op.right];
-			while(rightModeRight.type == PSnode::OP && 
-			     _ps_precedence(newOp.op.type) < _ps_precedence(rightModeRight.op.type) && 
-			     !rightModeRight.op.inParens)
-			{
-				rightMost = &ast->nodePool[rightMost->op.right];
-				rightModeRight = ast->nodePool[rightMost->op.right];
-			}
-
-			newOp.op.left = rightMost->op.right;
-			newOp.op.right = right;
-			rightMost->op.right = _ps_add_node(ast, newOp);
+			std::cout << "PROPSCRIPT LOAD ERROR: ARCHIVE \"" << path << "\" HAS AN INVALID INDEX" << std::endl;
+			delete archive;
+			return nullptr;
 		}
 	}
 
-	return _ps_add_node(ast, opNode);
+	archive->data = std::move(data);
+	archive->size = size;
+
+	return archive;
 }
 
-//--------------------------------------------------------------------------------------------------------------------------------//
+void ps_close_archive(PSarchive* archive)
+{
+	delete archive;
+}
 
-static PSnodeHandle _ps_parse_non_op(PSast* ast, const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+PSobject* ps_archive_find(PSarchive* archive, std::string_view name)
 {
-	PSnodeHandle node;
+	const PSarchiveEntry* entry = _ps_find_archive_entry(archive, name);
+	if(!entry)
+		return nullptr;
 
-	if(tokens[curTokenIdx].str == PS_SEPERATOR_PAREN_OPEN)
-		node = _ps_parse_statement_in_parens(ast, tokens, curTokenIdx, numOpenParens);
-	else
-		node = _ps_parse_id(ast, tokens, curTokenIdx, numOpenParens);
+	if(!_ps_valid_object_functions((const PSobjectFunction*)(archive->data.get() + entry->sectionOffsets[PS_OBJECT_SECTION_FUNCTIONS]),
+	                               entry->sectionSizes[PS_OBJECT_SECTION_FUNCTIONS], entry->sectionSizes[PS_OBJECT_SECTION_NODES],
+	                               entry->sectionSizes[PS_OBJECT_SECTION_LISTS]))
+	{
+		std::cout << "PROPSCRIPT LOAD ERROR: SCRIPT \"" << name << "\" HAS AN INVALID FUNCTION TABLE" << std::endl;
+		return nullptr;
+	}
 
-	_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
-	return node;
+	PSobject* object = new PSobject;
+	object->ast = _ps_archive_view(archive, *entry);
+	object->functions = (const PSobjectFunction*)(archive->data.get() + entry->sectionOffsets[PS_OBJECT_SECTION_FUNCTIONS]);
+	object->numFunctions = (uint32_t)entry->sectionSizes[PS_OBJECT_SECTION_FUNCTIONS];
+	object->data = archive->data;
+	object->size = archive->size;
+
+	return object;
 }
 
-static PSnodeHandle _ps_parse_statement_in_parens(PSast* ast, const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+PSast* ps_archive_load_ast(PSarchive* archive, std::string_view name)
 {
-	PSnodeHandle node = _ps_parse_statement(ast, tokens, ++curTokenIdx, ++numOpenParens);
-	if(tokens[curTokenIdx].str != PS_SEPERATOR_PAREN_CLOSE)
-		_ps_error(PSparseError::EXPECTED_CLOSING_PAREN, tokens[curTokenIdx]);
+	const PSarchiveEntry* entry = _ps_find_archive_entry(archive, name);
+	if(!entry)
+		return nullptr;
+
+	//copy the script's sections out of the mapping:
+	PSastView view = _ps_archive_view(archive, *entry);
+	PSast* result = new PSast;
+	result->parentNodes.assign(view.parentNodes, view.parentNodes + view.numParentNodes);
+	result->nodePool.assign(view.nodePool, view.nodePool + view.numNodes);
+	result->lists.assign(view.lists, view.lists + entry->sectionSizes[PS_OBJECT_SECTION_LISTS]);
+	result->constants.assign(view.constants, view.constants + entry->sectionSizes[PS_OBJECT_SECTION_CONSTANTS]);
 
-	ast->nodePool[node].op.inParens = true;
+	//symbols are interned in order so their ids match the archived ast:
+	bool valid = true;
+	for(uint32_t i = 0; i < view.numSymbols && valid; i++)
+		valid = ps_intern_symbol(result->symbols, view.symbol_name(i)) == i;
 
-	numOpenParens--;
-	curTokenIdx++;
-	return node;
+	if(!valid || !_ps_valid_loaded_ast(result))
+	{
+		std::cout << "PROPSCRIPT LOAD ERROR: SCRIPT \"" << name << "\" IS INVALID" << std::endl;
+		delete result;
+		return nullptr;
+	}
+
+	return result;
 }
 
-static PSnodeHandle _ps_parse_id(PSast* ast, const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+PSast* ps_compile_cached(std::string sourcePath, std::string cacheDir)
 {
-	bool negative = false;
-	if(tokens[curTokenIdx].str == PS_OP_SUB)
+	std::shared_ptr<const char> source;
+	size_t size;
+	if(!ps_map_file(sourcePath, &source, &size))
 	{
-		negative = true;
-		curTokenIdx++;
+		std::cout << "PROPSCRIPT LEX ERROR: FAILED TO OPEN \"" << sourcePath << "\" FOR READING" << std::endl;
+		return nullptr;
 	}
 
-	_ps_force_id(tokens[curTokenIdx]);
+	//name the entry by everything the compiled ast depends on:
+	uint64_t hash = 14695981039346656037ull; //FNV-1a
+	uint64_t key[] = {PS_COMPILER_VERSION, PS_OBJECT_VERSION, sizeof(PSnode), sizeof(PSdata), ps_host_hash(), size};
+	hash = _ps_hash_bytes(hash, key, sizeof(key));
+	hash = _ps_hash_bytes(hash, source.get(), size);
 
-	//FUNCTION:
-	if(tokens[curTokenIdx + 1].str == PS_SEPERATOR_PAREN_OPEN)
-	{
-		PSnode funcNode;
-		funcNode.type = PSnode::ID;
-		funcNode.lineNum = tokens[curTokenIdx].lineNum;
-		funcNode.id.type = PSnode::ID::FUNC;
-		funcNode.id.name = tokens[curTokenIdx].str;
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.psobj", (unsigned long long)hash);
+	std::string path = (std::filesystem::path(cacheDir) / name).string();
 
-		curTokenIdx += 2;
-		numOpenParens++;
-		_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+	//entries are only renamed into place so one that opens is complete, anything not current is replaced:
+	std::ifstream file(path, std::ios_base::binary);
+	char magic[4];
+	if(file.is_open() && file.read(magic, sizeof(magic)) && std::memcmp(magic, PS_OBJECT_MAGIC, sizeof(magic)) == 0)
+	{
+		file.seekg(0);
+		PSast* cached = ps_load_ast(file);
+		if(cached)
+			return cached;
+	}
+	file.close();
 
-		//0 argument function:
-		if(tokens[curTokenIdx].str == PS_SEPERATOR_PAREN_CLOSE)
-		{
-			curTokenIdx++;
-			numOpenParens--;
-			return _ps_add_node(ast, funcNode);
-		}
+	//compile the source and cache it, failing to write the entry is not an error:
+	PSast* result = ps_parse_source(source.get(), size);
+	if(!result)
+		return nullptr;
 
-		//arguments:
-		while(true)
-		{
-			funcNode.id.params.push_back(_ps_parse_statement(ast, tokens, curTokenIdx, numOpenParens));
+	ps_fold_constants(result);
+	ps_compact_ast(result);
 
-			if(tokens[curTokenIdx].str == PS_SEPERATOR_PAREN_CLOSE)
-				break;
-			else if(tokens[curTokenIdx].str != PS_SEPERATOR_COMMA)
-				_ps_error(PSparseError::EXPECTED_OPERATOR, tokens[curTokenIdx]);
+	std::error_code error;
+	std::filesystem::create_directories(cacheDir, error);
+	if(!_ps_save_ast_atomic(path, result))
+		std::cout << "PROPSCRIPT CACHE ERROR: FAILED TO WRITE \"" << path << "\"" << std::endl;
 
-			curTokenIdx++;
-			_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
-		}
+	return result;
+}
 
-		curTokenIdx++;
-		numOpenParens--;
+std::vector<char> ps_encode_ast(PSast* ast, bool compress)
+{
+	std::vector<char> payload;
+	if(!_ps_encode_packed_payload(ast, payload))
+	{
+		std::cout << "PROPSCRIPT SAVE ERROR: THE AST'S LISTS ARE NOT STORED ONE AFTER ANOTHER" << std::endl;
+		return {};
+	}
 
-		if(negative)
-		{
-			PSnode minusNode;
-			minusNode.type = PSnode::OP;
-			minusNode.lineNum = tokens[curTokenIdx].lineNum;
-			minusNode.op.type = PSnode::OP::SUB;
-			
-			PSnode negOne;
-			negOne.type = PSnode::NUMBER;
-			negOne.lineNum = tokens[curTokenIdx].lineNum;
-			negOne.literal.type = PSnode::Literal::INT;
-			negOne.literal.intNum = -1;
+	//the header is the magic followed by varints, so it doesn't depend on byte order:
+	std::vector<char> result(PS_PACKED_MAGIC, PS_PACKED_MAGIC + 4);
+	_ps_write_varint(result, PS_PACKED_VERSION);
+	_ps_write_varint(result, compress ? PS_PACKED_COMPRESSED : 0);
+	_ps_write_varint(result, payload.size());
 
-			minusNode.op.left = _ps_add_node(ast, negOne);
-			minusNode.op.right = _ps_add_node(ast, funcNode);
-			return _ps_add_node(ast, minusNode);
-		}
-		else
-			return _ps_add_node(ast, funcNode);
+	if(!compress)
+	{
+		result.insert(result.end(), payload.begin(), payload.end());
+		return result;
 	}
-	
-	PStoken token = tokens[curTokenIdx++];
 
-	//NUMBER:
-	if(std::isdigit(token.str[0]) || token.str[0] == '.')
+	//each block is its size and compressed size, or stored as is if compressing doesn't shrink it:
+	std::vector<char> block;
+	for(size_t offset = 0; offset < payload.size(); offset += PS_PACKED_BLOCK_SIZE)
 	{
-		bool isFloat = false;
-		for(int i = 0; i < token.str.length(); i++)
-		{
-			if(token.str[i] == '.')
-			{
-				if(isFloat)
-					_ps_error(PSparseError::INVALID_TOKEN, tokens[curTokenIdx]);
-				else
-					isFloat = true;
-			}
-			else if(!std::isdigit(token.str[i]))
-				_ps_error(PSparseError::INVALID_TOKEN, tokens[curTokenIdx]);
-		}
+		size_t size = std::min(payload.size() - offset, (size_t)PS_PACKED_BLOCK_SIZE);
+		const uint8_t* data = (const uint8_t*)payload.data() + offset;
 
-		PSnode numNode;
-		numNode.type = PSnode::NUMBER;
-		numNode.lineNum = tokens[curTokenIdx - 1].lineNum;
+		block.clear();
+		_ps_compress_block(data, size, block);
 
-		if(isFloat)
+		_ps_write_varint(result, size);
+		if(block.size() < size)
 		{
-			numNode.literal.type = PSnode::Literal::FLOAT;
-			numNode.literal.floatNum = std::stof(token.str);
-			if(negative)
-				numNode.literal.floatNum *= -1.0f;
+			_ps_write_varint(result, block.size());
+			result.insert(result.end(), block.begin(), block.end());
 		}
 		else
 		{
-			numNode.literal.type = PSnode::Literal::INT;
-			numNode.literal.intNum = std::stoi(token.str);
-			if(negative)
-				numNode.literal.intNum *= -1;
+			_ps_write_varint(result, size);
+			result.insert(result.end(), (const char*)data, (const char*)data + size);
 		}
-
-		return _ps_add_node(ast, numNode);
 	}
-	
-	//VARIABLE:
-	PSnode varNode;
-	varNode.type = PSnode::ID;
-	varNode.lineNum = tokens[curTokenIdx].lineNum;
-	varNode.id.type = PSnode::ID::VAR;
-	varNode.id.name = token.str;
 
-	//index into variable:
-	if(tokens[curTokenIdx].str == PS_SEPERATOR_SQUARE_OPEN)
+	return result;
+}
+
+PSast* ps_decode_ast(const char* data, size_t size)
+{
+	PSpackedReader reader = {(const uint8_t*)data, (const uint8_t*)data + size, false};
+	if(size < 4 || std::memcmp(data, PS_PACKED_MAGIC, 4) != 0)
 	{
-		numOpenParens++;
-		_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+		std::cout << "PROPSCRIPT LOAD ERROR: NOT A PACKED OBJECT" << std::endl;
+		return nullptr;
+	}
+	reader.cur += 4;
 
-		varNode.id.params.push_back(_ps_parse_statement(ast, tokens, ++curTokenIdx, numOpenParens));
-		
-		_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
-		if(tokens[curTokenIdx].str != PS_SEPERATOR_SQUARE_CLOSE)
-			_ps_error(PSparseError::EXPECTED_CLOSING_PAREN, tokens[curTokenIdx]);
-		
-		numOpenParens--;
-		curTokenIdx++;
+	uint64_t version = _ps_read_varint(reader);
+	uint64_t flags = _ps_read_varint(reader);
+	uint64_t payloadSize = _ps_read_varint(reader);
+	if(reader.failed || version != PS_PACKED_VERSION || (flags & ~(uint64_t)PS_PACKED_COMPRESSED) != 0)
+	{
+		std::cout << "PROPSCRIPT LOAD ERROR: UNSUPPORTED PACKED OBJECT VERSION" << std::endl;
+		return nullptr;
 	}
 
-	if(negative)
+	//uncompressed payloads are decoded in place, compressed ones are decompressed first:
+	PSast* result = nullptr;
+	if(!(flags & PS_PACKED_COMPRESSED))
 	{
-		PSnode minusNode;
-		minusNode.type = PSnode::OP;
-		minusNode.lineNum = tokens[curTokenIdx].lineNum;
-		minusNode.op.type = PSnode::OP::SUB;
-			
-		PSnode negOne;
-		negOne.type = PSnode::NUMBER;
-		negOne.lineNum = tokens[curTokenIdx].lineNum;
-		negOne.literal.type = PSnode::Literal::INT;
-		negOne.literal.intNum = -1;
-
-		minusNode.op.left = _ps_add_node(ast, negOne);
-		minusNode.op.right = _ps_add_node(ast, varNode);
-		return _ps_add_node(ast, minusNode);
+		if(payloadSize == (uint64_t)(reader.end - reader.cur))
+			result = _ps_decode_packed_payload(reader.cur, payloadSize);
 	}
-	else
-		return _ps_add_node(ast, varNode);
+	else if(payloadSize / PS_PACKED_BLOCK_SIZE < size) //every block takes at least a byte, so a larger size can't be valid
+	{
+		std::vector<uint8_t> payload(payloadSize);
+		size_t offset = 0;
+		while(offset < payloadSize && !reader.failed)
+		{
+			uint64_t blockSize = _ps_read_varint(reader);
+			uint64_t storedSize = _ps_read_varint(reader);
+			if(reader.failed || blockSize == 0 || blockSize > PS_PACKED_BLOCK_SIZE || blockSize > payloadSize - offset ||
+			   storedSize > (uint64_t)(reader.end - reader.cur))
+				break;
+
+			PSpackedReader block = {reader.cur, reader.cur + storedSize, false};
+			if(storedSize == blockSize)
+				std::memcpy(payload.data() + offset, block.cur, blockSize);
+			else if(!_ps_decompress_block(block, payload.data() + offset, blockSize))
+				break;
+
+			reader.cur += storedSize;
+			offset += blockSize;
+		}
+
+		if(offset == payloadSize && reader.cur == reader.end)
+			result = _ps_decode_packed_payload(payload.data(), payload.size());
+	}
+
+	if(!result)
+		std::cout << "PROPSCRIPT LOAD ERROR: PACKED OBJECT IS CORRUPT" << std::endl;
+
+	return result;
 }
 
-static PSnode _ps_get_op_node(PSast* ast, const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+void ps_save_packed_ast(std::string path, PSast* ast, bool compress)
 {
-	//ENSURE ACTUALLY AN OP:
-	if(tokens[curTokenIdx].type != PStoken::OP)
-		_ps_error(PSparseError::EXPECTED_OPERATOR, tokens[curTokenIdx]);
+	std::vector<char> data = ps_encode_ast(ast, compress);
+	if(data.empty())
+		return;
 
-	PSnode opNode;
-	opNode.type = PSnode::OP;
-	opNode.lineNum = tokens[curTokenIdx].lineNum;
-	if(PS_STRING_TO_OP_TYPE.count(tokens[curTokenIdx].str) == 0)
-		_ps_error(PSparseError::INVALID_TOKEN, tokens[curTokenIdx]);
-	else
-		opNode.op.type = PS_STRING_TO_OP_TYPE.at(tokens[curTokenIdx].str);
+	std::ofstream file(path, std::ios_base::binary);
+	if(!file.is_open())
+	{
+		std::cout << "ERROR OPENING FILE \"" << path << "\" FOR WRITING" << std::endl;
+		return;
+	}
 
-	curTokenIdx++;
-	_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
-	return opNode;
+	file.write(data.data(), data.size());
+	file.close();
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------//
 
-static inline PSnodeHandle _ps_add_node(PSast* ast, PSnode node)
+static PSast* _ps_parse(PSparseTokens& tokens)
 {
-	ast->nodePool.push_back(node);
-	return ast->nodePool.size() - 1;
-}
+	PSast* result = new PSast;
 
-static inline void _ps_continue_statement(const std::vector<PStoken>& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
-{
-	if(tokens[curTokenIdx].type == PStoken::NEWLINE && numOpenParens != 0)
+	try
 	{
-		curTokenIdx++;
-		if(curTokenIdx >= tokens.size())
-			_ps_error(PSparseError::EXPECTED_CLOSING_PAREN, tokens[curTokenIdx - 1]);
+		uint32_t curTokenIdx = 0;
+		uint32_t numOpenParens = 0;
+		g_psListStack.clear(); //a failed parse can leave elements behind
+
+		//RESERVE MEMORY, scripts average about 0.6 nodes and 0.3 list elements per token, leave some headroom so the pool rarely regrows:
+		if(tokens.buffer)
+		{
+			result->nodePool.reserve(tokens.buffer->size() * 3 / 4);
+			result->lists.reserve(tokens.buffer->size() / 3);
+		}
+
+		//large token buffers are parsed in parallel, on error they're parsed again below so the error is reported:
+		size_t numThreads = g_psParseThreads > 0 ? g_psParseThreads : std::max(std::thread::hardware_concurrency(), 1u);
+		size_t numChunks = tokens.buffer ? std::min(numThreads, tokens.buffer->size() / PS_PARALLEL_MIN_CHUNK_TOKENS) : 0;
+		if(numChunks <= 1 || !_ps_parse_parallel(result, *tokens.buffer, numChunks))
+		{
+			result->parentNodes.clear();
+			result->nodePool.clear();
+			result->lists.resize(1);
+
+			while(!_ps_at_end(tokens, curTokenIdx))
+			{
+				result->parentNodes.push_back(_ps_parse_statement(result, tokens, curTokenIdx, numOpenParens, 1));
+				_ps_remove_newline(tokens, curTokenIdx);
+			}
+		}
+
+		//nodes reference the symbols the lexer interned identifiers as, so the ast takes over its table:
+		result->symbols = tokens.lexer ? tokens.lexer->symbols : tokens.buffer->symbols;
+	}
+	catch(std::exception e)
+	{
+		if(!tokens.lexer || !tokens.lexer->failed) //lexing errors have already been reported
+			_ps_print_error(tokens);
+		delete result;
+		return nullptr;
 	}
-}
 
-static inline void _ps_remove_newline(const std::vector<PStoken>& tokens, uint32_t& curTokenIdx)
-{
-	if(tokens[curTokenIdx].type == PStoken::NEWLINE)
-		curTokenIdx++;
+	return result;
 }
 
-static inline int _ps_precedence(PSnode::OP::Type op)
+static bool _ps_parse_parallel(PSast* ast, const PStokenBuffer& tokens, size_t numChunks)
 {
-	return (int)op / 10;
-}
+	//split the tokens before top-level function definitions, each checked once the chunk before it is parsed:
+	std::vector<PSparseChunk> chunks(1);
+	chunks[0].start = 0;
+	int64_t depth = 0;
+	for(uint32_t i = 0; i < tokens.size() && chunks.size() < numChunks; i++)
+	{
+		switch(tokens.types[i])
+		{
+		case PStoken::SEPERATOR_PAREN_OPEN:
+		case PStoken::SEPERATOR_SQUARE_OPEN:
+		case PStoken::SEPERATOR_CURLY_OPEN:
+			depth++;
+			break;
+		case PStoken::SEPERATOR_PAREN_CLOSE:
+		case PStoken::SEPERATOR_SQUARE_CLOSE:
+		case PStoken::SEPERATOR_CURLY_CLOSE:
+			depth--;
+			break;
+		case PStoken::KEYWORD_FUNC:
+			if(depth == 0 && i > 0 && tokens.types[i - 1] == PStoken::NEWLINE && i >= tokens.size() / numChunks * chunks.size())
+			{
+				chunks.back().end = i;
+				chunks.emplace_back();
+				chunks.back().start = i;
+			}
+			break;
+		default:
+			break;
+		}
+	}
 
-static inline void _ps_force_id(PStoken token)
-{
-	if(token.type != PStoken::ID)
-		_ps_error(PSparseError::UNEXPECTED_OPERATOR, token);
+	chunks.back().end = (uint32_t)tokens.size();
+	if(chunks.size() <= 1)
+		return false;
+
+	//parse each chunk on its own thread, the first into the ast's reserved memory:
+	std::swap(chunks[0].ast, *ast);
+
+	std::vector<std::thread> threads;
+	for(size_t i = 1; i < chunks.size(); i++)
+		threads.emplace_back(_ps_parse_chunk, std::ref(chunks[i]), std::cref(tokens));
+
+	_ps_parse_chunk(chunks[0], tokens);
+	for(std::thread& thread : threads)
+		thread.join();
+
+	std::swap(chunks[0].ast, *ast);
+	for(PSparseChunk& chunk : chunks)
+		if(chunk.failed)
+			return false;
+
+	//concatenate the chunks in parallel, giving the same ast as a single thread:
+	size_t numNodes = 0;
+	size_t numLists = 1;
+	size_t numParents = 0;
+	for(size_t i = 0; i < chunks.size(); i++)
+	{
+		PSparseChunk& chunk = chunks[i];
+		const PSast& chunkAst = i == 0 ? *ast : chunk.ast;
+
+		chunk.nodeBase = numNodes;
+		chunk.listBase = numLists - 1; //list 0 is shared
+		chunk.parentBase = numParents;
+		numNodes += chunkAst.nodePool.size();
+		numLists += chunkAst.lists.size() - 1;
+		numParents += chunkAst.parentNodes.size();
+	}
+
+	ast->nodePool.resize(numNodes);
+	ast->lists.resize(numLists);
+	ast->parentNodes.resize(numParents);
+
+	threads.clear();
+	for(size_t i = 2; i < chunks.size(); i++)
+		threads.emplace_back(_ps_merge_chunk, ast, std::cref(chunks[i]));
 
-	if(std::find(PS_KEYWORDS.begin(), PS_KEYWORDS.end(), token.str) != PS_KEYWORDS.end())
-		_ps_error(PSparseError::INVALID_TOKEN, token);
+	_ps_merge_chunk(ast, chunks[1]);
+	for(std::thread& thread : threads)
+		thread.join();
+
+	return true;
 }
 
-static void _ps_error(PSparseError error, PStoken errorToken)
+static void _ps_parse_chunk(PSparseChunk& chunk, const PStokenBuffer& buffer)
 {
-	g_psError = error;
-	g_psErrorToken = errorToken;
-	throw std::exception();
-}
\ No newline at end of file
+	PSparseTokens tokens = {&buffer, nullptr};
+	chunk.failed = false;
+
+	try
+	{
+		uint32_t curTokenIdx = chunk.start;
+		uint32_t numOpenParens = 0;
+		g_psListStack.clear();
+
+		if(chunk.start > 0)
+		{
+			chunk.ast.nodePool.reserve((chunk.end - chunk.start) * 3 / 4);
+			chunk.ast.lists.reserve((chunk.end - chunk.start) / 3);
+		}
+
+		while(curTokenIdx < chunk.end)
+		{
+			chunk.ast.parentNodes.push_back(_ps_parse_statement(&chunk.ast, tokens, curTokenIdx, numOpenParens, 1));
+			_ps_remove_newline(tokens, curTokenIdx);
+		}
+
+		chunk.failed = curTokenIdx != chunk.end && chunk.end < buffer.size();
+	}
+	catch(std::exception e)
+	{
+		chunk.failed = true;
+	}
+}
+
+static void _ps_merge_chunk(PSast* ast, const PSparseChunk& chunk)
+{
+	uint32_t nodeBase = (uint32_t)chunk.nodeBase;
+	uint32_t listBase = (uint32_t)chunk.listBase;
+
+	//offsets a list, and the handles in it unless it holds symbols:
+	auto merge_list = [ast, nodeBase, listBase](PSnodeList list, bool hasNodes) -> PSnodeList {
+		if(list == 0)
+			return 0;
+
+		list += listBase;
+		if(hasNodes)
+			for(uint32_t i = 1; i <= ast->lists[list]; i++)
+				ast->lists[list + i] += nodeBase;
+
+		return list;
+	};
+
+	std::copy(chunk.ast.lists.begin() + 1, chunk.ast.lists.end(), ast->lists.begin() + listBase + 1);
+
+	for(size_t i = 0; i < chunk.ast.nodePool.size(); i++)
+	{
+		PSnode node = chunk.ast.nodePool[i];
+		switch(node.type)
+		{
+		case PSnode::OP:
+		{
+			node.op.left += nodeBase;
+			if(node.op.type != PSnode::OP::NEG)
+				node.op.right += nodeBase;
+			break;
+		}
+		case PSnode::KEYWORD:
+		{
+			switch(node.keyword.type)
+			{
+			case PSnode::Keyword::IF:
+			case PSnode::Keyword::FOR:
+				node.keyword.condition += nodeBase;
+				node.keyword.code = merge_list(node.keyword.code, true);
+				node.keyword.elseCode = merge_list(node.keyword.elseCode, true);
+				break;
+			case PSnode::Keyword::FUNC:
+				node.keyword.paramNames = merge_list(node.keyword.paramNames, false);
+				node.keyword.code = merge_list(node.keyword.code, true);
+				break;
+			case PSnode::Keyword::RETURN:
+				if(node.keyword.returnVal != UINT32_MAX)
+					node.keyword.returnVal += nodeBase;
+				break;
+			default:
+				break;
+			}
+
+			break;
+		}
+		case PSnode::ID:
+		{
+			node.id.params = merge_list(node.id.params, true);
+			break;
+		}
+		case PSnode::NUMBER:
+			break;
+		}
+
+		ast->nodePool[nodeBase + i] = node;
+	}
+
+	for(size_t i = 0; i < chunk.ast.parentNodes.size(); i++)
+		ast->parentNodes[chunk.parentBase + i] = chunk.ast.parentNodes[i] + nodeBase;
+}
+
+static void _ps_print_error(PSparseTokens& tokens)
+{
+	std::string errMsg;
+	switch(g_psError)
+	{
+	case PSparseError::EXPECTED_CLOSING_PAREN:
+		errMsg = "EXPECTED CLOSING PARENTHESIS";
+		break;
+	case PSparseError::UNEXPECTED_OPERATOR:
+		errMsg = "UNEXPECTED OPERATOR \"" + std::string(_ps_token_str(tokens, g_psErrorToken)) + "\"";
+		break;
+	case PSparseError::EXPECTED_OPERATOR:
+		errMsg = "EXPECTED OPERATOR";
+		break;
+	case PSparseError::INVALID_TOKEN:
+		errMsg = "INVALID TOKEN \"" + std::string(_ps_token_str(tokens, g_psErrorToken)) + "\"";
+		break;
+	case PSparseError::EXPECTED_OPENING_CURLY:
+		errMsg = "EXPECTED OPENING CURLY BRACE";
+		break;
+	case PSparseError::MAX_DEPTH_EXCEEDED:
+		errMsg = "MAXIMUM NESTING DEPTH EXCEEDED";
+		break;
+	}
+
+	std::cout << "PROPSCRIPT PARSE ERROR: " << errMsg << " ON LINE " << g_psErrorToken.lineNum << std::endl;
+}
+
+static PSnodeHandle _ps_parse_statement(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens, uint32_t depth)
+{
+	PSparseFrame statement = {};
+	statement.type = PSparseFrame::STATEMENT;
+	statement.depth = depth;
+
+	return _ps_parse_frames(ast, tokens, curTokenIdx, numOpenParens, statement);
+}
+
+static PSnodeHandle _ps_parse_func(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens, PSincrementalBlock* body)
+{
+	PSparseFrame func = {};
+	func.type = PSparseFrame::FUNC;
+	func.depth = 1;
+	func.body = body;
+
+	return _ps_parse_frames(ast, tokens, curTokenIdx, numOpenParens, func);
+}
+
+static PSnodeHandle _ps_parse_frames(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens, const PSparseFrame& first)
+{
+	g_psParseStack.clear(); //a failed parse can leave frames behind
+	g_psParseStack.push_back(first);
+
+	//every frame leaves the node it parsed on the list stack, where the frame below it picks it up:
+	while(!g_psParseStack.empty())
+	{
+		switch(g_psParseStack.back().type)
+		{
+		case PSparseFrame::STATEMENT:
+			_ps_step_statement(ast, tokens, curTokenIdx, numOpenParens);
+			break;
+		case PSparseFrame::CONTROL:
+			_ps_step_control(ast, tokens, curTokenIdx);
+			break;
+		case PSparseFrame::FUNC:
+			_ps_step_func(ast, tokens, curTokenIdx, numOpenParens);
+			break;
+		case PSparseFrame::RETURN:
+		{
+			PSparseFrame& frame = g_psParseStack.back();
+			frame.node.keyword.returnVal = g_psListStack.back();
+			g_psListStack.pop_back();
+			_ps_finish_frame(ast, frame.node);
+			break;
+		}
+		case PSparseFrame::BLOCK:
+			_ps_step_block(tokens, curTokenIdx);
+			break;
+		case PSparseFrame::EXPRESSION:
+			_ps_step_expression(ast, tokens, curTokenIdx, numOpenParens);
+			break;
+		case PSparseFrame::OPERAND:
+			_ps_step_operand(ast, tokens, curTokenIdx, numOpenParens);
+			break;
+		}
+	}
+
+	PSnodeHandle result = g_psListStack.back();
+	g_psListStack.pop_back();
+	return result;
+}
+
+static void _ps_step_statement(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+{
+	PSparseFrame& frame = g_psParseStack.back();
+
+	//DISPATCH ON KEYWORDS:
+	switch(_ps_token_type(tokens, curTokenIdx))
+	{
+	//CONTROL FLOW STATEMENT:
+	case PStoken::KEYWORD_IF:
+	case PStoken::KEYWORD_FOR:
+	{
+		bool isFor = _ps_token_type(tokens, curTokenIdx) == PStoken::KEYWORD_FOR;
+
+		if(numOpenParens > 0)
+			_ps_error(PSparseError::INVALID_TOKEN, _ps_token(tokens, curTokenIdx));
+
+		frame.type = PSparseFrame::CONTROL;
+		frame.step = PS_PARSE_STEP_CONDITION;
+		frame.node.type = PSnode::KEYWORD;
+		frame.node.lineNum = _ps_token(tokens, curTokenIdx).lineNum;
+		frame.node.keyword.type = isFor ? PSnode::Keyword::FOR : PSnode::Keyword::IF;
+		frame.node.keyword.hasElse = false;
+		frame.node.keyword.elseCode = 0;
+
+		//GET CONDITION:
+		curTokenIdx++;
+		_ps_push_statement(tokens, curTokenIdx, frame.depth + 1);
+		break;
+	}
+
+	//FUNCTION DEFINITION:
+	case PStoken::KEYWORD_FUNC:
+	{
+		frame.type = PSparseFrame::FUNC;
+		frame.body = nullptr;
+		break;
+	}
+
+	//RETURN STATEMENT:
+	case PStoken::KEYWORD_RETURN:
+	{
+		frame.node.type = PSnode::KEYWORD;
+		frame.node.lineNum = _ps_token(tokens, curTokenIdx).lineNum;
+		frame.node.keyword.type = PSnode::Keyword::RETURN;
+		frame.node.keyword.hasElse = false;
+
+		curTokenIdx++;
+		if(_ps_token_type(tokens, curTokenIdx) != PStoken::NEWLINE &&
+		   !_ps_is_closed_seperator(_ps_token_type(tokens, curTokenIdx))) //get return value if not a void return
+		{
+			frame.type = PSparseFrame::RETURN;
+			_ps_push_statement(tokens, curTokenIdx, frame.depth + 1);
+		}
+		else
+		{
+			frame.node.keyword.returnVal = UINT32_MAX;
+			_ps_finish_frame(ast, frame.node);
+		}
+
+		break;
+	}
+
+	//BREAK/CONTINUE STATEMENT:
+	case PStoken::KEYWORD_BREAK:
+	case PStoken::KEYWORD_CONTINUE:
+	{
+		frame.node.type = PSnode::KEYWORD;
+		frame.node.lineNum = _ps_token(tokens, curTokenIdx).lineNum;
+		frame.node.keyword.type = _ps_token_type(tokens, curTokenIdx) == PStoken::KEYWORD_BREAK ? PSnode::Keyword::BREAK : PSnode::Keyword::CONTINUE;
+		frame.node.keyword.hasElse = false;
+
+		curTokenIdx++;
+		if(_ps_token_type(tokens, curTokenIdx) != PStoken::NEWLINE &&
+		   !_ps_is_closed_seperator(_ps_token_type(tokens, curTokenIdx))) //get return value if not a void return
+			_ps_error(PSparseError::INVALID_TOKEN, _ps_token(tokens, curTokenIdx));
+
+		_ps_finish_frame(ast, frame.node);
+		break;
+	}
+
+	//MUST BE REGULAR OPERATION:
+	default:
+	{
+		frame.type = PSparseFrame::EXPRESSION;
+		frame.maxPrecedence = INT_MAX;
+		_ps_step_expression(ast, tokens, curTokenIdx, numOpenParens);
+		break;
+	}
+	}
+}
+
+static void _ps_step_control(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx)
+{
+	PSparseFrame& frame = g_psParseStack.back();
+
+	switch(frame.step)
+	{
+	case PS_PARSE_STEP_CONDITION:
+	{
+		frame.node.keyword.condition = g_psListStack.back();
+		g_psListStack.pop_back();
+		_ps_remove_newline(tokens, curTokenIdx);
+
+		//GET CODE:
+		frame.step = PS_PARSE_STEP_CODE;
+		frame.listStart = g_psListStack.size();
+		_ps_push_code(tokens, curTokenIdx, frame.depth);
+		break;
+	}
+	case PS_PARSE_STEP_CODE:
+	{
+		frame.node.keyword.code = _ps_pop_list(ast, frame.listStart);
+
+		//IF FOR LOOP, NO ELSE STATEMENT POSSIBLE SO JUST RETURN
+		if(frame.node.keyword.type == PSnode::Keyword::FOR)
+		{
+			_ps_finish_frame(ast, frame.node);
+			break;
+		}
+
+		//CHECK FOR ELSE:
+		_ps_remove_newline(tokens, curTokenIdx);
+
+		if(_ps_token_type(tokens, curTokenIdx) == PStoken::KEYWORD_ELSE)
+		{
+			frame.node.keyword.hasElse = true;
+			frame.step = PS_PARSE_STEP_ELSE_CODE;
+			frame.listStart = g_psListStack.size();
+
+			curTokenIdx++;
+			_ps_remove_newline(tokens, curTokenIdx);
+			_ps_push_code(tokens, curTokenIdx, frame.depth); //single-line code may be an else-if
+		}
+		else
+			_ps_finish_frame(ast, frame.node);
+
+		break;
+	}
+	case PS_PARSE_STEP_ELSE_CODE:
+	{
+		frame.node.keyword.elseCode = _ps_pop_list(ast, frame.listStart);
+		_ps_finish_frame(ast, frame.node);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static void _ps_step_func(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+{
+	PSparseFrame& frame = g_psParseStack.back();
+
+	//THE BODY IS ON THE LIST STACK:
+	if(frame.step == PS_PARSE_STEP_CODE)
+	{
+		frame.node.keyword.code = _ps_pop_list(ast, frame.listStart);
+		_ps_finish_frame(ast, frame.node);
+		return;
+	}
+
+	frame.node.type = PSnode::KEYWORD;
+	frame.node.lineNum = _ps_token(tokens, curTokenIdx).lineNum;
+	frame.node.keyword.type = PSnode::Keyword::FUNC;
+	frame.node.keyword.hasElse = false;
+
+	curTokenIdx++;
+	_ps_remove_newline(tokens, curTokenIdx);
+
+	_ps_force_id(tokens, curTokenIdx);
+
+	frame.node.keyword.name = _ps_token(tokens, curTokenIdx).value.symbol;
+	curTokenIdx++;
+	_ps_remove_newline(tokens, curTokenIdx);
+
+	size_t paramNamesStart = g_psListStack.size();
+	if(_ps_token_type(tokens, curTokenIdx) == PStoken::SEPERATOR_PAREN_OPEN) //has parameters
+	{
+		curTokenIdx++;
+		numOpenParens++;
+		_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+
+		//argument names:
+		while(true)
+		{
+			_ps_force_id(tokens, curTokenIdx);
+			g_psListStack.push_back(_ps_token(tokens, curTokenIdx).value.symbol);
+			curTokenIdx++;
+
+			if(_ps_token_type(tokens, curTokenIdx) == PStoken::SEPERATOR_PAREN_CLOSE)
+				break;
+			else if(_ps_token_type(tokens, curTokenIdx) != PStoken::SEPERATOR_COMMA)
+				_ps_error(PSparseError::EXPECTED_OPERATOR, _ps_token(tokens, curTokenIdx));
+
+			curTokenIdx++;
+			_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+		}
+
+		curTokenIdx++;
+		numOpenParens--;
+	}
+
+	frame.node.keyword.paramNames = _ps_pop_list(ast, paramNamesStart);
+	_ps_remove_newline(tokens, curTokenIdx);
+
+	//GET CODE:
+	if(_ps_token_type(tokens, curTokenIdx) != PStoken::SEPERATOR_CURLY_OPEN) //ensure open curly brace found
+		_ps_error(PSparseError::EXPECTED_OPENING_CURLY, _ps_token(tokens, curTokenIdx));
+
+	curTokenIdx++;
+	if(frame.body)
+		frame.body->begin = curTokenIdx;
+	_ps_remove_newline(tokens, curTokenIdx);
+
+	frame.step = PS_PARSE_STEP_CODE;
+	frame.listStart = g_psListStack.size();
+
+	PSparseFrame& block = _ps_push_frame(PSparseFrame::BLOCK, frame.depth);
+	block.body = g_psParseStack[g_psParseStack.size() - 2].body;
+}
+
+static void _ps_step_block(PSparseTokens& tokens, uint32_t& curTokenIdx)
+{
+	PSparseFrame& frame = g_psParseStack.back();
+
+	if(frame.step == PS_PARSE_STEP_STATEMENT)
+		_ps_remove_newline(tokens, curTokenIdx);
+
+	//THE STATEMENTS ARE LEFT ON THE LIST STACK FOR THE FRAME BELOW:
+	if(_ps_token_type(tokens, curTokenIdx) != PStoken::SEPERATOR_CURLY_CLOSE)
+	{
+		if(frame.body)
+			frame.body->statements.push_back(curTokenIdx);
+
+		frame.step = PS_PARSE_STEP_STATEMENT;
+		_ps_push_statement(tokens, curTokenIdx, frame.depth + 1);
+	}
+	else
+	{
+		if(frame.body)
+			frame.body->end = curTokenIdx;
+
+		curTokenIdx++;
+		g_psParseStack.pop_back();
+	}
+}
+
+static void _ps_step_expression(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+{
+	PSparseFrame& frame = g_psParseStack.back();
+
+	switch(frame.step)
+	{
+	case PS_PARSE_STEP_START:
+	{
+		frame.step = PS_PARSE_STEP_OPERATOR;
+		if(!_ps_parse_simple_operand(ast, tokens, curTokenIdx, numOpenParens))
+			_ps_push_frame(PSparseFrame::OPERAND, frame.depth);
+		break;
+	}
+	case PS_PARSE_STEP_RIGHT:
+	{
+		frame.node.op.right = g_psListStack.back();
+		g_psListStack.pop_back();
+		frame.node.op.left = g_psListStack.back();
+		g_psListStack.back() = _ps_add_node(ast, frame.node);
+
+		frame.step = PS_PARSE_STEP_OPERATOR;
+		break;
+	}
+	case PS_PARSE_STEP_OPERATOR:
+	{
+		while(true)
+		{
+			//THE LEFT SIDE IS THE RESULT ONCE THE EXPRESSION ENDS:
+			if(_ps_ends_expression(_ps_token_type(tokens, curTokenIdx)))
+			{
+				g_psParseStack.pop_back();
+				break;
+			}
+
+			//CHECK IF THE OPERATOR BELONGS TO A CALLER:
+			//lower values bind tighter
+			PSnode::OP::Type opType;
+			if(_ps_token_op_type(_ps_token_type(tokens, curTokenIdx), &opType) && _ps_precedence(opType) > frame.maxPrecedence)
+			{
+				g_psParseStack.pop_back();
+				break;
+			}
+
+			frame.node = _ps_get_op_node(ast, tokens, curTokenIdx, numOpenParens);
+			frame.step = PS_PARSE_STEP_RIGHT;
+
+			//operators are left associative, so the right side only takes operators that bind strictly tighter:
+			int rightPrecedence = _ps_precedence(frame.node.op.type) - 1;
+			uint32_t depth = frame.depth;
+
+			if(!_ps_parse_simple_operand(ast, tokens, curTokenIdx, numOpenParens))
+			{
+				PSparseFrame& right = _ps_push_frame(PSparseFrame::EXPRESSION, depth);
+				right.maxPrecedence = rightPrecedence;
+				break;
+			}
+
+			//most right sides are a single operand, combined right away instead of in a frame:
+			PSnode::OP::Type nextType;
+			PStoken::Type nextToken = _ps_token_type(tokens, curTokenIdx);
+			if(!_ps_ends_expression(nextToken) && !(_ps_token_op_type(nextToken, &nextType) && _ps_precedence(nextType) > rightPrecedence))
+			{
+				PSparseFrame& right = _ps_push_frame(PSparseFrame::EXPRESSION, depth);
+				right.step = PS_PARSE_STEP_OPERATOR;
+				right.maxPrecedence = rightPrecedence;
+				break;
+			}
+
+			frame.node.op.right = g_psListStack.back();
+			g_psListStack.pop_back();
+			frame.node.op.left = g_psListStack.back();
+			g_psListStack.back() = _ps_add_node(ast, frame.node);
+			frame.step = PS_PARSE_STEP_OPERATOR;
+		}
+
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static void _ps_step_operand(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+{
+	PSparseFrame& frame = g_psParseStack.back();
+
+	switch(frame.step)
+	{
+	case PS_PARSE_STEP_START:
+		break;
+	case PS_PARSE_STEP_PARENS:
+	{
+		if(_ps_token_type(tokens, curTokenIdx) != PStoken::SEPERATOR_PAREN_CLOSE)
+			_ps_error(PSparseError::EXPECTED_CLOSING_PAREN, _ps_token(tokens, curTokenIdx));
+
+		numOpenParens--;
+		curTokenIdx++;
+		_ps_finish_operand(tokens, curTokenIdx, numOpenParens);
+		return;
+	}
+	case PS_PARSE_STEP_ARGUMENT:
+	{
+		if(_ps_token_type(tokens, curTokenIdx) == PStoken::SEPERATOR_PAREN_CLOSE)
+		{
+			curTokenIdx++;
+			numOpenParens--;
+			frame.node.id.params = _ps_pop_list(ast, frame.listStart);
+			_ps_add_operand(ast, tokens, curTokenIdx, numOpenParens);
+		}
+		else if(_ps_token_type(tokens, curTokenIdx) != PStoken::SEPERATOR_COMMA)
+			_ps_error(PSparseError::EXPECTED_OPERATOR, _ps_token(tokens, curTokenIdx));
+		else
+		{
+			curTokenIdx++;
+			_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+			_ps_push_statement(tokens, curTokenIdx, frame.depth + 1);
+		}
+
+		return;
+	}
+	case PS_PARSE_STEP_INDEX:
+	{
+		frame.node.id.params = _ps_pop_list(ast, frame.listStart);
+
+		_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+		if(_ps_token_type(tokens, curTokenIdx) != PStoken::SEPERATOR_SQUARE_CLOSE)
+			_ps_error(PSparseError::EXPECTED_CLOSING_PAREN, _ps_token(tokens, curTokenIdx));
+
+		numOpenParens--;
+		curTokenIdx++;
+		_ps_add_operand(ast, tokens, curTokenIdx, numOpenParens);
+		return;
+	}
+	default:
+		break;
+	}
+
+	//STATEMENT IN PARENTHESIS:
+	if(_ps_token_type(tokens, curTokenIdx) == PStoken::SEPERATOR_PAREN_OPEN)
+	{
+		curTokenIdx++;
+		numOpenParens++;
+		frame.step = PS_PARSE_STEP_PARENS;
+		_ps_push_statement(tokens, curTokenIdx, frame.depth + 1);
+		return;
+	}
+
+	//numbers and variables without an index are parsed without a frame, anything else must be a function or an indexed variable:
+	frame.negative = false;
+	if(_ps_token_type(tokens, curTokenIdx) == PStoken::OP_SUB)
+	{
+		frame.negative = true;
+		curTokenIdx++;
+	}
+
+	_ps_force_id(tokens, curTokenIdx);
+
+	//FUNCTION:
+	if(_ps_token_type(tokens, curTokenIdx + 1) == PStoken::SEPERATOR_PAREN_OPEN)
+	{
+		frame.node.type = PSnode::ID;
+		frame.node.lineNum = _ps_token(tokens, curTokenIdx).lineNum;
+		frame.node.id.type = PSnode::ID::FUNC;
+		frame.node.id.name = _ps_token(tokens, curTokenIdx).value.symbol;
+		frame.node.id.params = 0;
+
+		curTokenIdx += 2;
+		numOpenParens++;
+		_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+
+		//0 argument function:
+		if(_ps_token_type(tokens, curTokenIdx) == PStoken::SEPERATOR_PAREN_CLOSE)
+		{
+			curTokenIdx++;
+			numOpenParens--;
+			g_psListStack.push_back(_ps_add_node(ast, frame.node));
+			_ps_finish_operand(tokens, curTokenIdx, numOpenParens);
+			return;
+		}
+
+		//arguments:
+		frame.step = PS_PARSE_STEP_ARGUMENT;
+		frame.listStart = g_psListStack.size();
+		_ps_push_statement(tokens, curTokenIdx, frame.depth + 1);
+		return;
+	}
+	
+	PStoken token = _ps_token(tokens, curTokenIdx++);
+	
+	//VARIABLE:
+	frame.node.type = PSnode::ID;
+	frame.node.lineNum = _ps_token(tokens, curTokenIdx).lineNum;
+	frame.node.id.type = PSnode::ID::VAR;
+	frame.node.id.name = token.value.symbol;
+	frame.node.id.params = 0;
+
+	//index into variable:
+	if(_ps_token_type(tokens, curTokenIdx) == PStoken::SEPERATOR_SQUARE_OPEN)
+	{
+		numOpenParens++;
+		_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+
+		frame.step = PS_PARSE_STEP_INDEX;
+		frame.listStart = g_psListStack.size();
+		_ps_push_statement(tokens, ++curTokenIdx, frame.depth + 1);
+		return;
+	}
+
+	_ps_add_operand(ast, tokens, curTokenIdx, numOpenParens);
+}
+
+static PSnode _ps_get_op_node(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+{
+	//ENSURE ACTUALLY AN OP:
+	if(!_ps_is_op_token(_ps_token_type(tokens, curTokenIdx)))
+		_ps_error(PSparseError::EXPECTED_OPERATOR, _ps_token(tokens, curTokenIdx));
+
+	PSnode opNode;
+	opNode.type = PSnode::OP;
+	opNode.lineNum = _ps_token(tokens, curTokenIdx).lineNum;
+	if(!_ps_token_op_type(_ps_token_type(tokens, curTokenIdx), &opNode.op.type))
+		_ps_error(PSparseError::INVALID_TOKEN, _ps_token(tokens, curTokenIdx));
+
+	curTokenIdx++;
+	_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+	return opNode;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static bool _ps_incremental_compile(PSincrementalScript* script)
+{
+	ps_free_ast(script->ast);
+	script->ast = nullptr;
+	script->parentBlock = PSincrementalBlock();
+	script->funcBlocks.clear();
+	script->numGarbage = 0;
+
+	script->tokens = ps_lex_buffer(script->source.data(), script->source.size());
+	if(!script->tokens.source) //lexing errors have already been reported
+		return false;
+
+	PSast* ast = new PSast;
+	ast->nodePool.reserve(script->tokens.size() * 3 / 4);
+	ast->lists.reserve(script->tokens.size() / 3);
+	ast->symbols = script->tokens.symbols;
+	script->ast = ast;
+
+	//COMPILE FROM SCRATCH:
+	//an edit that replaces an empty source
+	PStokenEdit edit = {0, 0, (uint32_t)script->tokens.size(), 0, 0};
+	PSparseTokens tokens = {&script->tokens, nullptr};
+	try
+	{
+		g_psListStack.clear();
+		_ps_reparse_block(script, tokens, edit, script->parentBlock, ast->parentNodes, &script->funcBlocks);
+	}
+	catch(std::exception e)
+	{
+		_ps_print_error(tokens);
+		ps_free_ast(script->ast);
+		script->ast = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+static bool _ps_reparse_func_body(PSincrementalScript* script, PSparseTokens& tokens, const PStokenEdit& edit)
+{
+	PSast* ast = script->ast;
+	PSincrementalBlock& parentBlock = script->parentBlock;
+
+	//FIND THE EDITED FUNCTION:
+	//the edit must not touch the curly braces of its body
+	size_t parentIdx = std::upper_bound(parentBlock.statements.begin(), parentBlock.statements.end(), edit.first) - parentBlock.statements.begin();
+	if(parentIdx == 0)
+		return false;
+	parentIdx--;
+
+	PSincrementalBlock& funcBlock = script->funcBlocks[parentIdx];
+	uint32_t base = parentBlock.statements[parentIdx];
+	if(funcBlock.end == 0 || edit.first < base + funcBlock.begin || edit.oldEnd > base + funcBlock.end)
+		return false;
+
+	//PARSE THE BODY'S STATEMENTS:
+	//function blocks are relative to the function, no shifting needed
+	PSincrementalBlock body = funcBlock;
+	body.begin += base;
+	body.end += base;
+	for(uint32_t& statement : body.statements)
+		statement += base;
+
+	PSnodeList code = ast->nodePool[ast->parentNodes[parentIdx]].keyword.code;
+	std::vector<PSnodeHandle> handles(ast->list_data(code), ast->list_data(code) + ast->list_size(code));
+
+	size_t numNodes = ast->nodePool.size();
+	size_t numListElements = ast->lists.size();
+	bool reparsed;
+	try
+	{
+		reparsed = _ps_reparse_block(script, tokens, edit, body, handles, nullptr);
+	}
+	catch(std::exception e) //the edit may have changed where the body ends, the error is reported if parsing the parent nodes also fails
+	{
+		reparsed = false;
+	}
+
+	if(!reparsed)
+	{
+		script->numGarbage += (ast->nodePool.size() - numNodes) + (ast->lists.size() - numListElements);
+		g_psListStack.clear();
+		return false;
+	}
+
+	//REPLACE THE BODY'S CODE:
+	//the parent nodes after it are shifted
+	if(code != 0)
+		script->numGarbage += ast->list_size(code) + 1;
+
+	size_t codeStart = g_psListStack.size();
+	g_psListStack.insert(g_psListStack.end(), handles.begin(), handles.end());
+	ast->nodePool[ast->parentNodes[parentIdx]].keyword.code = _ps_pop_list(ast, codeStart);
+
+	for(uint32_t& statement : body.statements)
+		statement -= base;
+	funcBlock.begin = body.begin - base;
+	funcBlock.end = body.end - base;
+	funcBlock.statements = std::move(body.statements);
+
+	int64_t delta = (int64_t)edit.newEnd - edit.oldEnd;
+	if(delta != 0)
+	{
+		for(size_t i = parentIdx + 1; i < parentBlock.statements.size(); i++)
+			parentBlock.statements[i] = (uint32_t)(parentBlock.statements[i] + delta);
+		parentBlock.end = (uint32_t)(parentBlock.end + delta);
+	}
+
+	return true;
+}
+
+static bool _ps_reparse_block(PSincrementalScript* script, PSparseTokens& tokens, const PStokenEdit& edit, PSincrementalBlock& block,
+                              std::vector<PSnodeHandle>& handles, std::vector<PSincrementalBlock>* funcBlocks)
+{
+	PSast* ast = script->ast;
+	std::vector<uint32_t>& statements = block.statements;
+	int64_t delta = (int64_t)edit.newEnd - edit.oldEnd;
+	uint32_t blockEnd = (uint32_t)(block.end + delta);
+
+	//FIND THE FIRST STATEMENT THE EDIT TOUCHES:
+	//an else may belong to the if before it
+	size_t first = std::upper_bound(statements.begin(), statements.end(), edit.first) - statements.begin();
+	if(first > 0)
+		first--;
+
+	if(first > 0)
+	{
+		uint32_t startIdx = statements[first];
+		_ps_remove_newline(tokens, startIdx);
+		if(_ps_token_type(tokens, startIdx) == PStoken::KEYWORD_ELSE)
+			first--;
+	}
+
+	uint32_t curTokenIdx = first > 0 ? statements[first] : block.begin;
+	uint32_t numOpenParens = 0;
+	_ps_remove_newline(tokens, curTokenIdx);
+
+	//PARSE THE EDITED STATEMENTS:
+	//until they're past the edit and start where an old statement did, the rest is unchanged
+	std::vector<PSnodeHandle> newHandles;
+	std::vector<uint32_t> newStatements;
+	std::vector<PSincrementalBlock> newFuncBlocks;
+	size_t last = first;
+	while(true)
+	{
+		if(funcBlocks && _ps_at_end(tokens, curTokenIdx))
+		{
+			last = statements.size();
+			break;
+		}
+
+		if(curTokenIdx >= edit.newEnd)
+		{
+			uint32_t oldIdx = (uint32_t)(curTokenIdx - delta);
+			while(last < statements.size() && statements[last] < oldIdx)
+				last++;
+
+			if(oldIdx == block.end || (last < statements.size() && statements[last] == oldIdx))
+				break;
+		}
+
+		//a function body that ends anywhere else has changed shape:
+		if(!funcBlocks && (curTokenIdx >= blockEnd || _ps_token_type(tokens, curTokenIdx) == PStoken::SEPERATOR_CURLY_CLOSE))
+			return false;
+
+		newStatements.push_back(curTokenIdx);
+		if(funcBlocks && _ps_token_type(tokens, curTokenIdx) == PStoken::KEYWORD_FUNC)
+		{
+			PSincrementalBlock body;
+			uint32_t base = curTokenIdx;
+			newHandles.push_back(_ps_parse_func(ast, tokens, curTokenIdx, numOpenParens, &body));
+
+			body.begin -= base;
+			body.end -= base;
+			for(uint32_t& statement : body.statements)
+				statement -= base;
+			newFuncBlocks.push_back(std::move(body));
+		}
+		else
+		{
+			newHandles.push_back(_ps_parse_statement(ast, tokens, curTokenIdx, numOpenParens, funcBlocks ? 1 : 2));
+			if(funcBlocks)
+				newFuncBlocks.emplace_back();
+		}
+
+		_ps_remove_newline(tokens, curTokenIdx);
+	}
+
+	//REPLACE THE OLD STATEMENTS:
+	//the statements after them only need their token indices shifted
+	for(size_t i = first; i < last; i++)
+		script->numGarbage += _ps_node_size(ast, handles[i]);
+
+	handles.erase(handles.begin() + first, handles.begin() + last);
+	handles.insert(handles.begin() + first, newHandles.begin(), newHandles.end());
+
+	statements.erase(statements.begin() + first, statements.begin() + last);
+	statements.insert(statements.begin() + first, newStatements.begin(), newStatements.end());
+	if(delta != 0)
+		for(size_t i = first + newStatements.size(); i < statements.size(); i++)
+			statements[i] = (uint32_t)(statements[i] + delta);
+
+	if(funcBlocks)
+	{
+		funcBlocks->erase(funcBlocks->begin() + first, funcBlocks->begin() + last);
+		funcBlocks->insert(funcBlocks->begin() + first, std::make_move_iterator(newFuncBlocks.begin()), std::make_move_iterator(newFuncBlocks.end()));
+	}
+
+	block.end = blockEnd;
+	return true;
+}
+
+static size_t _ps_node_size(PSast* ast, PSnodeHandle handle)
+{
+	//walk the nodes with a work stack, operator chains can nest deeper than the native stack allows:
+	std::vector<PSnodeHandle> stack = {handle};
+	size_t size = 0;
+
+	while(!stack.empty())
+	{
+		PSnodeHandle cur = stack.back();
+		stack.pop_back();
+		if(cur == UINT32_MAX)
+			continue;
+
+		size++;
+		const PSnode& node = ast->nodePool[cur];
+		switch(node.type)
+		{
+		case PSnode::OP:
+			stack.push_back(node.op.left);
+			stack.push_back(node.op.right);
+			break;
+		case PSnode::KEYWORD:
+		{
+			switch(node.keyword.type)
+			{
+			case PSnode::Keyword::IF:
+			case PSnode::Keyword::FOR:
+				stack.push_back(node.keyword.condition);
+				size += _ps_list_size(ast, node.keyword.code, stack);
+				if(node.keyword.hasElse)
+					size += _ps_list_size(ast, node.keyword.elseCode, stack);
+				break;
+			case PSnode::Keyword::FUNC:
+				size += node.keyword.paramNames != 0 ? ast->list_size(node.keyword.paramNames) + 1 : 0;
+				size += _ps_list_size(ast, node.keyword.code, stack);
+				break;
+			case PSnode::Keyword::RETURN:
+				stack.push_back(node.keyword.returnVal);
+				break;
+			default:
+				break;
+			}
+			break;
+		}
+		case PSnode::ID:
+			size += _ps_list_size(ast, node.id.params, stack);
+			break;
+		default:
+			break;
+		}
+	}
+
+	return size;
+}
+
+static size_t _ps_list_size(PSast* ast, PSnodeList list, std::vector<PSnodeHandle>& stack)
+{
+	if(list == 0)
+		return 0;
+
+	stack.insert(stack.end(), ast->list_data(list), ast->list_data(list) + ast->list_size(list));
+	return ast->list_size(list) + 1;
+}
+
+static inline void _ps_push_compact_list(const uint32_t* handles, uint32_t numHandles, std::vector<PSnodeHandle>& stack)
+{
+	for(uint32_t i = numHandles; i > 0; i--)
+		stack.push_back(handles[i - 1]);
+}
+
+static inline PSnodeList _ps_compact_list(PSast* ast, PSnodeList list, const std::vector<PSnodeHandle>& newHandles, std::vector<uint32_t>& lists, bool handles)
+{
+	if(list == 0)
+		return 0;
+
+	PSnodeList newList = (PSnodeList)lists.size();
+	lists.push_back(ast->list_size(list));
+	for(uint32_t i = 0; i < ast->list_size(list); i++)
+		lists.push_back(handles ? newHandles[ast->list_data(list)[i]] : ast->list_data(list)[i]);
+
+	return newList;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static inline PSparseFrame& _ps_push_frame(PSparseFrame::Type type, uint32_t depth)
+{
+	PSparseFrame frame;
+	frame.type = type;
+	frame.step = PS_PARSE_STEP_START;
+	frame.depth = depth;
+	frame.body = nullptr;
+
+	g_psParseStack.push_back(frame);
+	return g_psParseStack.back();
+}
+
+static inline void _ps_push_statement(PSparseTokens& tokens, uint32_t curTokenIdx, uint32_t depth)
+{
+	if(depth > g_psMaxParseDepth)
+		_ps_error(PSparseError::MAX_DEPTH_EXCEEDED, _ps_token(tokens, curTokenIdx));
+
+	_ps_push_frame(PSparseFrame::STATEMENT, depth);
+}
+
+static inline void _ps_push_code(PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t depth)
+{
+	if(_ps_token_type(tokens, curTokenIdx) == PStoken::SEPERATOR_CURLY_OPEN) //multi-line
+	{
+		curTokenIdx++;
+		_ps_remove_newline(tokens, curTokenIdx);
+		_ps_push_frame(PSparseFrame::BLOCK, depth);
+	}
+	else //single-line
+		_ps_push_statement(tokens, curTokenIdx, depth + 1);
+}
+
+static inline bool _ps_parse_simple_operand(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+{
+	uint32_t idx = curTokenIdx;
+	bool negative = _ps_token_type(tokens, idx) == PStoken::OP_SUB;
+	if(negative)
+		idx++;
+
+	//NUMBER:
+	PStoken::Type tokenType = _ps_token_type(tokens, idx);
+	if(tokenType == PStoken::NUMBER_INT || tokenType == PStoken::NUMBER_FLOAT)
+	{
+		PStoken token = _ps_token(tokens, idx);
+		curTokenIdx = idx + 1;
+
+		PSnode numNode{};
+		numNode.type = PSnode::NUMBER;
+		numNode.lineNum = token.lineNum;
+
+		if(token.type == PStoken::NUMBER_FLOAT)
+		{
+			numNode.literal.type = PSnode::Literal::FLOAT;
+			numNode.literal.floatNum = negative ? -token.value.floatNum : token.value.floatNum;
+		}
+		else
+		{
+			numNode.literal.type = PSnode::Literal::INT;
+			numNode.literal.intNum = negative ? -token.value.intNum : token.value.intNum;
+		}
+
+		g_psListStack.push_back(_ps_add_node(ast, numNode));
+		_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+		return true;
+	}
+
+	//VARIABLE WITHOUT AN INDEX:
+	PStoken::Type nextType = _ps_token_type(tokens, idx + 1);
+	if(tokenType != PStoken::ID || nextType == PStoken::SEPERATOR_PAREN_OPEN || nextType == PStoken::SEPERATOR_SQUARE_OPEN)
+		return false;
+
+	PStoken token = _ps_token(tokens, idx);
+	curTokenIdx = idx + 1;
+
+	PSnode varNode;
+	varNode.type = PSnode::ID;
+	varNode.lineNum = _ps_token(tokens, curTokenIdx).lineNum;
+	varNode.id.type = PSnode::ID::VAR;
+	varNode.id.name = token.value.symbol;
+	varNode.id.params = 0;
+
+	if(negative)
+	{
+		PSnode negNode;
+		negNode.type = PSnode::OP;
+		negNode.lineNum = varNode.lineNum;
+		negNode.op.type = PSnode::OP::NEG;
+		negNode.op.left = _ps_add_node(ast, varNode);
+		negNode.op.right = UINT32_MAX;
+		g_psListStack.push_back(_ps_add_node(ast, negNode));
+	}
+	else
+		g_psListStack.push_back(_ps_add_node(ast, varNode));
+
+	_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+	return true;
+}
+
+static inline void _ps_finish_frame(PSast* ast, const PSnode& node)
+{
+	g_psListStack.push_back(_ps_add_node(ast, node));
+	g_psParseStack.pop_back();
+}
+
+static inline void _ps_add_operand(PSast* ast, PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+{
+	PSparseFrame& frame = g_psParseStack.back();
+	if(frame.negative)
+	{
+		PSnode negNode;
+		negNode.type = PSnode::OP;
+		negNode.lineNum = _ps_token(tokens, curTokenIdx).lineNum;
+		negNode.op.type = PSnode::OP::NEG;
+		negNode.op.left = _ps_add_node(ast, frame.node);
+		negNode.op.right = UINT32_MAX;
+		g_psListStack.push_back(_ps_add_node(ast, negNode));
+	}
+	else
+		g_psListStack.push_back(_ps_add_node(ast, frame.node));
+
+	_ps_finish_operand(tokens, curTokenIdx, numOpenParens);
+}
+
+static inline void _ps_finish_operand(PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+{
+	_ps_continue_statement(tokens, curTokenIdx, numOpenParens);
+	g_psParseStack.pop_back();
+}
+
+static inline PSnodeHandle _ps_add_node(PSast* ast, const PSnode& node)
+{
+	ast->nodePool.emplace_back(node);
+	return (PSnodeHandle)(ast->nodePool.size() - 1);
+}
+
+static inline PSnodeList _ps_pop_list(PSast* ast, size_t start)
+{
+	size_t size = g_psListStack.size() - start;
+	if(size == 0)
+		return 0;
+
+	PSnodeList list = (PSnodeList)ast->lists.size();
+	ast->lists.push_back((uint32_t)size);
+	ast->lists.insert(ast->lists.end(), g_psListStack.begin() + start, g_psListStack.end());
+	g_psListStack.resize(start);
+	return list;
+}
+
+static inline void _ps_continue_statement(PSparseTokens& tokens, uint32_t& curTokenIdx, uint32_t& numOpenParens)
+{
+	if(_ps_token_type(tokens, curTokenIdx) == PStoken::NEWLINE && numOpenParens != 0)
+	{
+		curTokenIdx++;
+		if(_ps_at_end(tokens, curTokenIdx))
+			_ps_error(PSparseError::EXPECTED_CLOSING_PAREN, _ps_token(tokens, curTokenIdx - 1));
+	}
+}
+
+static inline void _ps_remove_newline(PSparseTokens& tokens, uint32_t& curTokenIdx)
+{
+	if(_ps_token_type(tokens, curTokenIdx) == PStoken::NEWLINE)
+		curTokenIdx++;
+}
+
+static inline bool _ps_is_op_token(PStoken::Type type)
+{
+	return type >= PStoken::OP_MULT && type <= PStoken::KEYWORD_OR;
+}
+
+static inline bool _ps_token_op_type(PStoken::Type type, PSnode::OP::Type* opType)
+{
+	switch(type)
+	{
+	#define PS_OP_TYPE_CASE(tokenType, str, op) case PStoken::tokenType: *opType = PSnode::OP::op; return true;
+	PS_OPERATOR_TOKENS(PS_OP_TYPE_CASE)
+	PS_KEYWORD_OPERATOR_TOKENS(PS_OP_TYPE_CASE)
+	#undef PS_OP_TYPE_CASE
+	default:
+		return false;
+	}
+}
+
+static inline int _ps_precedence(PSnode::OP::Type op)
+{
+	return (int)op / 10;
+}
+
+static inline bool _ps_is_closed_seperator(PStoken::Type type)
+{
+	switch(type)
+	{
+	case PStoken::SEPERATOR_PAREN_CLOSE:
+	case PStoken::SEPERATOR_CURLY_CLOSE:
+	case PStoken::SEPERATOR_SQUARE_CLOSE:
+	case PStoken::SEPERATOR_COMMA:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static inline bool _ps_ends_expression(PStoken::Type type)
+{
+	return type == PStoken::NEWLINE || type == PStoken::SEPERATOR_CURLY_OPEN || _ps_is_closed_seperator(type);
+}
+
+static inline PStoken _ps_token(PSparseTokens& tokens, uint32_t idx)
+{
+	if(tokens.lexer)
+	{
+		const PStoken* token = ps_lexer_token(tokens.lexer, idx);
+		if(token)
+			return *token;
+	}
+	else if(idx < tokens.buffer->size())
+		return (*tokens.buffer)[idx];
+
+	PStoken end = {};
+	end.type = PStoken::NEWLINE;
+	end.value.symbol = UINT32_MAX;
+	return end;
+}
+
+static inline PStoken::Type _ps_token_type(PSparseTokens& tokens, uint32_t idx)
+{
+	if(tokens.lexer)
+	{
+		const PStoken* token = ps_lexer_token(tokens.lexer, idx);
+		return token ? token->type : PStoken::NEWLINE;
+	}
+	else
+		return idx < tokens.buffer->size() ? tokens.buffer->types[idx] : PStoken::NEWLINE;
+}
+
+static inline bool _ps_at_end(PSparseTokens& tokens, uint32_t idx)
+{
+	if(tokens.lexer)
+		return ps_lexer_token(tokens.lexer, idx) == nullptr;
+	else
+		return idx >= tokens.buffer->size();
+}
+
+static inline std::string_view _ps_token_str(PSparseTokens& tokens, uint32_t idx)
+{
+	return _ps_token_str(tokens, _ps_token(tokens, idx));
+}
+
+static inline std::string_view _ps_token_str(PSparseTokens& tokens, const PStoken& token)
+{
+	if(tokens.lexer)
+		return ps_lexer_token_str(tokens.lexer, token);
+	else
+		return ps_token_str(*tokens.buffer, token);
+}
+
+static inline void _ps_force_id(PSparseTokens& tokens, uint32_t idx)
+{
+	if(_ps_token_type(tokens, idx) == PStoken::ID)
+		return;
+
+	if(_ps_token_type(tokens, idx) < PStoken::KEYWORD_IN) //operator keywords are reported the same way as other keywords
+		_ps_error(PSparseError::UNEXPECTED_OPERATOR, _ps_token(tokens, idx));
+	else
+		_ps_error(PSparseError::INVALID_TOKEN, _ps_token(tokens, idx));
+}
+
+static void _ps_error(PSparseError error, PStoken errorToken)
+{
+	g_psError = error;
+	g_psErrorToken = errorToken;
+	throw std::exception();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static PSnode _ps_object_node(const PSnode& node)
+{
+	PSnode result;
+	std::memset(&result, 0, sizeof(PSnode));
+	result.type = node.type;
+	result.lineNum = node.lineNum;
+
+	switch(node.type)
+	{
+	case PSnode::OP:
+	{
+		result.op.type = node.op.type;
+		result.op.left = node.op.left;
+		result.op.right = node.op.right;
+		break;
+	}
+	case PSnode::KEYWORD:
+	{
+		result.keyword.type = node.keyword.type;
+		result.keyword.hasElse = node.keyword.hasElse;
+
+		switch(node.keyword.type)
+		{
+		case PSnode::Keyword::IF:
+		case PSnode::Keyword::FOR:
+			result.keyword.condition = node.keyword.condition;
+			result.keyword.code = node.keyword.code;
+			result.keyword.elseCode = node.keyword.hasElse ? node.keyword.elseCode : 0;
+			break;
+		case PSnode::Keyword::FUNC:
+			result.keyword.name = node.keyword.name;
+			result.keyword.code = node.keyword.code;
+			result.keyword.paramNames = node.keyword.paramNames;
+			break;
+		case PSnode::Keyword::RETURN:
+			result.keyword.returnVal = node.keyword.returnVal;
+			break;
+		default:
+			break;
+		}
+
+		break;
+	}
+	case PSnode::ID:
+	{
+		result.id.type = node.id.type;
+		result.id.name = node.id.name;
+		result.id.params = node.id.params;
+		break;
+	}
+	case PSnode::NUMBER:
+	{
+		//only the member the literal's type uses is set, the parser leaves the others uninitialized:
+		result.literal.type = node.literal.type;
+		if(node.literal.type == PSnode::Literal::INT)
+			result.literal.intNum = node.literal.intNum;
+		else if(node.literal.type == PSnode::Literal::FLOAT)
+			result.literal.floatNum = node.literal.floatNum;
+		else
+			result.literal.constant = node.literal.constant;
+		break;
+	}
+	}
+
+	return result;
+}
+
+static std::vector<PSnode> _ps_object_nodes(PSast* ast)
+{
+	std::vector<PSnode> nodes(ast->nodePool.size());
+	for(size_t i = 0; i < nodes.size(); i++)
+		nodes[i] = _ps_object_node(ast->nodePool[i]);
+
+	return nodes;
+}
+
+static std::vector<char> _ps_object_constants(PSast* ast)
+{
+	std::vector<char> constants(ast->constants.size() * sizeof(PSdata), 0);
+	for(size_t i = 0; i < ast->constants.size(); i++)
+	{
+		char* constant = constants.data() + i * sizeof(PSdata);
+		std::memcpy(constant + offsetof(PSdata, type), &ast->constants[i].type, sizeof(PSdata::Type));
+		std::memcpy(constant + offsetof(PSdata, vec4Val), &ast->constants[i].vec4Val, sizeof(qm::vec4)); //the largest member of the value union
+	}
+
+	return constants;
+}
+
+static uint64_t _ps_object_align(uint64_t offset)
+{
+	return (offset + PS_OBJECT_ALIGNMENT - 1) / PS_OBJECT_ALIGNMENT * PS_OBJECT_ALIGNMENT;
+}
+
+static void _ps_write_section(std::ofstream& file, uint64_t* written, uint64_t offset, const void* data, size_t size)
+{
+	const char padding[PS_OBJECT_ALIGNMENT] = {};
+	file.write(padding, offset - *written);
+	if(size > 0)
+		file.write((const char*)data, size);
+
+	*written = offset + size;
+}
+
+static size_t _ps_object_element_size(PSobjectSection section)
+{
+	switch(section)
+	{
+	case PS_OBJECT_SECTION_NODES:
+		return sizeof(PSnode);
+	case PS_OBJECT_SECTION_SYMBOL_NAMES:
+		return sizeof(char);
+	case PS_OBJECT_SECTION_CONSTANTS:
+		return sizeof(PSdata);
+	case PS_OBJECT_SECTION_FUNCTIONS:
+		return sizeof(PSobjectFunction);
+	default:
+		return sizeof(uint32_t);
+	}
+}
+
+static bool _ps_valid_object_header(const PSobjectHeader& header, size_t size)
+{
+	if(header.version != PS_OBJECT_VERSION || header.byteOrder != PS_OBJECT_BYTE_ORDER ||
+	   header.nodeSize != sizeof(PSnode) || header.dataSize != sizeof(PSdata) || header.fileSize > size)
+		return false;
+
+	//the symbol offsets end with the total length of the names:
+	return _ps_valid_sections(header.sectionOffsets, header.sectionSizes, sizeof(PSobjectHeader), header.fileSize) &&
+	       header.sectionSizes[PS_OBJECT_SECTION_SYMBOL_OFFSETS] == (uint64_t)header.numSymbols + 1;
+}
+
+static bool _ps_valid_sections(const uint64_t* offsets, const uint64_t* sizes, uint64_t minOffset, uint64_t fileSize)
+{
+	for(int i = 0; i < PS_OBJECT_SECTION_COUNT; i++)
+	{
+		if(offsets[i] % PS_OBJECT_ALIGNMENT != 0 || offsets[i] < minOffset || offsets[i] > fileSize ||
+		   sizes[i] > (fileSize - offsets[i]) / _ps_object_element_size((PSobjectSection)i))
+			return false;
+	}
+
+	//list 0 always exists, and handles have to fit in a PSnodeHandle:
+	return sizes[PS_OBJECT_SECTION_LISTS] > 0 && sizes[PS_OBJECT_SECTION_NODES] < UINT32_MAX && sizes[PS_OBJECT_SECTION_PARENT_NODES] < UINT32_MAX;
+}
+
+static bool _ps_valid_archive_header(const PSarchiveHeader& header, size_t size)
+{
+	if(std::memcmp(header.magic, PS_ARCHIVE_MAGIC, sizeof(header.magic)) != 0 ||
+	   header.version != PS_ARCHIVE_VERSION || header.byteOrder != PS_OBJECT_BYTE_ORDER ||
+	   header.nodeSize != sizeof(PSnode) || header.dataSize != sizeof(PSdata) || header.fileSize > size)
+		return false;
+
+	return header.indexOffset % PS_OBJECT_ALIGNMENT == 0 && header.indexOffset >= sizeof(PSarchiveHeader) && header.indexOffset <= header.fileSize &&
+	       header.numScripts <= (header.fileSize - header.indexOffset) / sizeof(PSarchiveEntry) &&
+	       header.stringsOffset <= header.fileSize && header.stringsSize <= header.fileSize - header.stringsOffset && header.stringsSize < UINT32_MAX;
+}
+
+static PSastView _ps_object_view(const char* base, const uint64_t* offsets, const uint64_t* sizes)
+{
+	PSastView view;
+	view.parentNodes = (const PSnodeHandle*)(base + offsets[PS_OBJECT_SECTION_PARENT_NODES]);
+	view.numParentNodes = (uint32_t)sizes[PS_OBJECT_SECTION_PARENT_NODES];
+	view.nodePool = (const PSnode*)(base + offsets[PS_OBJECT_SECTION_NODES]);
+	view.numNodes = (uint32_t)sizes[PS_OBJECT_SECTION_NODES];
+	view.lists = (const uint32_t*)(base + offsets[PS_OBJECT_SECTION_LISTS]);
+	view.symbolNames = base + offsets[PS_OBJECT_SECTION_SYMBOL_NAMES];
+	view.symbolStarts = (const uint32_t*)(base + offsets[PS_OBJECT_SECTION_SYMBOL_OFFSETS]);
+	view.symbolEnds = view.symbolStarts + 1;
+	view.numSymbols = (uint32_t)sizes[PS_OBJECT_SECTION_SYMBOL_OFFSETS] - 1;
+	view.constants = (const PSdata*)(base + offsets[PS_OBJECT_SECTION_CONSTANTS]);
+
+	return view;
+}
+
+static std::vector<PSobjectFunction> _ps_object_functions(PSast* ast)
+{
+	std::vector<PSobjectFunction> functions;
+	std::vector<PSnodeHandle> stack;
+
+	for(PSnodeHandle definition : ast->parentNodes)
+	{
+		const PSnode& func = ast->nodePool[definition];
+		if(func.type != PSnode::KEYWORD || func.keyword.type != PSnode::Keyword::FUNC)
+			continue;
+
+		//find the range of nodes and lists the body uses, counting them to check nothing else is in it:
+		uint32_t firstNode = UINT32_MAX, endNode = 0, numNodes = 0;
+		uint32_t firstList = UINT32_MAX, endList = 0, listsSize = 0;
+		auto addList = [&](PSnodeList list, bool handles) {
+			if(list == 0)
+				return;
+
+			firstList = std::min(firstList, list);
+			endList = std::max(endList, list + ast->list_size(list) + 1);
+			listsSize += ast->list_size(list) + 1;
+			if(handles)
+				stack.insert(stack.end(), ast->list_data(list), ast->list_data(list) + ast->list_size(list));
+		};
+
+		stack.assign(ast->list_data(func.keyword.code), ast->list_data(func.keyword.code) + ast->list_size(func.keyword.code));
+		while(!stack.empty())
+		{
+			PSnodeHandle handle = stack.back();
+			stack.pop_back();
+			if(handle == UINT32_MAX)
+				continue;
+
+			firstNode = std::min(firstNode, handle);
+			endNode = std::max(endNode, handle + 1);
+			numNodes++;
+
+			const PSnode& node = ast->nodePool[handle];
+			switch(node.type)
+			{
+			case PSnode::OP:
+				stack.push_back(node.op.left);
+				if(node.op.type != PSnode::OP::NEG)
+					stack.push_back(node.op.right);
+				break;
+			case PSnode::KEYWORD:
+				switch(node.keyword.type)
+				{
+				case PSnode::Keyword::IF:
+				case PSnode::Keyword::FOR:
+					stack.push_back(node.keyword.condition);
+					addList(node.keyword.code, true);
+					if(node.keyword.hasElse)
+						addList(node.keyword.elseCode, true);
+					break;
+				case PSnode::Keyword::FUNC:
+					addList(node.keyword.paramNames, false);
+					addList(node.keyword.code, true);
+					break;
+				case PSnode::Keyword::RETURN:
+					stack.push_back(node.keyword.returnVal);
+					break;
+				default:
+					break;
+				}
+				break;
+			case PSnode::ID:
+				addList(node.id.params, true);
+				break;
+			default:
+				break;
+			}
+		}
+
+		if(numNodes == 0 || endNode - firstNode != numNodes || (listsSize > 0 && endList - firstList != listsSize))
+			continue;
+
+		if(listsSize == 0)
+			firstList = 0;
+		functions.push_back({definition, firstNode, numNodes, firstList, listsSize});
+	}
+
+	//keep the bodies that follow the ones before them in both nodes and lists, as in compacted asts:
+	std::sort(functions.begin(), functions.end(), [](const PSobjectFunction& a, const PSobjectFunction& b) { return a.firstNode < b.firstNode; });
+
+	std::vector<PSobjectFunction> result;
+	uint32_t endNode = 0;
+	uint32_t endList = 1;
+	for(const PSobjectFunction& function : functions)
+	{
+		if(function.firstNode < endNode || (function.listsSize > 0 && function.firstList < endList))
+			continue;
+
+		result.push_back(function);
+		endNode = function.firstNode + function.numNodes;
+		if(function.listsSize > 0)
+			endList = function.firstList + function.listsSize;
+	}
+
+	return result;
+}
+
+static bool _ps_valid_object_functions(const PSobjectFunction* functions, uint64_t numFunctions, uint64_t numNodes, uint64_t listsSize)
+{
+	//list 0 is never part of a body, so a body's lists start after it. bodies without lists have no list range:
+	uint64_t endNode = 0;
+	uint64_t endList = 1;
+	for(uint64_t i = 0; i < numFunctions; i++)
+	{
+		const PSobjectFunction& function = functions[i];
+		if(function.firstNode < endNode || function.firstNode > numNodes || function.numNodes > numNodes - function.firstNode ||
+		   function.definition >= numNodes)
+			return false;
+
+		if(function.listsSize > 0 && (function.firstList < endList || function.firstList > listsSize || function.listsSize > listsSize - function.firstList))
+			return false;
+
+		endNode = (uint64_t)function.firstNode + function.numNodes;
+		if(function.listsSize > 0)
+			endList = (uint64_t)function.firstList + function.listsSize;
+	}
+
+	return true;
+}
+
+static uint32_t _ps_object_body(const PSobjectFunction* functions, uint32_t numFunctions, PSnodeHandle handle)
+{
+	const PSobjectFunction* next = std::upper_bound(functions, functions + numFunctions, handle,
+		[](PSnodeHandle handle, const PSobjectFunction& function) { return handle < function.firstNode; });
+	if(next == functions || handle - next[-1].firstNode >= next[-1].numNodes)
+		return numFunctions;
+
+	return (uint32_t)(next - 1 - functions);
+}
+
+static bool _ps_object_parent_bounds(const PSastView& ast, const PSobjectFunction* functions, uint32_t numFunctions,
+                                     uint64_t listsSize, uint64_t numConstants, PSloadBounds* bounds)
+{
+	*bounds = {ast.nodePool, ast.lists, ast.numSymbols, numConstants, 0, ast.numNodes, 0, listsSize};
+	bounds->functions = functions;
+	bounds->numFunctions = numFunctions;
+	for(uint32_t i = 0; i < numFunctions; i++)
+	{
+		if(functions[i].listsSize > 0)
+			bounds->bodyLists.push_back({functions[i].firstList, (uint64_t)functions[i].firstList + functions[i].listsSize});
+		bounds->definitions.push_back(functions[i].definition);
+	}
+
+	//the resolver only waits to read a body when its definition is resolved as a parent node, so every definition has to be one:
+	std::vector<PSnodeHandle> parentNodes(ast.parentNodes, ast.parentNodes + ast.numParentNodes);
+	std::sort(parentNodes.begin(), parentNodes.end());
+	std::sort(bounds->definitions.begin(), bounds->definitions.end());
+	if(std::adjacent_find(bounds->definitions.begin(), bounds->definitions.end()) != bounds->definitions.end())
+		return false;
+
+	for(PSnodeHandle parent : parentNodes)
+		if(parent >= ast.numNodes || _ps_object_body(functions, numFunctions, parent) < numFunctions)
+			return false;
+
+	for(PSnodeHandle definition : bounds->definitions)
+		if(!std::binary_search(parentNodes.begin(), parentNodes.end(), definition))
+			return false;
+
+	return true;
+}
+
+static bool _ps_valid_handle(const PSloadBounds& bounds, PSnodeHandle handle, bool allowNone)
+{
+	if(allowNone && handle == UINT32_MAX)
+		return true;
+	if(handle < bounds.firstNode || handle >= bounds.endNode)
+		return false;
+
+	return bounds.numFunctions == 0 || (_ps_object_body(bounds.functions, bounds.numFunctions, handle) == bounds.numFunctions &&
+	                                    !std::binary_search(bounds.definitions.begin(), bounds.definitions.end(), handle));
+}
+
+static bool _ps_valid_list(const PSloadBounds& bounds, PSnodeList list)
+{
+	if(list == 0)
+		return bounds.lists[0] == 0;
+	if(list < bounds.firstList || list >= bounds.endList || (bounds.listStarts && !(*bounds.listStarts)[list]))
+		return false;
+
+	//the list has to end before the next body's lists, and its length can only be read once it isn't in a body:
+	auto body = std::partition_point(bounds.bodyLists.begin(), bounds.bodyLists.end(),
+		[list](const std::pair<uint64_t, uint64_t>& range) { return range.second <= list; });
+	if(body != bounds.bodyLists.end() && body->first <= list)
+		return false;
+
+	uint64_t end = body != bounds.bodyLists.end() ? body->first : bounds.endList;
+	return bounds.lists[list] < end - list;
+}
+
+static bool _ps_valid_node(const PSloadBounds& bounds, PSnodeHandle handle)
+{
+	//elements are checked by what they're used as. a parent function's code is the only list allowed to reach into a body, its own:
+	auto validCode = [&](PSnodeList list, bool definition) {
+		if(!_ps_valid_list(bounds, list))
+			return false;
+
+		for(uint32_t i = 0; i < bounds.lists[list]; i++)
+		{
+			PSnodeHandle element = bounds.lists[list + 1 + i];
+			if(_ps_valid_handle(bounds, element, false))
+				continue;
+
+			uint32_t body = _ps_object_body(bounds.functions, bounds.numFunctions, element);
+			if(!definition || body == bounds.numFunctions || bounds.functions[body].definition != handle)
+				return false;
+		}
+
+		return true;
+	};
+	auto validSymbols = [&](PSnodeList list) {
+		if(!_ps_valid_list(bounds, list))
+			return false;
+
+		for(uint32_t i = 0; i < bounds.lists[list]; i++)
+			if(bounds.lists[list + 1 + i] >= bounds.numSymbols)
+				return false;
+
+		return true;
+	};
+
+	const PSnode& node = bounds.nodes[handle];
+	uint8_t hasElse;
+	std::memcpy(&hasElse, &node.keyword.hasElse, sizeof(uint8_t));
+	switch(node.type)
+	{
+	case PSnode::OP:
+		switch(node.op.type)
+		{
+		case PSnode::OP::IN:
+		case PSnode::OP::MULT: case PSnode::OP::DIV: case PSnode::OP::MOD:
+		case PSnode::OP::ADD: case PSnode::OP::SUB:
+		case PSnode::OP::EQUAL: case PSnode::OP::MULTEQUAL: case PSnode::OP::DIVEQUAL: case PSnode::OP::MODEQUAL: case PSnode::OP::ADDEQUAL: case PSnode::OP::SUBEQUAL:
+		case PSnode::OP::LESSTHAN: case PSnode::OP::GREATERTHAN: case PSnode::OP::LESSTHANEQUAL: case PSnode::OP::GREATERTHANEQUAL:
+		case PSnode::OP::EQUALITY: case PSnode::OP::NONEQUALITY:
+		case PSnode::OP::AND: case PSnode::OP::OR:
+			return _ps_valid_handle(bounds, node.op.left, false) && _ps_valid_handle(bounds, node.op.right, false);
+		case PSnode::OP::NEG:
+			return _ps_valid_handle(bounds, node.op.left, false);
+		default:
+			return false;
+		}
+	case PSnode::KEYWORD:
+		switch(node.keyword.type)
+		{
+		case PSnode::Keyword::IF:
+		case PSnode::Keyword::FOR:
+			return _ps_valid_handle(bounds, node.keyword.condition, false) && validCode(node.keyword.code, false) && hasElse <= 1 &&
+			       (hasElse == 0 || validCode(node.keyword.elseCode, false));
+		case PSnode::Keyword::FUNC:
+			return node.keyword.name < bounds.numSymbols && validCode(node.keyword.code, true) && validSymbols(node.keyword.paramNames);
+		case PSnode::Keyword::RETURN:
+			return _ps_valid_handle(bounds, node.keyword.returnVal, true);
+		case PSnode::Keyword::BREAK:
+		case PSnode::Keyword::CONTINUE:
+			return true;
+		default:
+			return false;
+		}
+	case PSnode::ID:
+		return node.id.type <= PSnode::ID::VAR && node.id.name < bounds.numSymbols && validCode(node.id.params, false);
+	case PSnode::NUMBER:
+		return node.literal.type == PSnode::Literal::INT || node.literal.type == PSnode::Literal::FLOAT ||
+		       (node.literal.type == PSnode::Literal::CONSTANT && node.literal.constant < bounds.numConstants);
+	default:
+		return false;
+	}
+}
+
+static bool _ps_valid_nodes(const PSloadBounds& bounds)
+{
+	const PSobjectFunction* body = bounds.functions;
+	const PSobjectFunction* bodiesEnd = bounds.functions + bounds.numFunctions;
+	for(uint64_t i = bounds.firstNode; i < bounds.endNode; i++)
+	{
+		while(body != bodiesEnd && (uint64_t)body->firstNode + body->numNodes <= i)
+			body++;
+		if(body != bodiesEnd && body->firstNode <= i)
+		{
+			i = (uint64_t)body->firstNode + body->numNodes - 1;
+			continue;
+		}
+
+		if(!_ps_valid_node(bounds, (PSnodeHandle)i))
+			return false;
+	}
+
+	return true;
+}
+
+static bool _ps_valid_loaded_ast(const PSast* ast, const std::vector<bool>* listStarts)
+{
+	if(ast->lists.empty())
+		return false;
+
+	PSloadBounds bounds = {ast->nodePool.data(), ast->lists.data(), ps_symbol_count(ast->symbols), ast->constants.size(),
+	                       0, ast->nodePool.size(), 0, ast->lists.size()};
+	bounds.listStarts = listStarts;
+	for(PSnodeHandle parent : ast->parentNodes)
+		if(parent >= ast->nodePool.size())
+			return false;
+
+	return _ps_valid_nodes(bounds) && _ps_valid_constants(ast->constants.data(), ast->constants.size());
+}
+
+static bool _ps_valid_symbol_offsets(const uint32_t* offsets, uint64_t numOffsets, uint64_t namesSize)
+{
+	for(uint64_t i = 0; i < numOffsets; i++)
+		if(offsets[i] > namesSize || (i > 0 && offsets[i] < offsets[i - 1]))
+			return false;
+
+	return true;
+}
+
+static bool _ps_valid_constants(const PSdata* constants, uint64_t numConstants)
+{
+	//the type is copied out, reading an enum or bool that holds a value it can't have is undefined:
+	for(uint64_t i = 0; i < numConstants; i++)
+	{
+		uint32_t type = 0;
+		std::memcpy(&type, &constants[i].type, sizeof(PSdata::Type));
+		if(type > PSdata::QUATERNION)
+			return false;
+	}
+
+	return true;
+}
+
+static PSastView _ps_archive_view(PSarchive* archive, const PSarchiveEntry& entry)
+{
+	PSastView view = _ps_object_view(archive->data.get(), entry.sectionOffsets, entry.sectionSizes);
+	view.symbolNames = archive->strings;
+	view.symbolEnds = view.symbolStarts + entry.numSymbols;
+	view.numSymbols = entry.numSymbols;
+
+	return view;
+}
+
+static const PSarchiveEntry* _ps_find_archive_entry(PSarchive* archive, std::string_view name)
+{
+	const PSarchiveEntry* entry = std::lower_bound(archive->entries, archive->entries + archive->numScripts, name,
+		[archive](const PSarchiveEntry& entry, std::string_view name) {
+			return std::string_view(archive->strings + entry.nameStart, entry.nameEnd - entry.nameStart) < name;
+		});
+
+	if(entry == archive->entries + archive->numScripts || std::string_view(archive->strings + entry->nameStart, entry->nameEnd - entry->nameStart) != name)
+		return nullptr;
+
+	//only the script's own symbols are checked, the others are never read:
+	const uint32_t* symbolOffsets = (const uint32_t*)(archive->data.get() + entry->sectionOffsets[PS_OBJECT_SECTION_SYMBOL_OFFSETS]);
+	for(uint32_t i = 0; i < entry->numSymbols; i++)
+		if(symbolOffsets[i] > symbolOffsets[entry->numSymbols + i] || symbolOffsets[entry->numSymbols + i] > archive->stringsSize)
+		{
+			std::cout << "PROPSCRIPT LOAD ERROR: SCRIPT \"" << name << "\" HAS INVALID SYMBOLS" << std::endl;
+			return nullptr;
+		}
+
+	return entry;
+}
+
+static uint64_t _ps_hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+	for(size_t i = 0; i < size; i++)
+		hash = (hash ^ ((const uint8_t*)data)[i]) * 1099511628211ull;
+
+	return hash;
+}
+
+static bool _ps_save_ast_atomic(const std::string& path, PSast* ast)
+{
+	//the temporary name is unique to this call, so concurrent writers never share a file:
+	std::random_device random;
+	char suffix[32];
+	std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", random(), random());
+	std::string tempPath = path + suffix;
+
+	std::ofstream file(tempPath, std::ios_base::binary);
+	if(!file.is_open())
+		return false;
+
+	ps_save_ast(file, ast);
+	file.close();
+	if(!file)
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	//rename replaces the entry atomically on posix. where it fails, as on windows if the entry exists, another process already wrote it
+	if(std::rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		return std::ifstream(path).is_open();
+	}
+
+	return true;
+}
+
+static PSast* _ps_load_unversioned_ast(std::ifstream& file)
+{
+	//read the rest of the file, every length in it is checked against the bytes left before anything is allocated:
+	std::streampos start = file.tellg();
+	file.seekg(0, std::ios_base::end);
+	std::streamoff size = file.tellg() - start;
+	file.seekg(start);
+
+	std::vector<uint8_t> data(size > 0 ? (size_t)size : 0);
+	file.read((char*)data.data(), data.size());
+	PSpackedReader reader = {data.data(), data.data() + data.size(), !file};
+
+	PSast* result = new PSast;
+	uint64_t numParentNodes = _ps_read_length(reader, sizeof(PSnodeHandle));
+	result->parentNodes.resize(numParentNodes);
+	_ps_read_bytes(reader, result->parentNodes.data(), numParentNodes * sizeof(PSnodeHandle));
+
+	uint64_t numNodes = _ps_read_length(reader, 2 * sizeof(uint32_t)); //every node starts with its type and line number
+	result->nodePool.reserve(numNodes);
+	for(uint64_t i = 0; i < numNodes && !reader.failed; i++)
+	{
+		PSnode node{};
+		uint32_t type = _ps_read_uint32(reader);
+		node.type = (PSnode::Type)type;
+		node.lineNum = _ps_read_uint32(reader);
+
+		switch(type)
+		{
+		case PSnode::OP:
+		{
+			//the last build wrote the whole operator struct, then its children again. older builds wrote only a smaller struct,
+			//so the layout is found by whether the children repeat:
+			uint32_t op[PS_UNVERSIONED_OP_SIZE / sizeof(uint32_t) + 2] = {};
+			std::memcpy(op, reader.cur, std::min(sizeof(op), (size_t)(reader.end - reader.cur)));
+			bool repeated = op[4] == op[1] && op[5] == op[2];
+			_ps_read_bytes(reader, op, repeated ? sizeof(op) : PS_UNVERSIONED_OLD_OP_SIZE);
+
+			uint32_t opType = op[0];
+			node.op.type = (PSnode::OP::Type)opType;
+			node.op.left = op[1];
+			node.op.right = op[2];
+			reader.failed |= opType > PSnode::OP::OR;
+			break;
+		}
+		case PSnode::KEYWORD:
+		{
+			//every field was written whatever the keyword's type:
+			uint32_t keywordType = _ps_read_uint32(reader);
+			PSnodeList code = _ps_read_unversioned_list(reader, result);
+			PSnodeHandle condition = _ps_read_uint32(reader);
+			uint8_t hasElse = 0;
+			_ps_read_bytes(reader, &hasElse, sizeof(uint8_t));
+			PSnodeList elseCode = _ps_read_unversioned_list(reader, result);
+			std::string_view name = _ps_read_unversioned_name(reader);
+
+			std::vector<uint32_t> paramNames(_ps_read_length(reader, sizeof(size_t)));
+			for(size_t j = 0; j < paramNames.size() && !reader.failed; j++)
+				paramNames[j] = ps_intern_symbol(result->symbols, _ps_read_unversioned_name(reader));
+			PSnodeHandle returnVal = _ps_read_uint32(reader);
+
+			node.keyword.type = (PSnode::Keyword::Type)keywordType;
+			switch(keywordType)
+			{
+			case PSnode::Keyword::IF:
+			case PSnode::Keyword::FOR:
+				node.keyword.condition = condition;
+				node.keyword.code = code;
+				node.keyword.hasElse = hasElse != 0;
+				node.keyword.elseCode = hasElse != 0 ? elseCode : 0;
+				break;
+			case PSnode::Keyword::FUNC:
+				node.keyword.name = ps_intern_symbol(result->symbols, name);
+				node.keyword.code = code;
+				node.keyword.paramNames = _ps_add_unversioned_list(result, paramNames);
+				break;
+			case PSnode::Keyword::RETURN:
+				node.keyword.returnVal = returnVal;
+				break;
+			case PSnode::Keyword::BREAK:
+			case PSnode::Keyword::CONTINUE:
+				break;
+			default:
+				reader.failed = true;
+				break;
+			}
+
+			break;
+		}
+		case PSnode::ID:
+		{
+			uint32_t idType = _ps_read_uint32(reader);
+			node.id.type = (PSnode::ID::Type)idType;
+			node.id.name = ps_intern_symbol(result->symbols, _ps_read_unversioned_name(reader));
+			node.id.params = _ps_read_unversioned_list(reader, result);
+			reader.failed |= idType > PSnode::ID::VAR;
+			break;
+		}
+		case PSnode::NUMBER:
+		{
+			uint32_t literalType = _ps_read_uint32(reader);
+			int32_t intNum = (int32_t)_ps_read_uint32(reader);
+			float floatNum;
+			_ps_read_bytes(reader, &floatNum, sizeof(float));
+
+			node.literal.type = (PSnode::Literal::Type)literalType;
+			if(literalType == PSnode::Literal::INT)
+				node.literal.intNum = intNum;
+			else if(literalType == PSnode::Literal::FLOAT)
+				node.literal.floatNum = floatNum;
+			else
+				reader.failed = true;
+			break;
+		}
+		default:
+			reader.failed = true;
+			break;
+		}
+
+		result->nodePool.push_back(node);
+	}
+
+	if(reader.failed || !_ps_valid_loaded_ast(result))
+	{
+		std::cout << "PROPSCRIPT LOAD ERROR: OBJECT FILE IS TRUNCATED OR CORRUPT" << std::endl;
+		delete result;
+		return nullptr;
+	}
+
+	file.clear();
+	file.seekg(start + (std::streamoff)(reader.cur - data.data()));
+	return result;
+}
+
+static inline void _ps_read_bytes(PSpackedReader& reader, void* dest, size_t size)
+{
+	if(reader.failed || size > (size_t)(reader.end - reader.cur))
+	{
+		reader.failed = true;
+		return;
+	}
+
+	if(size > 0)
+		std::memcpy(dest, reader.cur, size);
+	reader.cur += size;
+}
+
+static inline uint32_t _ps_read_uint32(PSpackedReader& reader)
+{
+	uint32_t value = 0;
+	_ps_read_bytes(reader, &value, sizeof(uint32_t));
+	return value;
+}
+
+static inline uint64_t _ps_read_length(PSpackedReader& reader, size_t elementSize)
+{
+	size_t length = 0;
+	_ps_read_bytes(reader, &length, sizeof(size_t));
+	if(reader.failed || length > (size_t)(reader.end - reader.cur) / elementSize)
+	{
+		reader.failed = true;
+		return 0;
+	}
+
+	return length;
+}
+
+static PSnodeList _ps_read_unversioned_list(PSpackedReader& reader, PSast* ast)
+{
+	std::vector<uint32_t> handles(_ps_read_length(reader, sizeof(PSnodeHandle)));
+	_ps_read_bytes(reader, handles.data(), handles.size() * sizeof(PSnodeHandle));
+	return _ps_add_unversioned_list(ast, handles);
+}
+
+static PSnodeList _ps_add_unversioned_list(PSast* ast, const std::vector<uint32_t>& elements)
+{
+	if(elements.empty())
+		return 0;
+
+	PSnodeList list = (PSnodeList)ast->lists.size();
+	ast->lists.push_back((uint32_t)elements.size());
+	ast->lists.insert(ast->lists.end(), elements.begin(), elements.end());
+	return list;
+}
+
+static std::string_view _ps_read_unversioned_name(PSpackedReader& reader)
+{
+	uint64_t length = _ps_read_length(reader, sizeof(char));
+	std::string_view name((const char*)reader.cur, length);
+	reader.cur += length;
+	return name;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+static inline void _ps_write_varint(std::vector<char>& out, uint64_t value)
+{
+	while(value >= 0x80)
+	{
+		out.push_back((char)(value | 0x80));
+		value >>= 7;
+	}
+
+	out.push_back((char)value);
+}
+
+static inline void _ps_write_float(std::vector<char>& out, float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(float));
+	for(int i = 0; i < 4; i++)
+		out.push_back((char)(bits >> (i * 8)));
+}
+
+static inline uint64_t _ps_read_varint(PSpackedReader& reader)
+{
+	if(reader.cur < reader.end && *reader.cur < 0x80) //most fields fit in a byte
+		return *reader.cur++;
+
+	uint64_t value = 0;
+	for(int shift = 0; shift < 64 && reader.cur < reader.end; shift += 7)
+	{
+		uint8_t byte = *reader.cur++;
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if(!(byte & 0x80))
+			return value;
+	}
+
+	reader.failed = true;
+	return 0;
+}
+
+static inline float _ps_read_float(PSpackedReader& reader)
+{
+	if(reader.end - reader.cur < 4)
+	{
+		reader.failed = true;
+		return 0.0f;
+	}
+
+	uint32_t bits = 0;
+	for(int i = 0; i < 4; i++)
+		bits |= (uint32_t)reader.cur[i] << (i * 8);
+	reader.cur += 4;
+
+	float value;
+	std::memcpy(&value, &bits, sizeof(float));
+	return value;
+}
+
+static inline uint64_t _ps_zigzag(int64_t value)
+{
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t _ps_unzigzag(uint64_t value)
+{
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static uint32_t _ps_packed_components(PSdata::Type type)
+{
+	switch(type)
+	{
+	case PSdata::INT:
+	case PSdata::FLOAT:
+		return 1;
+	case PSdata::VEC2:
+		return 2;
+	case PSdata::VEC3:
+		return 3;
+	case PSdata::VEC4:
+	case PSdata::QUATERNION:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+static bool _ps_encode_packed_payload(PSast* ast, std::vector<char>& out)
+{
+	//the decoder walks the lists by their lengths, so they have to be back to back:
+	size_t listsSize = ast->lists.size();
+	size_t listIdx = 1;
+	while(listIdx < listsSize && ast->lists[listIdx] < listsSize - listIdx)
+		listIdx += ast->lists[listIdx] + 1;
+
+	if(listsSize == 0 || ast->lists[0] != 0 || listIdx != listsSize)
+		return false;
+
+	//write the symbols and constants, floats as their bits:
+	uint32_t numSymbols = ps_symbol_count(ast->symbols);
+	_ps_write_varint(out, numSymbols);
+	for(uint32_t i = 0; i < numSymbols; i++)
+	{
+		std::string_view name = ps_symbol_name(ast->symbols, i);
+		_ps_write_varint(out, name.size());
+		out.insert(out.end(), name.begin(), name.end());
+	}
+
+	_ps_write_varint(out, ast->constants.size());
+	for(const PSdata& constant : ast->constants)
+	{
+		_ps_write_varint(out, constant.type);
+		if(constant.type == PSdata::INT)
+			_ps_write_varint(out, _ps_zigzag(constant.intVal));
+		else
+			for(uint32_t i = 0; i < _ps_packed_components(constant.type); i++)
+				_ps_write_float(out, constant.vec4Val.v[i]); //every vector type and quaternions store their components first
+	}
+
+	_ps_write_varint(out, ast->parentNodes.size());
+	_ps_write_varint(out, ast->nodePool.size());
+	_ps_write_varint(out, listsSize);
+
+	PSnodeHandle prevParent = 0;
+	for(PSnodeHandle parent : ast->parentNodes)
+	{
+		_ps_write_varint(out, _ps_zigzag((int64_t)parent - prevParent));
+		prevParent = parent;
+	}
+
+	//write each node as a tag of its type and subtype, then its fields relative to the node or last list:
+	uint32_t prevLine = 0;
+	PSnodeList prevList = 0;
+	for(uint32_t i = 0; i < ast->nodePool.size(); i++)
+	{
+		const PSnode& node = ast->nodePool[i];
+		auto writeHandle = [&](PSnodeHandle handle) {
+			_ps_write_varint(out, handle == UINT32_MAX ? 0 : _ps_zigzag((int64_t)handle - i) + 1);
+		};
+		auto writeList = [&](PSnodeList list) {
+			_ps_write_varint(out, list == 0 ? 0 : _ps_zigzag((int64_t)list - prevList) + 1);
+			prevList = list != 0 ? list : prevList;
+		};
+
+		uint32_t subtype = 0;
+		switch(node.type)
+		{
+		case PSnode::OP:
+			subtype = node.op.type;
+			break;
+		case PSnode::KEYWORD:
+			subtype = node.keyword.type * 2 + (node.keyword.hasElse ? 1 : 0);
+			break;
+		case PSnode::ID:
+			subtype = node.id.type;
+			break;
+		case PSnode::NUMBER:
+			subtype = node.literal.type;
+			break;
+		}
+
+		_ps_write_varint(out, node.type | subtype << 2);
+		_ps_write_varint(out, _ps_zigzag((int64_t)node.lineNum - prevLine));
+		prevLine = node.lineNum;
+
+		switch(node.type)
+		{
+		case PSnode::OP:
+		{
+			writeHandle(node.op.left);
+			writeHandle(node.op.right);
+			break;
+		}
+		case PSnode::KEYWORD:
+		{
+			switch(node.keyword.type)
+			{
+			case PSnode::Keyword::IF:
+			case PSnode::Keyword::FOR:
+				writeHandle(node.keyword.condition);
+				writeList(node.keyword.code);
+				if(node.keyword.hasElse)
+					writeList(node.keyword.elseCode);
+				break;
+			case PSnode::Keyword::FUNC:
+				_ps_write_varint(out, node.keyword.name);
+				writeList(node.keyword.code);
+				writeList(node.keyword.paramNames);
+				break;
+			case PSnode::Keyword::RETURN:
+				writeHandle(node.keyword.returnVal);
+				break;
+			default:
+				break;
+			}
+
+			break;
+		}
+		case PSnode::ID:
+		{
+			_ps_write_varint(out, node.id.name);
+			writeList(node.id.params);
+			break;
+		}
+		case PSnode::NUMBER:
+		{
+			//only the field the literal's type uses is stored:
+			if(node.literal.type == PSnode::Literal::INT)
+				_ps_write_varint(out, _ps_zigzag(node.literal.intNum));
+			else if(node.literal.type == PSnode::Literal::FLOAT)
+				_ps_write_float(out, node.literal.floatNum);
+			else
+				_ps_write_varint(out, node.literal.constant);
+			break;
+		}
+		}
+	}
+
+	//write each list's length, then its elements relative to the previous one:
+	uint32_t prevElement = 0;
+	for(size_t i = 1; i < listsSize; i += ast->lists[i] + 1)
+	{
+		_ps_write_varint(out, ast->lists[i]);
+		for(uint32_t j = 0; j < ast->lists[i]; j++)
+		{
+			uint32_t element = ast->lists[i + 1 + j];
+			_ps_write_varint(out, _ps_zigzag((int64_t)element - prevElement));
+			prevElement = element;
+		}
+	}
+
+	return true;
+}
+
+static PSast* _ps_decode_packed_payload(const uint8_t* data, size_t size)
+{
+	PSpackedReader reader = {data, data + size, false};
+	PSast* result = new PSast;
+
+	//counts are checked against the bytes left before allocating, every element takes at least a byte:
+	auto readCount = [&]() {
+		uint64_t count = _ps_read_varint(reader);
+		if(count > (uint64_t)(reader.end - reader.cur) || count >= UINT32_MAX)
+		{
+			reader.failed = true;
+			return (uint64_t)0;
+		}
+
+		return count;
+	};
+
+	uint64_t numSymbols = readCount();
+	for(uint64_t i = 0; i < numSymbols && !reader.failed; i++)
+	{
+		uint64_t length = _ps_read_varint(reader);
+		if(length > (uint64_t)(reader.end - reader.cur))
+			reader.failed = true;
+		else if(ps_intern_symbol(result->symbols, std::string_view((const char*)reader.cur, length)) != i) //duplicates would shift the ids
+			reader.failed = true;
+		else
+			reader.cur += length;
+	}
+
+	uint64_t numConstants = readCount();
+	result->constants.resize(numConstants);
+	for(uint64_t i = 0; i < numConstants && !reader.failed; i++)
+	{
+		PSdata& constant = result->constants[i];
+		constant.vec4Val = qm::vec4();
+
+		uint64_t type = _ps_read_varint(reader);
+		reader.failed |= type > PSdata::QUATERNION;
+		constant.type = type <= PSdata::QUATERNION ? (PSdata::Type)type : PSdata::VOID;
+		if(type == PSdata::INT)
+			constant.intVal = (int32_t)_ps_unzigzag(_ps_read_varint(reader));
+		else
+			for(uint32_t j = 0; j < _ps_packed_components(constant.type); j++)
+				constant.vec4Val.v[j] = _ps_read_float(reader);
+	}
+
+	uint64_t numParentNodes = readCount();
+	uint64_t numNodes = readCount();
+	uint64_t listsSize = readCount();
+	if(reader.failed || listsSize == 0)
+	{
+		delete result;
+		return nullptr;
+	}
+
+	int64_t parent = 0;
+	result->parentNodes.resize(numParentNodes);
+	for(uint64_t i = 0; i < numParentNodes; i++)
+	{
+		parent += _ps_unzigzag(_ps_read_varint(reader));
+		if(parent < 0 || (uint64_t)parent >= numNodes)
+			reader.failed = true;
+		result->parentNodes[i] = (PSnodeHandle)parent;
+	}
+
+	//decode each node, checking every reference so execution can't read out of bounds:
+	uint32_t line = 0;
+	PSnodeList list = 0;
+	result->nodePool.reserve(numNodes); //filled by pushing each node, resizing would clear the whole pool first
+	for(uint32_t i = 0; i < numNodes && !reader.failed; i++)
+	{
+		auto readHandle = [&]() {
+			uint64_t value = _ps_read_varint(reader);
+			int64_t handle = value == 0 ? UINT32_MAX : (int64_t)i + _ps_unzigzag(value - 1);
+			if(value != 0 && (handle < 0 || (uint64_t)handle >= numNodes))
+				reader.failed = true;
+			return (PSnodeHandle)handle;
+		};
+		auto readList = [&]() {
+			uint64_t value = _ps_read_varint(reader);
+			if(value == 0)
+				return (PSnodeList)0;
+
+			int64_t next = (int64_t)list + _ps_unzigzag(value - 1);
+			if(next <= 0 || (uint64_t)next >= listsSize)
+				reader.failed = true;
+			list = (PSnodeList)next;
+			return list;
+		};
+		auto readIndex = [&](uint64_t count) {
+			uint64_t index = _ps_read_varint(reader);
+			if(index >= count)
+				reader.failed = true;
+			return (uint32_t)index;
+		};
+
+		PSnode node;
+		std::memset(&node, 0, sizeof(PSnode));
+
+		uint64_t tag = _ps_read_varint(reader);
+		uint64_t subtype = tag >> 2;
+		node.type = (PSnode::Type)(tag & 3);
+		line += (uint32_t)_ps_unzigzag(_ps_read_varint(reader));
+		node.lineNum = line;
+
+		switch(node.type)
+		{
+		case PSnode::OP:
+		{
+			node.op.type = (PSnode::OP::Type)subtype;
+			node.op.left = readHandle();
+			node.op.right = readHandle();
+			reader.failed |= subtype > PSnode::OP::OR;
+			break;
+		}
+		case PSnode::KEYWORD:
+		{
+			node.keyword.type = (PSnode::Keyword::Type)(subtype / 2);
+			node.keyword.hasElse = subtype % 2 != 0;
+			reader.failed |= subtype / 2 > PSnode::Keyword::CONTINUE;
+
+			switch(node.keyword.type)
+			{
+			case PSnode::Keyword::IF:
+			case PSnode::Keyword::FOR:
+				node.keyword.condition = readHandle();
+				node.keyword.code = readList();
+				if(node.keyword.hasElse)
+					node.keyword.elseCode = readList();
+				break;
+			case PSnode::Keyword::FUNC:
+				node.keyword.name = readIndex(numSymbols);
+				node.keyword.code = readList();
+				node.keyword.paramNames = readList();
+				break;
+			case PSnode::Keyword::RETURN:
+				node.keyword.returnVal = readHandle();
+				break;
+			case PSnode::Keyword::BREAK:
+			case PSnode::Keyword::CONTINUE:
+				break;
+			default:
+				reader.failed = true;
+				break;
+			}
+
+			break;
+		}
+		case PSnode::ID:
+		{
+			node.id.type = (PSnode::ID::Type)subtype;
+			node.id.name = readIndex(numSymbols);
+			node.id.params = readList();
+			reader.failed |= subtype > PSnode::ID::VAR;
+			break;
+		}
+		case PSnode::NUMBER:
+		{
+			node.literal.type = (PSnode::Literal::Type)subtype;
+			if(subtype == PSnode::Literal::INT)
+				node.literal.intNum = (int32_t)_ps_unzigzag(_ps_read_varint(reader));
+			else if(subtype == PSnode::Literal::FLOAT)
+				node.literal.floatNum = _ps_read_float(reader);
+			else if(subtype == PSnode::Literal::CONSTANT)
+				node.literal.constant = readIndex(numConstants);
+			else
+				reader.failed = true;
+			break;
+		}
+		}
+
+		result->nodePool.push_back(node);
+	}
+
+	//decode the lists, their lengths have to fill the array. elements are checked by use afterwards:
+	uint64_t maxElement = std::max(numNodes, numSymbols);
+	result->lists.resize(listsSize);
+	result->lists[0] = 0;
+	std::vector<bool> listStarts(listsSize);
+	listStarts[0] = true;
+	int64_t element = 0;
+	size_t listIdx = 1;
+	while(listIdx < listsSize && !reader.failed)
+	{
+		uint64_t length = _ps_read_varint(reader);
+		if(length >= listsSize - listIdx)
+		{
+			reader.failed = true;
+			break;
+		}
+
+		result->lists[listIdx] = (uint32_t)length;
+		listStarts[listIdx] = true;
+		for(uint64_t j = 0; j < length; j++)
+		{
+			element += _ps_unzigzag(_ps_read_varint(reader));
+			if(element < 0 || (uint64_t)element >= maxElement)
+				reader.failed = true;
+			result->lists[listIdx + 1 + j] = (uint32_t)element;
+		}
+
+		listIdx += length + 1;
+	}
+
+	if(reader.failed || reader.cur != reader.end || !_ps_valid_loaded_ast(result, &listStarts))
+	{
+		delete result;
+		return nullptr;
+	}
+
+	return result;
+}
+
+static void _ps_compress_block(const uint8_t* data, size_t size, std::vector<char>& out)
+{
+	//remember where each 4 byte sequence was last seen, and extend a match wherever it repeats:
+	std::vector<uint32_t> recent(1 << PS_PACKED_HASH_BITS, UINT32_MAX);
+	size_t literalStart = 0;
+	size_t pos = 0;
+	while(pos + PS_PACKED_MIN_MATCH <= size)
+	{
+		uint32_t sequence;
+		std::memcpy(&sequence, data + pos, sizeof(uint32_t));
+		uint32_t hash = (sequence * 2654435761u) >> (32 - PS_PACKED_HASH_BITS);
+		uint32_t candidate = recent[hash];
+		recent[hash] = (uint32_t)pos;
+
+		if(candidate == UINT32_MAX || std::memcmp(data + candidate, data + pos, PS_PACKED_MIN_MATCH) != 0)
+		{
+			pos++;
+			continue;
+		}
+
+		size_t length = PS_PACKED_MIN_MATCH;
+		while(pos + length < size && data[candidate + length] == data[pos + length])
+			length++;
+
+		_ps_write_varint(out, pos - literalStart);
+		out.insert(out.end(), (const char*)data + literalStart, (const char*)data + pos);
+		_ps_write_varint(out, pos - candidate);
+		_ps_write_varint(out, length - PS_PACKED_MIN_MATCH);
+
+		pos += length;
+		literalStart = pos;
+	}
+
+	//the block ends with the bytes after the last match:
+	_ps_write_varint(out, size - literalStart);
+	out.insert(out.end(), (const char*)data + literalStart, (const char*)data + size);
+}
+
+static bool _ps_decompress_block(PSpackedReader& reader, uint8_t* out, size_t size)
+{
+	size_t pos = 0;
+	while(true)
+	{
+		uint64_t numLiterals = _ps_read_varint(reader);
+		if(reader.failed || numLiterals > size - pos || numLiterals > (uint64_t)(reader.end - reader.cur))
+			return false;
+
+		std::memcpy(out + pos, reader.cur, numLiterals);
+		reader.cur += numLiterals;
+		pos += numLiterals;
+		if(pos == size)
+			break;
+
+		uint64_t offset = _ps_read_varint(reader);
+		uint64_t length = _ps_read_varint(reader) + PS_PACKED_MIN_MATCH;
+		if(reader.failed || offset == 0 || offset > pos || length > size - pos)
+			return false;
+
+		//a match that overlaps the bytes it produces repeats them, so it is copied a byte at a time:
+		if(offset >= length)
+			std::memcpy(out + pos, out + pos - offset, length);
+		else
+			for(uint64_t i = 0; i < length; i++)
+				out[pos + i] = out[pos + i - offset];
+		pos += length;
+	}
+
+	return reader.cur == reader.end;
+}
@@ -6,32 +6,154 @@
 #include "string"
 
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <string_view>
 #include "quickmath.hpp"
 
 //--------------------------------------------------------------------------------------------------------------------------------//
 //LEXER AND PARSER STRUCTS:
 
-//a lexical token
+//a table of interned symbol names, each unique name is assigned a dense integer id
+struct PSsymbolTable
+{
+	std::string names;              //the names of every symbol, stored back to back
+	std::vector<uint32_t> offsets;  //the offset of each symbol's name into names, followed by the total length
+	std::vector<uint32_t> buckets;  //open-addressed hash table of symbol ids, used when interning
+};
+
+//the instruction sets the lexer can use to scan source code, ordered from slowest to fastest
+enum class PSlexerSimd
+{
+	SCALAR,
+	SSE2,
+	AVX2
+};
+
+//a lexical token, references a range of the source buffer it was lexed from
 struct PStoken
 {
-	enum Type
+	enum Type : uint8_t
 	{
 		ID,
-		OP,
-		NEWLINE
+		NEWLINE,
+
+		//operators, seperators and operator keywords, these are kept contiguous:
+		#define PS_TOKEN_TYPE(type, ...) type,
+		PS_OPERATOR_TOKENS(PS_TOKEN_TYPE)
+		PS_SEPERATOR_TOKENS(PS_TOKEN_TYPE)
+		PS_KEYWORD_OPERATOR_TOKENS(PS_TOKEN_TYPE)
+
+		//control flow keywords:
+		PS_KEYWORD_TOKENS(PS_TOKEN_TYPE)
+		#undef PS_TOKEN_TYPE
+
+		//number literals, their values are decoded by the lexer:
+		NUMBER_INT,
+		NUMBER_FLOAT,
+
+		TYPE_COUNT
 	} type;
 
-	std::string str;
+	uint16_t length;  //the length of the token in the source buffer
+	uint32_t offset;  //the offset of the token in the source buffer
+	union Value
+	{
+		uint32_t symbol;  //the interned symbol id if the token is an identifier, UINT32_MAX for other tokens
+		int32_t intNum;   //the value if the token is NUMBER_INT
+		float floatNum;   //the value if the token is NUMBER_FLOAT
+	} value;
 	uint32_t lineNum;
 };
 
+//a list of tokens stored as parallel arrays, along with the source buffer and symbol table they reference
+struct PStokenBuffer
+{
+	std::vector<PStoken::Type> types;
+	std::vector<uint32_t> offsets;
+	std::vector<uint16_t> lengths;
+	std::vector<uint32_t> lineNums;
+
+	//the values of identifier and number tokens, other tokens have no value stored:
+	std::vector<PStoken::Value> values;
+	std::vector<uint64_t> valueMask;    //bit i of element j is set if token 64 * j + i has a value
+	std::vector<uint32_t> valueOffsets; //the index in values of the first value in each group of 64 tokens
+
+	PSsymbolTable symbols;
+
+	const char* source = nullptr;
+	size_t sourceSize = 0;
+	std::shared_ptr<const char> sourceOwner; //keeps a memory-mapped source alive, null if the source is owned by the caller
+
+	PStoken operator[](size_t idx) const; //gathers a token from the arrays, prefer reading the arrays directly in hot loops
+	size_t size() const { return types.size(); }
+};
+
+//the tokens of a token buffer that were replaced after an edit to its source
+struct PStokenEdit
+{
+	uint32_t first;    //the index of the first token that was lexed again
+	uint32_t oldEnd;   //the end of the replaced tokens, before the edit
+	uint32_t newEnd;   //the end of the tokens that replaced them, the tokens from here on are the old tokens from oldEnd on
+	uint32_t line;     //the first line after the replaced tokens, before the edit
+	int32_t lineDelta; //the number of lines that line and the lines after it moved by
+};
+
+#define PS_LEXER_WINDOW_SIZE 64           //the number of tokens a streaming lexer keeps, must be a power of 2
+#define PS_LEXER_CHUNK_SIZE  (64 * 1024) //the number of bytes a streaming lexer reads at a time
+
+//the state of the lexer between tokens
+struct PSlexState
+{
+	size_t pos = 0;       //the offset of the next character to lex
+	uint32_t curLine = 1;
+	size_t numTokens = 0;
+	PStoken::Type lastType = PStoken::NEWLINE;
+	bool inComment = false;
+	bool quiet = false;   //errors are not reported, used when lexing chunks in parallel
+};
+
+//a pull-based lexer, reads the source in chunks and lexes tokens on demand so memory use does not grow with the source size
+struct PSlexer
+{
+	std::function<size_t(char* dest, size_t size)> read; //reads up to size bytes of source into dest, returns the number of bytes read
+	bool readFinished = false;
+	bool failed = false;
+
+	std::vector<char> chunk; //the source still referenced by the window or not yet lexed
+	size_t chunkBase = 0;    //the offset of chunk[0] in the source
+
+	PStoken window[PS_LEXER_WINDOW_SIZE]; //ring buffer of the most recently lexed tokens, indexed by token index
+	uint32_t numLexed = 0;
+	uint32_t position = 0; //the index of the next token returned by ps_lexer_next
+
+	PSsymbolTable symbols;
+	PSlexState state;
+};
+
+#define PS_DEFAULT_MAX_PARSE_DEPTH 1024 //the default number of statements a statement can be nested in
+#define PS_DEFAULT_MAX_EVAL_DEPTH  4096 //the default number of nodes an evaluation can be nested in, about 4mb of native stack in unoptimized builds
+
+#define PS_OBJECT_MAGIC   "PSOB" //the first bytes of a .psobj file, files without them are read as the original unversioned format
+#define PS_OBJECT_VERSION 3      //the version of the .psobj format ps_save_ast writes
+
+#define PS_ARCHIVE_MAGIC   "PSAR" //the first bytes of an archive of scripts
+#define PS_ARCHIVE_VERSION 2      //the version of the archive format ps_save_archive writes
+
+#define PS_PACKED_MAGIC   "PSPK" //the first bytes of a packed .psobj file, a dense encoding that is decoded when loaded
+#define PS_PACKED_VERSION 1      //the version of the packed format ps_encode_ast writes
+
+#define PS_COMPILER_VERSION 1 //bump whenever lexing, parsing, folding or compacting produce a different ast, so cached compiles are redone
+
 //a handle to an abstract syntax tree node
 typedef uint32_t PSnodeHandle;
+//a handle to a list of node handles or symbols, the index of the list's length in PSast::lists, which is followed by its elements
+typedef uint32_t PSnodeList;
 
-//an abstract syntax tree node
+//an abstract syntax tree node, a small header followed by a payload that depends on the node's type
 struct PSnode
 {
-	enum Type : uint32_t
+	enum Type : uint8_t
 	{
 		OP,
 		KEYWORD,
@@ -45,9 +167,10 @@ struct PSnode
 
 	struct OP
 	{
-		enum Type : uint32_t
+		enum Type : uint8_t
 		{
 			IN               = 0,  //operator precedence
+			NEG,                   //unary negation, only applied to operands so its precedence is never compared. right is unused
 
 			MULT             = 10,
 			DIV,
@@ -76,15 +199,14 @@ struct PSnode
 
 		PSnodeHandle left;  //the left side of the operator
 		PSnodeHandle right; //the right side of the operator
-		bool inParens;      //whether the operator is in parenthesis
-	} op;
+	};
 
 	//----------------------//
 	//KEYWORD:
 
 	struct Keyword
 	{
-		enum Type
+		enum Type : uint8_t
 		{
 			IF,
 			FOR,
@@ -94,63 +216,158 @@ struct PSnode
 			CONTINUE
 		} type;
 
-		//code for body of control flow statement:
-		std::vector<PSnodeHandle> code;
-
-		//if statement condition / for stataement iteration rule:
-		PSnodeHandle condition; 
-
 		//else statement stuff:
 		bool hasElse;
-		std::vector<PSnodeHandle> elseCode;
 
-		//function names:
-		std::string name;
-		std::vector<std::string> paramNames;
+		union
+		{
+			PSnodeHandle condition; //if statement condition / for stataement iteration rule
+			PSnodeHandle returnVal; //return value, UINT32_MAX for a void return
+			uint32_t name;          //function name symbol
+		};
+
+		//code for body of control flow statement:
+		PSnodeList code;
 
-		//return value:
-		PSnodeHandle returnVal;
-	} keyword;
+		union
+		{
+			PSnodeList elseCode;
+			PSnodeList paramNames; //function parameter name symbols
+		};
+	};
 
 	//----------------------//
 	//IDENTIFIER:
 
 	struct ID
 	{
-		enum Type : uint32_t
+		enum Type : uint8_t
 		{
 			FUNC,
 			VAR
 		} type;
 
-		std::string name;
-		std::vector<PSnodeHandle> params; //if type is a variable, also represents the index into that variable
-	} id;
+		uint32_t name;     //the name symbol
+		PSnodeList params; //if type is a variable, also represents the index into that variable
+	};
 
 	//----------------------//
 	//LITERAL:
 
 	struct Literal
 	{
-		enum Type : uint32_t
+		enum Type : uint8_t
 		{
 			INT,
-			FLOAT
+			FLOAT,
+			CONSTANT //a folded value of any type, stored in PSast::constants
 		} type;
 
 		int32_t intNum;
 		float floatNum;
-	} literal;
+		uint32_t constant; //the index of the value in PSast::constants, if type is CONSTANT
+	};
 
-	PSnode () {};
-	~PSnode() {};
+	union
+	{
+		struct OP op; //elaborated, the OP and ID enumerators of Type hide the struct names
+		Keyword keyword;
+		struct ID id;
+		Literal literal;
+	};
 };
 
+struct PSdata;
+
 //an abstract syntax tree
 struct PSast
 {
 	std::vector<PSnodeHandle> parentNodes;
 	std::vector<PSnode> nodePool;
+	std::vector<uint32_t> lists = {0}; //the lists nodes reference, each stored as its length followed by its elements. list 0 is always empty
+	PSsymbolTable symbols;             //the names of functions, variables and parameters
+	std::vector<PSdata> constants;     //values folded by ps_fold_constants that are not an int or float
+
+	uint32_t list_size(PSnodeList list) const { return lists[list]; }
+	const uint32_t* list_data(PSnodeList list) const { return lists.data() + list + 1; }
+};
+
+//the arrays of an abstract syntax tree, without owning them. resolved programs read their ast through a view, so an ast can be
+//executed straight from a mapped .psobj file
+struct PSastView
+{
+	const PSnodeHandle* parentNodes = nullptr;
+	uint32_t numParentNodes = 0;
+	const PSnode* nodePool = nullptr;
+	uint32_t numNodes = 0;
+	const uint32_t* lists = nullptr;         //stored as in PSast::lists
+	const char* symbolNames = nullptr;       //the names of the symbols, possibly shared with other asts
+	const uint32_t* symbolStarts = nullptr;  //the offset of each symbol's name into symbolNames
+	const uint32_t* symbolEnds = nullptr;    //the offset of the end of each symbol's name into symbolNames
+	uint32_t numSymbols = 0;
+	const PSdata* constants = nullptr;
+
+	uint32_t list_size(PSnodeList list) const { return lists[list]; }
+	const uint32_t* list_data(PSnodeList list) const { return lists + list + 1; }
+	std::string_view symbol_name(uint32_t symbol) const { return std::string_view(symbolNames + symbolStarts[symbol], symbolEnds[symbol] - symbolStarts[symbol]); }
+};
+
+//the body of a parent function in a .psobj file. its nodes and lists are contiguous, so it can be loaded on its own
+struct PSobjectFunction
+{
+	PSnodeHandle definition; //the function's definition node, which is loaded with the parent nodes
+	uint32_t firstNode;
+	uint32_t numNodes;
+	uint32_t firstList;      //the index of the body's first list in the object's lists
+	uint32_t listsSize;      //the number of elements of the object's lists the body's lists take up, 0 if it has none
+};
+
+//a .psobj file mapped or loaded into memory, its arrays are used as an ast in place. the bodies of the parent functions in its
+//function table are resolved the first time the function is called, and read from the file then if the object was loaded
+struct PSobject
+{
+	PSastView ast;
+	std::shared_ptr<const char> data; //keeps the mapping or the loaded sections alive
+	size_t size = 0;
+
+	const PSobjectFunction* functions = nullptr; //the parent functions whose bodies can be loaded on their own, sorted by their nodes
+	uint32_t numFunctions = 0;
+	std::vector<uint8_t> loaded; //whether the body of each function has been read, empty if the whole object is in memory
+	uint64_t numConstants = 0;   //the constants the bodies read later are checked against
+	std::ifstream file;          //the file the bodies are read from
+};
+
+struct PSarchiveEntry;
+
+//an archive of scripts mapped into memory, its index is sorted by name so any script can be found without reading the others
+struct PSarchive
+{
+	std::shared_ptr<const char> data; //keeps the mapping alive, shared with the objects found in the archive
+	size_t size = 0;
+	const PSarchiveEntry* entries = nullptr; //the index, an entry for each script sorted by name
+	const char* strings = nullptr;           //the script and symbol names, each distinct name is stored once
+	uint32_t stringsSize = 0;
+	uint32_t numScripts = 0;
+};
+
+//the statements in a block of code, kept by incremental scripts to find the statements an edit touches
+struct PSincrementalBlock
+{
+	uint32_t begin = 0;               //the index of the first token in the block
+	uint32_t end = 0;                 //the index of the token ending the block, its closing curly brace or the number of tokens
+	std::vector<uint32_t> statements; //the index of the first token of each statement
+};
+
+//a script that is compiled incrementally, edits to its source only lex and parse the statements they touch again
+struct PSincrementalScript
+{
+	std::string source;
+	PStokenBuffer tokens;
+	PSast* ast = nullptr; //the ast of the source, nullptr if it has errors
+
+	PSincrementalBlock parentBlock;             //the parent nodes of the ast
+	std::vector<PSincrementalBlock> funcBlocks; //the body of each parent node that is a function definition, relative to its first token
+	size_t numGarbage = 0;                      //the number of nodes and list elements left unreferenced by edits
 };
 
 //--------------------------------------------------------------------------------------------------------------------------------//
@@ -195,6 +412,7 @@ struct PSfunctionSignature
 {
 	std::string name;
 	PSdata (*func)(const std::vector<PSdata>& params, const PSnode& node, void* userData);
+	bool pure = false; //whether the result only depends on the parameters and calling has no side effects, lets ps_fold_constants evaluate calls with constant parameters
 };
 
 //a constant value
@@ -204,43 +422,330 @@ struct PSconstant
 	PSdata val;
 };
 
+//what a node of an ast refers to, found by ps_resolve
+struct PSbinding
+{
+	enum Type : uint8_t
+	{
+		NONE,     //the node does not refer to anything, or is never executed
+		SLOT,     //a variable, index is its slot in the frame of the function it is used in
+		DECLARE,  //a variable that is assigned to for the first time in its scope, index is its slot
+		CONSTANT, //a constant, index is its value in PSprogram::constants
+		NATIVE,   //a call to a library function, index is the function in PSprogram::natives
+		SCRIPT    //a call to or the definition of a script function, index is the function in PSprogram::functions
+	} type = NONE;
+
+	uint32_t index = 0;
+};
+
+//a script function of a resolved program
+struct PSresolvedFunction
+{
+	PSnodeHandle definition; //the function's definition node
+	uint32_t numParams;      //the parameters are the first slots of the function's frame
+	uint32_t numSlots;       //the number of variables in the function's frame
+	uint32_t body;           //the function's entry in the object's function table while its body is not resolved, UINT32_MAX otherwise
+};
+
+struct PSresolver;
+
+//an abstract syntax tree with every identifier resolved, executed without looking anything up by name
+struct PSprogram
+{
+	PSastView ast;                             //the ast the program was resolved from, it has to outlive the program
+	std::vector<PSbinding> bindings;           //the binding of each node in the ast's node pool
+	std::vector<PSresolvedFunction> functions; //the script functions the ast defines
+	std::vector<PSfunctionSignature> natives;  //the library functions the ast calls
+	std::vector<PSdata> constants;             //the values of the constants the ast reads
+	uint32_t numSlots = 0;                     //the number of variables in the frame of the parent nodes
+
+	PSobject* object = nullptr;                //the object the program was resolved from, if any
+	std::shared_ptr<PSresolver> resolver;      //kept while the bodies of some functions are resolved when they are first called
+};
+
 //--------------------------------------------------------------------------------------------------------------------------------//
 
-/* Lexes and tokenizes a source file
+/* Lexes and tokenizes a source file, the file is memory-mapped rather than read
  * @param path the path to the source file
- * @returns the vector of tokens extracted from the spurce file
+ * @returns the tokens extracted from the source file, these keep the mapping alive
+ */
+PStokenBuffer ps_lex_file(std::string path);
+/* Memory-maps a file for reading
+ * @param path the path to the file
+ * @param data filled with the contents of the file, which are unmapped once the last reference is released. nullptr for empty files
+ * @param size filled with the size of the file, in bytes
+ * @returns whether the file could be mapped
+ */
+bool ps_map_file(const std::string& path, std::shared_ptr<const char>* data, size_t* size);
+/* Lexes and tokenizes source code that is already in memory
+ * @param source a pointer to the source code, does not need to be null-terminated, must outlive the returned tokens
+ * @param size the length of the source code, in bytes
+ * @returns the tokens extracted from the source code
+ */
+PStokenBuffer ps_lex_buffer(const char* source, size_t size);
+/* Lexes the lines of a token buffer's source touched by an edit again, the tokens after them are shifted rather than lexed again
+ * @param tokens the token buffer, lexed from the source before the edit
+ * @param source the source after the edit, must outlive the tokens
+ * @param size the size of the source after the edit, in bytes
+ * @param offset the offset of the edit in the source
+ * @param removedSize the number of bytes the edit removed from offset
+ * @param insertedSize the number of bytes the edit inserted at offset
+ * @param edit filled with the range of tokens that were replaced, may be nullptr
+ * @returns whether lexing succeeded, if not the token buffer is left unchanged
+ */
+bool ps_lex_edit(PStokenBuffer& tokens, const char* source, size_t size, size_t offset, size_t removedSize, size_t insertedSize, PStokenEdit* edit);
+/* Returns the text of a token
+ * @param tokens the token buffer the token belongs to
+ * @param token the token
+ * @returns a view of the token's text in the source buffer
+ */
+std::string_view ps_token_str(const PStokenBuffer& tokens, const PStoken& token);
+
+/* Opens a streaming lexer on a source file, the file is read in chunks as tokens are requested
+ * @param path the path to the source file
+ * @returns the lexer, or nullptr if the file could not be opened
+ */
+PSlexer* ps_lexer_open_file(std::string path);
+/* Opens a streaming lexer that reads its source from a callback
+ * @param read reads up to size bytes of source into dest, returns the number of bytes read, 0 once the source is exhausted
+ * @returns the lexer
+ */
+PSlexer* ps_lexer_open_reader(std::function<size_t(char* dest, size_t size)> read);
+/* Frees a streaming lexer
+ * @param lexer the lexer to free
+ */
+void ps_lexer_free(PSlexer* lexer);
+/* Returns the next token of a streaming lexer and advances past it
+ * @param lexer the lexer
+ * @returns the token, or nullptr at the end of the source or if an error occured. valid until PS_LEXER_WINDOW_SIZE more tokens are lexed
+ */
+const PStoken* ps_lexer_next(PSlexer* lexer);
+/* Returns an upcoming token of a streaming lexer without advancing past it
+ * @param lexer the lexer
+ * @param n the number of tokens to look ahead, 0 is the token returned by the next call to ps_lexer_next. must be less than PS_LEXER_WINDOW_SIZE / 2
+ * @returns the token, or nullptr at the end of the source or if an error occured
+ */
+const PStoken* ps_lexer_peek(PSlexer* lexer, uint32_t n);
+/* Returns the token with the given index in the source, lexing ahead if needed
+ * @param lexer the lexer
+ * @param idx the index of the token, only the most recent PS_LEXER_WINDOW_SIZE tokens are kept
+ * @returns the token, or nullptr if it was already discarded, is past the end of the source, or an error occured
+ */
+const PStoken* ps_lexer_token(PSlexer* lexer, uint32_t idx);
+/* Returns the text of a token lexed by a streaming lexer
+ * @param lexer the lexer the token was lexed by
+ * @param token the token, must still be in the lexer's window
+ * @returns a view of the token's text, valid until more tokens are lexed
+ */
+std::string_view ps_lexer_token_str(const PSlexer* lexer, const PStoken& token);
+
+/* Sets the instruction set the lexer uses to scan whitespace, comments, and identifiers. The fastest one supported
+ * by the cpu is used by default, this is mainly useful for benchmarking and debugging
+ * @param simd the instruction set to use, if it is not supported by the cpu the fastest supported one is used instead
+ */
+void ps_lex_set_simd(PSlexerSimd simd);
+/* Returns the instruction set the lexer is currently using
+ * @returns the instruction set the lexer is currently using
+ */
+PSlexerSimd ps_lex_get_simd();
+/* Sets the number of threads ps_lex_buffer and ps_lex_file may use. Sources are split into chunks at newlines, each at
+ * least 1MB, that are lexed in parallel. The tokens are identical to lexing on a single thread
+ * @param numThreads the maximum number of threads to use, 0 to use one per hardware thread (the default)
+ */
+void ps_lex_set_threads(uint32_t numThreads);
+/* Returns the maximum number of threads the lexer uses
+ * @returns the maximum number of threads the lexer uses, 0 if it uses one per hardware thread
+ */
+uint32_t ps_lex_get_threads();
+
+/* Interns a name into a symbol table
+ * @param table the symbol table to intern into
+ * @param name the name to intern
+ * @returns the id of the symbol, names that have already been interned return their existing id
+ */
+uint32_t ps_intern_symbol(PSsymbolTable& table, std::string_view name);
+/* Returns the name of a symbol
+ * @param table the symbol table the symbol belongs to
+ * @param symbol the id of the symbol
+ * @returns a view of the symbol's name, valid until the next symbol is interned
  */
-std::vector<PStoken> ps_lex_file(std::string path);
+std::string_view ps_symbol_name(const PSsymbolTable& table, uint32_t symbol);
+/* Returns the number of symbols in a symbol table
+ * @param table the symbol table
+ * @returns the number of symbols
+ */
+uint32_t ps_symbol_count(const PSsymbolTable& table);
 
 /* Parses a list of tokens into an abstract syntax tree
  * @param tokens the list of tokens
  * @returns the generated abstract syntax tree
  */
-PSast* ps_parse_tokens(const std::vector<PStoken>& tokens);
+PSast* ps_parse_tokens(const PStokenBuffer& tokens);
+/* Parses tokens from a streaming lexer into an abstract syntax tree, tokens are lexed as the parser needs them
+ * @param lexer the lexer
+ * @returns the generated abstract syntax tree, or nullptr if lexing or parsing failed
+ */
+PSast* ps_parse_lexer(PSlexer* lexer);
+/* Lexes and parses source code that is already in memory into an abstract syntax tree
+ * @param source a pointer to the source code, does not need to be null-terminated
+ * @param size the length of the source code, in bytes
+ * @returns the generated abstract syntax tree, or nullptr if lexing or parsing failed
+ */
+PSast* ps_parse_source(const char* source, size_t size);
+/* Lexes and parses source code that is already in memory into an abstract syntax tree
+ * @param source the source code
+ * @returns the generated abstract syntax tree, or nullptr if lexing or parsing failed
+ */
+PSast* ps_parse_source(const std::string& source);
+/* Sets the number of threads ps_parse_tokens and ps_parse_source may use. Tokens are split into chunks before top-level function
+ * definitions, each at least 128K tokens, whose parent statements are parsed in parallel. The ast is identical to parsing on a single thread
+ * @param numThreads the maximum number of threads to use, 0 to use one per hardware thread (the default)
+ */
+void ps_parse_set_threads(uint32_t numThreads);
+/* Returns the maximum number of threads the parser uses
+ * @returns the maximum number of threads the parser uses, 0 if it uses one per hardware thread
+ */
+uint32_t ps_parse_get_threads();
+/* Sets how deeply statements can be nested before parsing fails with an error. The parser keeps its work on the heap, so
+ * nesting never costs native stack while parsing, this bounds the depth of the asts that are walked later
+ * @param maxDepth the number of statements a statement can be nested in, parent statements are nested in 1
+ */
+void ps_parse_set_max_depth(uint32_t maxDepth);
+/* Returns how deeply statements can be nested before parsing fails
+ * @returns the number of statements a statement can be nested in
+ */
+uint32_t ps_parse_get_max_depth();
+/* Renumbers the nodes of an abstract syntax tree in the order they are evaluated, so that executing it walks memory forwards.
+ * Each statement is followed by its children, and the body of each loop and function is contiguous. Nodes that are no longer
+ * referenced, like the operands of folded expressions, are dropped. Call it after ps_fold_constants and before ps_resolve
+ * @param ast the abstract syntax tree to compact
+ */
+void ps_compact_ast(PSast* ast);
+/* Compiles a script that can be edited incrementally, its ast is kept up to date with every edit
+ * @param source the source code
+ * @returns the script, its ast is nullptr if the source has errors
+ */
+PSincrementalScript* ps_incremental_open(std::string source);
+/* Edits the source of an incrementally compiled script, only the statements and function body statements the edit touches are
+ * lexed and parsed again. The ast is compiled from scratch after an error, or once edits have left enough unreferenced nodes
+ * @param script the script
+ * @param offset the offset of the edit in the source
+ * @param removedSize the number of bytes to remove from offset
+ * @param inserted the text to insert at offset
+ * @returns whether the edited source compiled, if not the script's ast is nullptr until an edit fixes the errors
+ */
+bool ps_incremental_edit(PSincrementalScript* script, size_t offset, size_t removedSize, std::string_view inserted);
+/* Frees an incrementally compiled script, along with its ast
+ * @param script the script to free
+ */
+void ps_incremental_free(PSincrementalScript* script);
 /* Frees an abstract syntax tree
  * @param ast the abstract syntax tree to free
  */
 void ps_free_ast(PSast* ast);
-/* Serializes an abstract syntax tree to disk
+/* Serializes an abstract syntax tree to disk in the current .psobj format, its arrays are written as they are laid out in memory
+ * so the file can be mapped with ps_map_object. Unreferenced nodes are written too, compact the ast first to leave them out
  * @param path the path to the file to save to
  * @param ast the abstact syntax tree to save
  */
 void ps_save_ast(std::string path, PSast* ast);
-/* Serializes an abstract syntax tree to disk
+/* Serializes an abstract syntax tree to disk in the current .psobj format
  * @param file the file pointer to save to
  * @param ast the abstact syntax tree to save
  */
 void ps_save_ast(std::ofstream& file, PSast* ast);
-/* Loads an abstract syntax tree from disk
+/* Encodes an abstract syntax tree densely: every field is a varint, child handles are stored relative to their parent and the
+ * result can be compressed. Smaller than a .psobj file, but has to be decoded to be used
+ * @param ast the abstract syntax tree to encode, its lists have to be stored one after another as the parser and ps_compact_ast do
+ * @param compress whether to compress the encoded ast with the built in block compressor
+ * @returns the encoded ast, or an empty buffer if it could not be encoded
+ */
+std::vector<char> ps_encode_ast(PSast* ast, bool compress);
+/* Decodes an abstract syntax tree encoded by ps_encode_ast in a single pass over the buffer
+ * @param data the encoded ast
+ * @param size the size of the encoded ast, in bytes
+ * @returns the decoded abstract syntax tree, or nullptr if the buffer is corrupt or from another version
+ */
+PSast* ps_decode_ast(const char* data, size_t size);
+/* Encodes an abstract syntax tree with ps_encode_ast and saves it to disk, ps_load_ast loads it
+ * @param path the path to the file to save to
+ * @param ast the abstract syntax tree to save
+ * @param compress whether to compress the encoded ast
+ */
+void ps_save_packed_ast(std::string path, PSast* ast, bool compress);
+/* Loads an abstract syntax tree from disk, from a current, packed or unversioned .psobj file
  * @param path the path to the file to load from
  * @returns the loaded abstract syntax tree
  */
 PSast* ps_load_ast(std::string path);
-/* Loads an abstract syntax tree from disk
+/* Loads an abstract syntax tree from disk, from a current, packed or unversioned .psobj file
  * @param file the file pointer to load from
  * @returns the loaded abstract syntax tree
  */
 PSast* ps_load_ast(std::ifstream& file);
+/* Maps a .psobj file into memory, so that it can be resolved and executed without loading it. The file has to have been saved
+ * by a build with the same node layout and byte order, older formats have to be loaded with ps_load_ast. Only the header and
+ * function table are checked, the nodes are used as they are, so only map files from a trusted source. ps_load_object and
+ * ps_load_ast check every node
+ * @param path the path to the file
+ * @returns the mapped object, or nullptr if the file could not be mapped or is not a current .psobj file
+ */
+PSobject* ps_map_object(std::string path);
+/* Loads a .psobj file without the bodies of its parent functions, each body is read from the file the first time its function
+ * is called. The file is kept open until the object is unmapped
+ * @param path the path to the file
+ * @returns the loaded object, or nullptr if the file could not be read or is not a current .psobj file
+ */
+PSobject* ps_load_object(std::string path);
+/* Reads the body of one of an object's parent functions, if it has not been read yet. Called when the function is first called,
+ * and can be called ahead of time to avoid reading from the file while executing
+ * @param object the object the function belongs to
+ * @param function the index of the function in the object's function table
+ * @returns whether the body could be read
+ */
+bool ps_object_load_function(PSobject* object, uint32_t function);
+/* Unmaps or frees a .psobj file, programs resolved from it can no longer be executed
+ * @param object the object to unmap
+ */
+void ps_unmap_object(PSobject* object);
+/* Packs many abstract syntax trees into one archive. Each script's arrays are laid out as in a .psobj file, and the names of
+ * every script and symbol are stored once in a string table shared by all of them
+ * @param path the path to the file to save to
+ * @param names the name of each script, used to find it in the archive. Every name has to be different
+ * @param asts the abstract syntax tree of each script
+ * @returns whether the archive was saved
+ */
+bool ps_save_archive(std::string path, const std::vector<std::string>& names, const std::vector<PSast*>& asts);
+/* Maps an archive into memory and checks its index, the scripts themselves are only read when they are used
+ * @param path the path to the archive
+ * @returns the opened archive, or nullptr if the file could not be mapped or is not an archive of this version and layout
+ */
+PSarchive* ps_open_archive(std::string path);
+/* Closes an archive. Objects found in it stay valid until they are unmapped
+ * @param archive the archive to close
+ */
+void ps_close_archive(PSarchive* archive);
+/* Finds a script in an archive with a binary search of its index, the script is used in place like a mapped .psobj file. As with
+ * ps_map_object only the function table is checked, so only open archives from a trusted source. ps_archive_load_ast checks every node
+ * @param archive the archive to search
+ * @param name the name the script was archived with
+ * @returns the script, free it with ps_unmap_object. nullptr if there is no script with the name or its function table is invalid
+ */
+PSobject* ps_archive_find(PSarchive* archive, std::string_view name);
+/* Finds a script in an archive and loads a copy of its abstract syntax tree
+ * @param archive the archive to search
+ * @param name the name the script was archived with
+ * @returns the loaded abstract syntax tree, or nullptr if there is no script with the name or it is invalid
+ */
+PSast* ps_archive_load_ast(PSarchive* archive, std::string_view name);
+/* Compiles a source file, or loads it from a cache of compiled files. Entries are named by a hash of the source, the compiler
+ * and object versions and ps_host_hash, so set the host's functions and constants first. A miss lexes, parses, folds and compacts
+ * the source, then writes its entry to a temporary file that is renamed into place, so processes can share a cache directory
+ * @param sourcePath the path to the source file
+ * @param cacheDir the directory of the cache, created if it does not exist
+ * @returns the compiled abstract syntax tree, or nullptr if the source could not be read, lexed or parsed
+ */
+PSast* ps_compile_cached(std::string sourcePath, std::string cacheDir);
 
 /* Sets a list of user defined functions to include in execution
  * @param functions the list of user defined functions to include 
@@ -254,11 +759,53 @@ void ps_set_constants(const std::vector<PSconstant>& constants);
  * @param userData the pointer to be passed to each function call
  */
 void ps_set_function_user_data(void* userData);
+/* Hashes what folding depends on in the host: the names of the library functions and whether they are pure, and the constants
+ * @returns the hash, which is the same in every process with the same functions and constants
+ */
+uint64_t ps_host_hash();
 /* Throws an invalid parameter error, call inside a user-defined function if the parameter list is invalid
  * @param node the node passed to the function
  */
 void ps_throw_invalid_param_error(PSnode node);
-/* Executes the code in an abstract syntax tree
+/* Sets how deeply evaluation can be nested before execution fails with an error. Each level costs native stack, so the
+ * default leaves room for the stack of the main thread, lower it when executing on threads with smaller stacks
+ * @param maxDepth the number of nodes an evaluation can be nested in, a function call nests the statements of the function
+ */
+void ps_set_max_depth(uint32_t maxDepth);
+/* Returns how deeply evaluation can be nested before execution fails
+ * @returns the number of nodes an evaluation can be nested in
+ */
+uint32_t ps_get_max_depth();
+/* Folds constant expressions in an abstract syntax tree into literals: operators applied to literals and constants, and
+ * calls to pure functions with constant parameters. Folding uses the functions and constants that are currently set, so
+ * call it after ps_set_functions and ps_set_constants
+ * @param ast the abstract syntax tree to fold
+ */
+void ps_fold_constants(PSast* ast);
+/* Resolves an abstract syntax tree for execution. Every variable is bound to a slot in the frame of its function, every call to
+ * a script or library function, and every constant to its value. Undefined variables and functions, calls with the wrong number
+ * of parameters, break and continue outside of loops and redefined functions are reported here instead of while executing.
+ * Resolving uses the functions and constants that are currently set
+ * @param ast the abstract syntax tree to resolve, it has to outlive the program
+ * @returns the resolved program, or nullptr if the ast has errors
+ */
+PSprogram* ps_resolve(PSast* ast);
+/* Resolves a mapped or loaded .psobj file for execution, the same way as an abstract syntax tree. The bodies of the parent functions
+ * in the object's function table are only resolved, and loaded, the first time their function is called, so errors in them are
+ * reported while executing instead
+ * @param object the object to resolve, it has to outlive the program
+ * @returns the resolved program, or nullptr if the object has errors
+ */
+PSprogram* ps_resolve(PSobject* object);
+/* Frees a resolved program, but not the ast it was resolved from
+ * @param program the program to free
+ */
+void ps_free_program(PSprogram* program);
+/* Executes a resolved program
+ * @param program the program to execute
+ */
+void ps_execute(PSprogram* program);
+/* Resolves and executes the code in an abstract syntax tree
  * @param ast the abstract syntax tree to execute
  */
 void ps_execute(PSast* ast);
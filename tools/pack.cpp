@@ -0,0 +1,72 @@
+#include "propscript.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+//compiles a source file, or loads an already compiled .psobj file
+static PSast* _pack_load_script(const std::filesystem::path& path)
+{
+	if(path.extension() != ".ps")
+		return ps_load_ast(path.string());
+
+	std::shared_ptr<const char> source;
+	size_t size;
+	if(!ps_map_file(path.string(), &source, &size))
+	{
+		std::cout << "failed to open \"" << path.string() << "\" for reading" << std::endl;
+		return nullptr;
+	}
+
+	PSast* ast = ps_parse_source(source.get(), size);
+	if(!ast)
+		return nullptr;
+
+	ps_fold_constants(ast);
+	ps_compact_ast(ast);
+	return ast;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------//
+
+//packs scripts into an archive, each script is named by its path without the extension
+int main(int argc, char** argv)
+{
+	if(argc < 3)
+	{
+		std::cout << "usage: " << argv[0] << " <archive> <script.ps or script.psobj>..." << std::endl;
+		return -1;
+	}
+
+	std::vector<std::string> names;
+	std::vector<PSast*> asts;
+	int result = 0;
+	for(int i = 2; i < argc; i++)
+	{
+		std::filesystem::path path = argv[i];
+		PSast* ast = _pack_load_script(path);
+		if(!ast)
+		{
+			std::cout << "failed to load \"" << argv[i] << "\"" << std::endl;
+			result = -1;
+			break;
+		}
+
+		names.push_back(std::filesystem::path(path).replace_extension().generic_string());
+		asts.push_back(ast);
+	}
+
+	if(result == 0 && !ps_save_archive(argv[1], names, asts))
+		result = -1;
+
+	if(result == 0)
+		std::cout << "packed " << asts.size() << " scripts into \"" << argv[1] << "\"" << std::endl;
+
+	for(PSast* ast : asts)
+		ps_free_ast(ast);
+
+	return result;
+}